@@ -0,0 +1,66 @@
+#include "core/models/car_following.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+// Пакеты моделей следования в double и float (ITS_FLOAT_STATE) рядом:
+//   ITS_kernel_bench [ROWS...]
+// Время ядра на строку. Малый пакет лежит в кэше и меряет арифметику,
+// большой (по умолчанию 4M строк) - пропускную способность памяти.
+
+namespace {
+
+constexpr double kDt = 0.025;
+
+template <typename M>
+double nsPerRow(size_t rows) {
+    typename M::Batch batch;
+    std::mt19937 gen(1);
+    std::uniform_real_distribution<double> u(0.0, 1.0);
+    for (size_t i = 0; i < rows; ++i) {
+        sim::FollowInputs in{14.0 * u(gen), 14.0 * u(gen), 1.0 + 80.0 * u(gen),
+                             1.5, 1.2, 4.0, 1.5, 3.0, 14.0, 1.0, 0.5, u(gen)};
+        M::push(batch, in);
+    }
+
+    // Повторов столько, чтобы прогон шёл около 0.1 с
+    const int reps = std::max<int>(5, static_cast<int>(50'000'000 / rows));
+    M::run(batch, kDt);
+    const auto t0 = std::chrono::steady_clock::now();
+    for (int r = 0; r < reps; ++r)
+        M::run(batch, kDt);
+    const double ns = std::chrono::duration<double, std::nano>(
+                          std::chrono::steady_clock::now() - t0)
+                          .count();
+    volatile double sink = batch.out[rows / 2];
+    (void)sink;
+    return ns / (static_cast<double>(rows) * reps);
+}
+
+template <template <typename> class M>
+void compare(const char* name, const std::vector<size_t>& sizes) {
+    for (size_t rows : sizes) {
+        const double d = nsPerRow<M<double>>(rows);
+        const double f = nsPerRow<M<float>>(rows);
+        std::printf("%-7s %9zu rows  double %6.3f ns/row  float %6.3f ns/row"
+                    "  x%.2f\n",
+                    name, rows, d, f, d / f);
+    }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    std::vector<size_t> sizes;
+    for (int i = 1; i < argc; ++i)
+        sizes.push_back(std::strtoull(argv[i], nullptr, 10));
+    if (sizes.empty())
+        sizes = {4096, size_t(1) << 22};
+
+    compare<sim::IdmModelT>("idm", sizes);
+    compare<sim::GippsModelT>("gipps", sizes);
+    compare<sim::KraussModelT>("krauss", sizes);
+    return 0;
+}
@@ -0,0 +1,267 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <concepts>
+#include <cstddef>
+#include <tuple>
+#include <vector>
+#include "driver_models.h"
+#include "idm_kernel.h"
+
+namespace sim {
+
+// Входы модели следования для одной машины на текущем шаге
+struct FollowInputs {
+    double v;       // своя скорость
+    double vFront;  // скорость лидера (или препятствия)
+    double gap;     // зазор до лидера, м
+    double a;       // максимальное ускорение
+    double b;       // комфортное торможение
+    double bMax;    // предельное торможение (Gipps, Krauss)
+    double T;       // желаемый интервал (IDM)
+    double s0;      // зазор при остановке
+    double v0;      // желаемая скорость
+    double tau;     // время реакции (Gipps, Krauss)
+    double sigma;   // доля случайного замедления (Krauss)
+    double noise;   // равномерная [0, 1) для Krauss
+};
+
+// Политика модели следования: свой пакет строк (SoA), ядро по пакету
+// и скалярный путь. Все модели отдают ускорение на шаг dt; выбор модели
+// - параметр шаблона, так что ядро одной модели встраивается целиком.
+template <typename M>
+concept FollowingPolicy =
+    requires(typename M::Batch& batch, const FollowInputs& in, double dt) {
+        { M::kModel } -> std::convertible_to<FollowingModel>;
+        { M::push(batch, in) } -> std::same_as<int>;
+        M::run(batch, dt);
+        { M::accel(in, dt) } -> std::same_as<double>;
+        { batch.out[0] } -> std::convertible_to<double>;
+        batch.clear();
+    };
+
+// Intelligent Driver Model: ядро из idm_kernel.h
+template <typename R>
+struct IdmModelT {
+    static constexpr FollowingModel kModel = FollowingModel::Idm;
+    using Batch = IdmBatchT<R>;
+
+    static int push(Batch& batch, const FollowInputs& in) {
+        return batch.push(in.v, in.vFront, in.gap, in.a, in.b, in.T, in.s0,
+                          in.v0);
+    }
+
+    static void run(Batch& batch, double) { idmAccelBatch(batch); }
+
+    static double accel(const FollowInputs& in, double) {
+        return idmAccelScalar(in.v, in.vFront, in.gap, in.a, in.b, in.T, in.s0,
+                              in.v0);
+    }
+};
+
+// Gipps (1981): скорость через шаг - меньшая из скорости свободного
+// разгона и безопасной скорости, при которой успеваем остановиться за
+// лидером, если он начнёт тормозить с bMax. Время реакции tau.
+template <typename R>
+struct GippsModelT {
+    static constexpr FollowingModel kModel = FollowingModel::Gipps;
+
+    struct Batch {
+        std::vector<R> v, vFront, gap;
+        std::vector<R> a, bMax, tau, invV0;
+        std::vector<R> out;
+
+        [[nodiscard]] size_t size() const { return v.size(); }
+
+        void clear() {
+            v.clear();
+            vFront.clear();
+            gap.clear();
+            a.clear();
+            bMax.clear();
+            tau.clear();
+            invV0.clear();
+            out.clear();
+        }
+    };
+
+    static int push(Batch& batch, const FollowInputs& in) {
+        batch.v.push_back(R(in.v));
+        batch.vFront.push_back(R(in.vFront));
+        batch.gap.push_back(R(in.gap - in.s0));
+        batch.a.push_back(R(in.a));
+        batch.bMax.push_back(R(in.bMax));
+        batch.tau.push_back(R(in.tau));
+        batch.invV0.push_back(R(1.0 / in.v0));
+        batch.out.push_back(R(0));
+        return static_cast<int>(batch.v.size()) - 1;
+    }
+
+    template <typename T>
+    static T kernel(T v, T vFront, T gap, T a, T bMax, T tau, T invV0, T dt) {
+        T r = std::max(T(0), v * invV0);
+        T vAcc = v + T(2.5) * a * dt * (T(1) - r) * std::sqrt(T(0.025) + r);
+        T g = std::max(T(0), gap);
+        T bt = bMax * tau;
+        T disc = bt * bt + bMax * (T(2) * g - v * tau) + vFront * vFront;
+        T vSafe = -bt + std::sqrt(std::max(T(0), disc));
+        T vNext = std::max(T(0), std::min(vAcc, vSafe));
+        return (vNext - v) / dt;
+    }
+
+    static void run(Batch& batch, double dt) {
+        const size_t n = batch.size();
+        const R* __restrict v = batch.v.data();
+        const R* __restrict vf = batch.vFront.data();
+        const R* __restrict gap = batch.gap.data();
+        const R* __restrict a = batch.a.data();
+        const R* __restrict bMax = batch.bMax.data();
+        const R* __restrict tau = batch.tau.data();
+        const R* __restrict invV0 = batch.invV0.data();
+        R* __restrict out = batch.out.data();
+        const R step = R(dt);
+#pragma GCC ivdep
+        for (size_t i = 0; i < n; ++i)
+            out[i] = kernel(v[i], vf[i], gap[i], a[i], bMax[i], tau[i],
+                            invV0[i], step);
+    }
+
+    static double accel(const FollowInputs& in, double dt) {
+        return kernel(in.v, in.vFront, in.gap - in.s0, in.a, in.bMax, in.tau,
+                      1.0 / in.v0, dt);
+    }
+};
+
+// Krauss (1998, вариант SUMO): безопасная скорость по зазору и времени
+// реакции, разгон не больше a*dt, затем случайное замедление до
+// sigma*a*dt. Случайное число вытягивает машина при сборе входов.
+template <typename R>
+struct KraussModelT {
+    static constexpr FollowingModel kModel = FollowingModel::Krauss;
+
+    struct Batch {
+        std::vector<R> v, vFront, gap;
+        std::vector<R> a, invB2, tau, v0, dawdle;
+        std::vector<R> out;
+
+        [[nodiscard]] size_t size() const { return v.size(); }
+
+        void clear() {
+            v.clear();
+            vFront.clear();
+            gap.clear();
+            a.clear();
+            invB2.clear();
+            tau.clear();
+            v0.clear();
+            dawdle.clear();
+            out.clear();
+        }
+    };
+
+    static int push(Batch& batch, const FollowInputs& in) {
+        batch.v.push_back(R(in.v));
+        batch.vFront.push_back(R(in.vFront));
+        batch.gap.push_back(R(in.gap - in.s0));
+        batch.a.push_back(R(in.a));
+        batch.invB2.push_back(R(1.0 / (2.0 * in.bMax)));
+        batch.tau.push_back(R(in.tau));
+        batch.v0.push_back(R(in.v0));
+        batch.dawdle.push_back(R(in.sigma * in.noise));
+        batch.out.push_back(R(0));
+        return static_cast<int>(batch.v.size()) - 1;
+    }
+
+    template <typename T>
+    static T kernel(T v, T vFront, T gap, T a, T invB2, T tau, T v0, T dawdle,
+                    T dt) {
+        T g = std::max(T(0), gap);
+        T vSafe = vFront + (g - vFront * tau) / ((v + vFront) * invB2 + tau);
+        T vDes = std::min(std::min(v + a * dt, vSafe), v0);
+        T vNext = std::max(T(0), vDes - dawdle * a * dt);
+        return (vNext - v) / dt;
+    }
+
+    static void run(Batch& batch, double dt) {
+        const size_t n = batch.size();
+        const R* __restrict v = batch.v.data();
+        const R* __restrict vf = batch.vFront.data();
+        const R* __restrict gap = batch.gap.data();
+        const R* __restrict a = batch.a.data();
+        const R* __restrict invB2 = batch.invB2.data();
+        const R* __restrict tau = batch.tau.data();
+        const R* __restrict v0 = batch.v0.data();
+        const R* __restrict dawdle = batch.dawdle.data();
+        R* __restrict out = batch.out.data();
+        const R step = R(dt);
+#pragma GCC ivdep
+        for (size_t i = 0; i < n; ++i)
+            out[i] = kernel(v[i], vf[i], gap[i], a[i], invB2[i], tau[i], v0[i],
+                            dawdle[i], step);
+    }
+
+    static double accel(const FollowInputs& in, double dt) {
+        return kernel(in.v, in.vFront, in.gap - in.s0, in.a,
+                      1.0 / (2.0 * in.bMax), in.tau, in.v0,
+                      in.sigma * in.noise, dt);
+    }
+};
+
+// Модели со столбцами в скаляре сборки (Real)
+using IdmModel = IdmModelT<Real>;
+using GippsModel = GippsModelT<Real>;
+using KraussModel = KraussModelT<Real>;
+
+// Скалярный вызов модели по значению перечисления
+template <typename F>
+decltype(auto) visitFollowingModel(FollowingModel m, F&& f) {
+    switch (m) {
+        case FollowingModel::Gipps:
+            return f(GippsModel{});
+        case FollowingModel::Krauss:
+            return f(KraussModel{});
+        case FollowingModel::Idm:
+            break;
+    }
+    return f(IdmModel{});
+}
+
+// Пакеты всех моделей тика: строка уходит в пакет своей модели, затем
+// каждое ядро проходит свой однородный пакет без ветвлений по модели
+template <FollowingPolicy... Ms>
+class FollowBatchSet {
+public:
+    template <typename M>
+    typename M::Batch& of() {
+        return std::get<typename M::Batch>(batches_);
+    }
+
+    template <typename M>
+    const typename M::Batch& of() const {
+        return std::get<typename M::Batch>(batches_);
+    }
+
+    void clear() { (of<Ms>().clear(), ...); }
+
+    int push(FollowingModel m, const FollowInputs& in) {
+        int row = -1;
+        ((m == Ms::kModel ? (row = Ms::push(of<Ms>(), in), true) : false) ||
+         ...);
+        return row;
+    }
+
+    void run(double dt) { (Ms::run(of<Ms>(), dt), ...); }
+
+    [[nodiscard]] double out(FollowingModel m, int row) const {
+        double a = 0.0;
+        ((m == Ms::kModel ? (a = of<Ms>().out[row], true) : false) || ...);
+        return a;
+    }
+
+private:
+    std::tuple<typename Ms::Batch...> batches_;
+};
+
+using FollowBatches = FollowBatchSet<IdmModel, GippsModel, KraussModel>;
+
+} // namespace sim
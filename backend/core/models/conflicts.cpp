@@ -0,0 +1,126 @@
+#include "conflicts.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace sim {
+
+namespace {
+
+constexpr double kSampleStep = 0.25; // шаг выборки осевой линии, м
+
+struct Box {
+    double x0, y0, x1, y1;
+};
+
+Box boundsOf(const Polyline& line, double pad) {
+    Box b{std::numeric_limits<double>::infinity(),
+          std::numeric_limits<double>::infinity(),
+          -std::numeric_limits<double>::infinity(),
+          -std::numeric_limits<double>::infinity()};
+    for (const Vec2& p : line.points()) {
+        b.x0 = std::min(b.x0, p.x - pad);
+        b.y0 = std::min(b.y0, p.y - pad);
+        b.x1 = std::max(b.x1, p.x + pad);
+        b.y1 = std::max(b.y1, p.y + pad);
+    }
+    return b;
+}
+
+double distanceToPolyline(const Vec2& p, const Polyline& line) {
+    const auto& pts = line.points();
+    double best = std::numeric_limits<double>::infinity();
+    for (size_t i = 0; i + 1 < pts.size(); ++i) {
+        Vec2 ab = pts[i + 1] - pts[i];
+        double len2 = dot(ab, ab);
+        double t = len2 > 0.0 ? std::clamp(dot(p - pts[i], ab) / len2, 0.0, 1.0)
+                              : 0.0;
+        best = std::min(best, norm(p - (pts[i] + ab * t)));
+    }
+    return best;
+}
+
+// Участок a, где до осевой b ближе clearance; пустой - begin > end
+std::pair<double, double> closeRange(const Polyline& a, const Polyline& b,
+                                     double clearance) {
+    double begin = std::numeric_limits<double>::infinity();
+    double end = -std::numeric_limits<double>::infinity();
+    const double len = a.length();
+    const int n = static_cast<int>(std::ceil(len / kSampleStep));
+    for (int i = 0; i <= n; ++i) {
+        double s = std::min(len, i * kSampleStep);
+        if (distanceToPolyline(a.sample(s).first, b) < clearance) {
+            begin = std::min(begin, s);
+            end = std::max(end, s);
+        }
+    }
+    if (begin > end)
+        return {begin, end};
+    return {std::max(0.0, begin - 0.5 * kSampleStep),
+            std::min(len, end + 0.5 * kSampleStep)};
+}
+
+} // namespace
+
+void ConflictTable::build(const RoadNetwork& net, double clearance) {
+    std::vector<const Lane*> connectors;
+    for (const auto& [id, L] : net.lanes())
+        if (L.isConnector && !L.center.empty())
+            connectors.push_back(&L);
+    std::sort(connectors.begin(), connectors.end(),
+              [](const Lane* a, const Lane* b) { return a->id < b->id; });
+
+    std::vector<Box> boxes;
+    boxes.reserve(connectors.size());
+    for (const Lane* L : connectors)
+        boxes.push_back(boundsOf(L->center, 0.5 * clearance));
+
+    // Кандидаты - пересекающиеся рамки: проход по рамкам, упорядоченным по x0
+    std::vector<size_t> order(connectors.size());
+    for (size_t i = 0; i < order.size(); ++i)
+        order[i] = i;
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return boxes[a].x0 < boxes[b].x0 ||
+               (boxes[a].x0 == boxes[b].x0 && a < b);
+    });
+
+    std::vector<std::vector<ConflictZone>> byLane(
+        static_cast<size_t>(net.maxLaneId()) + 1);
+    for (size_t oi = 0; oi < order.size(); ++oi) {
+        const size_t i = order[oi];
+        for (size_t oj = oi + 1; oj < order.size(); ++oj) {
+            const size_t j = order[oj];
+            if (boxes[j].x0 > boxes[i].x1)
+                break;
+            if (boxes[j].y0 > boxes[i].y1 || boxes[i].y0 > boxes[j].y1)
+                continue;
+            const Lane& a = *connectors[i];
+            const Lane& b = *connectors[j];
+            auto [a0, a1] = closeRange(a.center, b.center, clearance);
+            auto [b0, b1] = closeRange(b.center, a.center, clearance);
+            if (a0 > a1 || b0 > b1)
+                continue;
+            ConflictKind kind = ConflictKind::Cross;
+            if (a.connectorFrom == b.connectorFrom)
+                kind = ConflictKind::Diverge;
+            else if (a.connectorTo == b.connectorTo)
+                kind = ConflictKind::Merge;
+            byLane[a.id].push_back({b.id, a0, a1, b0, b1, kind});
+            byLane[b.id].push_back({a.id, b0, b1, a0, a1, kind});
+        }
+    }
+
+    start_.assign(byLane.size() + 1, 0);
+    zones_.clear();
+    for (size_t lane = 0; lane < byLane.size(); ++lane) {
+        auto& zones = byLane[lane];
+        std::sort(zones.begin(), zones.end(),
+                  [](const ConflictZone& x, const ConflictZone& y) {
+                      return x.other < y.other;
+                  });
+        zones_.insert(zones_.end(), zones.begin(), zones.end());
+        start_[lane + 1] = static_cast<uint32_t>(zones_.size());
+    }
+}
+
+} // namespace sim
@@ -0,0 +1,45 @@
+#pragma once
+#include <cstdint>
+#include <span>
+#include <vector>
+#include "road_network.h"
+
+namespace sim {
+
+enum class ConflictKind : uint8_t {
+    Cross,  // траектории пересекаются
+    Merge,  // общий выезд
+    Diverge // общий въезд: начала коннекторов идут рядом
+};
+
+// Зона конфликта двух коннекторов: участки осевых линий, где они ближе
+// kClearance друг к другу. Машина, чей корпус на своём участке, мешает
+// другой на её.
+struct ConflictZone {
+    LaneId other{-1};
+    double begin{0.0}, end{0.0};           // свой участок, м
+    double otherBegin{0.0}, otherEnd{0.0}; // участок другого коннектора
+    ConflictKind kind{ConflictKind::Cross};
+};
+
+// Таблица зон по коннекторам, строится один раз после построения сети
+class ConflictTable {
+public:
+    static constexpr double kClearance = 2.2; // ширина машины с запасом
+
+    void build(const RoadNetwork& net, double clearance = kClearance);
+
+    [[nodiscard]] std::span<const ConflictZone> zonesOf(LaneId lane) const {
+        if (lane < 0 || static_cast<size_t>(lane) + 1 >= start_.size())
+            return {};
+        return {zones_.data() + start_[lane], zones_.data() + start_[lane + 1]};
+    }
+
+    [[nodiscard]] size_t zoneCount() const { return zones_.size(); }
+
+private:
+    std::vector<uint32_t> start_; // CSR по id полосы
+    std::vector<ConflictZone> zones_;
+};
+
+} // namespace sim
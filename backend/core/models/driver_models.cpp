@@ -0,0 +1,52 @@
+#include "driver_models.h"
+#include <sstream>
+
+namespace sim {
+
+bool parseFollowingModel(const std::string& name, FollowingModel& out) {
+    if (name == "idm")
+        out = FollowingModel::Idm;
+    else if (name == "gipps")
+        out = FollowingModel::Gipps;
+    else if (name == "krauss")
+        out = FollowingModel::Krauss;
+    else
+        return false;
+    return true;
+}
+
+bool parseLaneChangeModel(const std::string& name, LaneChangeModel& out) {
+    if (name == "coop")
+        out = LaneChangeModel::Cooperative;
+    else if (name == "mobil")
+        out = LaneChangeModel::Mobil;
+    else
+        return false;
+    return true;
+}
+
+bool parseVehicleClass(const std::string& text, VehicleClass& out) {
+    std::istringstream iss(text);
+    std::string following, laneChange, share;
+    if (!std::getline(iss, following, ':') ||
+        !std::getline(iss, laneChange, ':'))
+        return false;
+    VehicleClass c;
+    if (!parseFollowingModel(following, c.following) ||
+        !parseLaneChangeModel(laneChange, c.laneChange))
+        return false;
+    if (std::getline(iss, share)) {
+        try {
+            size_t used = 0;
+            c.share = std::stod(share, &used);
+            if (used != share.size() || !(c.share >= 0.0))
+                return false;
+        } catch (const std::exception&) {
+            return false;
+        }
+    }
+    out = c;
+    return true;
+}
+
+} // namespace sim
@@ -0,0 +1,28 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+namespace sim {
+
+// Модель следования за лидером (продольное движение)
+enum class FollowingModel : uint8_t { Idm, Gipps, Krauss };
+
+// Модель принятия интервала при перестроении
+enum class LaneChangeModel : uint8_t { Cooperative, Mobil };
+
+// Класс машин: пара моделей и доля в потоке новых машин
+struct VehicleClass {
+    FollowingModel following{FollowingModel::Idm};
+    LaneChangeModel laneChange{LaneChangeModel::Cooperative};
+    double share{1.0};
+};
+
+// Имена моделей в командах: idm | gipps | krauss, coop | mobil
+bool parseFollowingModel(const std::string& name, FollowingModel& out);
+
+bool parseLaneChangeModel(const std::string& name, LaneChangeModel& out);
+
+// Класс из строки "following:lanechange[:share]", например "gipps:mobil:0.3"
+bool parseVehicleClass(const std::string& text, VehicleClass& out);
+
+} // namespace sim
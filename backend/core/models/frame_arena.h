@@ -0,0 +1,77 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <vector>
+
+namespace sim {
+
+// Монотонная арена для временных данных одного тика (или одного запроса).
+// Память раздаётся сдвигом указателя, deallocate ничего не делает,
+// reset() возвращает всё разом. Блоки остаются за ареной, поэтому
+// после прогрева повторные тики не обращаются к куче.
+class FrameArena : public std::pmr::memory_resource {
+public:
+    explicit FrameArena(size_t blockSize = 64 * 1024)
+        : blockSize_(blockSize) {}
+
+    FrameArena(const FrameArena&) = delete;
+    FrameArena& operator=(const FrameArena&) = delete;
+
+    void reset() {
+        cur_ = 0;
+        offset_ = 0;
+    }
+
+    [[nodiscard]] size_t capacity() const {
+        size_t total = 0;
+        for (const auto& b : blocks_)
+            total += b.size;
+        return total;
+    }
+
+private:
+    struct Block {
+        std::unique_ptr<std::byte[]> data;
+        size_t size;
+    };
+
+    size_t blockSize_;
+    std::vector<Block> blocks_;
+    size_t cur_{0};     // текущий блок
+    size_t offset_{0};  // занято в текущем блоке
+
+    void* bump(Block& b, size_t bytes, size_t align) {
+        void* p = b.data.get() + offset_;
+        size_t space = b.size - offset_;
+        if (!std::align(align, bytes, p, space))
+            return nullptr;
+        offset_ = b.size - space + bytes;
+        return p;
+    }
+
+    void* do_allocate(size_t bytes, size_t align) override {
+        while (cur_ < blocks_.size()) {
+            if (void* p = bump(blocks_[cur_], bytes, align))
+                return p;
+            ++cur_;
+            offset_ = 0;
+        }
+
+        size_t size = std::max(blockSize_, bytes + align);
+        blocks_.push_back({std::make_unique<std::byte[]>(size), size});
+        cur_ = blocks_.size() - 1;
+        offset_ = 0;
+        return bump(blocks_[cur_], bytes, align);
+    }
+
+    void do_deallocate(void*, size_t, size_t) override {}
+
+    [[nodiscard]] bool do_is_equal(
+        const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+};
+
+}  // namespace sim
@@ -1,6 +1,10 @@
 #include "geometry.h"
+#include <algorithm>
+#include <array>
 #include <cassert>
+#include <cmath>
 #include <limits>
+#include <numbers>
 
 namespace sim {
 
@@ -10,9 +14,24 @@ Polyline::Polyline(std::vector<Vec2> pts) {
 
 void Polyline::setPoints(std::vector<Vec2> pts) {
     points_ = std::move(pts);
+    heading_.clear();
+    curvature_.clear();
+    invStep_ = 0.0;
     recomputeLengths();
 }
 
+void Polyline::setCurve(std::vector<Vec2> pts, std::vector<double> heading,
+                        std::vector<double> curvature) {
+    assert(heading.size() == pts.size() && curvature.size() == pts.size());
+    points_ = std::move(pts);
+    heading_ = std::move(heading);
+    curvature_ = std::move(curvature);
+    recomputeLengths();
+    invStep_ = (points_.size() >= 2 && totalLen_ > 1e-9)
+                   ? double(points_.size() - 1) / totalLen_
+                   : 0.0;
+}
+
 void Polyline::recomputeLengths() {
     accLen_.clear();
     totalLen_ = 0.0;
@@ -28,11 +47,18 @@ void Polyline::recomputeLengths() {
     }
 }
 
-std::pair<Vec2, Vec2> Polyline::sample(double s) const {
-    if (points_.size() < 2)
-        return {points_.empty() ? Vec2{} : points_.front(), Vec2{1, 0}};
-    s = clamp(s, 0.0, totalLen_);
-
+// Отрезок, на который приходится s (0 <= s <= length). При равном шаге
+// индекс считается сразу, хорды чуть короче дуги - отсюда подправка
+size_t Polyline::segmentAt(double s) const {
+    const size_t last = accLen_.size() - 2;
+    if (invStep_ > 0.0) {
+        size_t i = std::min(last, static_cast<size_t>(s * invStep_));
+        while (i < last && accLen_[i + 1] <= s)
+            ++i;
+        while (i > 0 && accLen_[i] > s)
+            --i;
+        return i;
+    }
     size_t lo = 0, hi = accLen_.size() - 1;
     while (lo + 1 < hi) {
         size_t mid = (lo + hi) / 2;
@@ -41,15 +67,42 @@ std::pair<Vec2, Vec2> Polyline::sample(double s) const {
         else
             hi = mid;
     }
+    return lo;
+}
+
+std::pair<Vec2, Vec2> Polyline::sample(double s) const {
+    if (points_.size() < 2)
+        return {points_.empty() ? Vec2{} : points_.front(), Vec2{1, 0}};
+    s = clamp(s, 0.0, totalLen_);
+
+    size_t lo = segmentAt(s);
     double segStart = accLen_[lo];
     double segLen = std::max(1e-9, accLen_[lo + 1] - accLen_[lo]);
     double t = (s - segStart) / segLen;
     Vec2 p0 = points_[lo], p1 = points_[lo + 1];
     Vec2 pos = p0 * (1.0 - t) + p1 * t;
     Vec2 tan = normalized(p1 - p0);
+    if (!heading_.empty()) {
+        // Дуга с поворотом dth на отрезке отходит от хорды наружу поворота
+        // на dth/2 * t(1-t) * h
+        double dth = heading_[lo + 1] - heading_[lo];
+        pos = pos - perpLeft(tan) * (0.5 * dth * t * (1.0 - t) * segLen);
+        double th = heading_[lo] + dth * t;
+        tan = {std::cos(th), std::sin(th)};
+    }
     return {pos, tan};
 }
 
+double Polyline::curvatureAt(double s) const {
+    if (curvature_.empty() || points_.size() < 2)
+        return 0.0;
+    s = clamp(s, 0.0, totalLen_);
+    size_t lo = segmentAt(s);
+    double segLen = std::max(1e-9, accLen_[lo + 1] - accLen_[lo]);
+    double t = (s - accLen_[lo]) / segLen;
+    return curvature_[lo] + (curvature_[lo + 1] - curvature_[lo]) * t;
+}
+
 Vec2 Polyline::normalAt(double s) const {
     auto [_, t] = sample(s);
     Vec2 n = perpLeft(t);
@@ -117,21 +170,151 @@ Vec2 cubicBezier(const Vec2& p0, const Vec2& p1, const Vec2& p2, const Vec2& p3,
            p3 * (t * t * t);
 }
 
-std::vector<Vec2> bezierConnector(const Vec2& p0, const Vec2& dir0,
-                                  const Vec2& p3, const Vec2& dir1,
-                                  double handleLen0, double handleLen1,
-                                  int steps) {
+namespace {
+
+struct Cubic {
+    Vec2 p0, p1, p2, p3;
+
+    [[nodiscard]] Vec2 at(double t) const {
+        return cubicBezier(p0, p1, p2, p3, t);
+    }
+
+    [[nodiscard]] Vec2 d1(double t) const {
+        double u = 1 - t;
+        return (p1 - p0) * (3 * u * u) + (p2 - p1) * (6 * u * t) +
+               (p3 - p2) * (3 * t * t);
+    }
+
+    [[nodiscard]] Vec2 d2(double t) const {
+        double u = 1 - t;
+        return (p2 - p1 * 2.0 + p0) * (6 * u) + (p3 - p2 * 2.0 + p1) * (6 * t);
+    }
+
+    [[nodiscard]] double curvature(double t) const {
+        Vec2 a = d1(t), b = d2(t);
+        double sp = norm(a);
+        return sp > 1e-9 ? cross(a, b) / (sp * sp * sp) : 0.0;
+    }
+
+    // Длина дуги на [t0, t1]: Гаусс-Лежандр по 5 узлам
+    [[nodiscard]] double length(double t0, double t1) const {
+        static constexpr std::array<double, 5> x{
+            0.0, -0.5384693101056831, 0.5384693101056831, -0.9061798459386640,
+            0.9061798459386640};
+        static constexpr std::array<double, 5> w{
+            0.5688888888888889, 0.4786286704993665, 0.4786286704993665,
+            0.2369268850561891, 0.2369268850561891};
+        double half = 0.5 * (t1 - t0), mid = 0.5 * (t0 + t1);
+        double sum = 0.0;
+        for (size_t i = 0; i < x.size(); ++i)
+            sum += w[i] * norm(d1(mid + half * x[i]));
+        return sum * half;
+    }
+};
+
+constexpr int kArcTable = 32; // интервалов таблицы s(t)
+constexpr int kMaxCurveSegments = 256;
+
+// Обратная длина дуги t(s): интервал таблицы, затем Ньютон по ds/dt = |B'|
+class ArcTable {
+public:
+    explicit ArcTable(const Cubic& c) : c_(c) {
+        for (int k = 0; k < kArcTable; ++k)
+            s_[k + 1] = s_[k] + c.length(double(k) / kArcTable,
+                                         double(k + 1) / kArcTable);
+    }
+
+    [[nodiscard]] double total() const { return s_[kArcTable]; }
+
+    [[nodiscard]] double tAt(double target) const {
+        if (target >= total())
+            return 1.0;
+        int k = static_cast<int>(std::upper_bound(s_.begin(), s_.end(), target) -
+                                 s_.begin()) - 1;
+        k = std::clamp(k, 0, kArcTable - 1);
+        double t0 = double(k) / kArcTable;
+        double span = s_[k + 1] - s_[k];
+        double t = t0 + (span > 0.0 ? (target - s_[k]) / span : 0.0) / kArcTable;
+        for (int it = 0; it < 3; ++it) {
+            double sp = norm(c_.d1(t));
+            if (sp < 1e-9)
+                break;
+            double err = s_[k] + c_.length(t0, t) - target;
+            t = std::clamp(t - err / sp, 0.0, 1.0);
+        }
+        return t;
+    }
+
+private:
+    const Cubic& c_;
+    std::array<double, kArcTable + 1> s_{};
+};
+
+// Наибольшее отклонение дуги от хорды при n равных отрезках (по
+// четвертям отрезка: пик кривизны может прийтись не на середину)
+double chordError(const Cubic& c, const ArcTable& arc, int n) {
+    double err = 0.0;
+    Vec2 a = c.p0;
+    for (int i = 1; i <= n; ++i) {
+        Vec2 b = c.at(arc.tAt(arc.total() * i / n));
+        Vec2 ab = b - a;
+        double len = norm(ab);
+        for (double q : {0.25, 0.5, 0.75}) {
+            Vec2 m = c.at(arc.tAt(arc.total() * (i - 1 + q) / n));
+            err = std::max(err, len > 1e-9 ? std::abs(cross(ab, m - a)) / len
+                                            : norm(m - a));
+        }
+        a = b;
+    }
+    return err;
+}
+
+} // namespace
+
+CurveSamples bezierConnector(const Vec2& p0, const Vec2& dir0, const Vec2& p3,
+                             const Vec2& dir1, double handleLen0,
+                             double handleLen1, double maxChordError) {
     Vec2 n0 = normalized(dir0);
     Vec2 n1 = normalized(dir1);
-    Vec2 p1 = p0 + n0 * handleLen0;
-    Vec2 p2 = p3 - n1 * handleLen1;
-    std::vector<Vec2> pts;
-    pts.reserve(steps + 1);
-    for (int i = 0; i <= steps; ++i) {
-        double t = double(i) / steps;
-        pts.push_back(cubicBezier(p0, p1, p2, p3, t));
-    }
-    return pts;
+    const Cubic c{p0, p0 + n0 * handleLen0, p3 - n1 * handleLen1, p3};
+    const ArcTable arc(c);
+    const double eps = std::max(1e-4, maxChordError);
+
+    // Начальное число отрезков - по интегралу sqrt(kappa / 8eps) ds (столько
+    // нужно при шаге под местную кривизну); при равном шаге его не всегда
+    // хватает, тогда дробим, пока отклонение не уложится в допуск
+    double need = 0.0;
+    for (int k = 0; k < kArcTable; ++k) {
+        double t0 = double(k) / kArcTable, t1 = double(k + 1) / kArcTable;
+        need += c.length(t0, t1) *
+                std::sqrt(std::abs(c.curvature(0.5 * (t0 + t1))) / (8.0 * eps));
+    }
+    int n = std::clamp(static_cast<int>(std::ceil(need)), 1, kMaxCurveSegments);
+    while (n < kMaxCurveSegments && chordError(c, arc, n) > eps)
+        n = std::min(kMaxCurveSegments, n + std::max(1, n / 4));
+
+    CurveSamples out;
+    out.points.reserve(n + 1);
+    out.heading.reserve(n + 1);
+    out.curvature.reserve(n + 1);
+    for (int i = 0; i <= n; ++i) {
+        double t = arc.tAt(arc.total() * i / n);
+        Vec2 d = c.d1(t);
+        if (norm(d) < 1e-9)
+            d = i == 0 ? n0 : n1;
+        double th = std::atan2(d.y, d.x);
+        if (!out.heading.empty()) {
+            double prev = out.heading.back();
+            while (th - prev > std::numbers::pi)
+                th -= 2.0 * std::numbers::pi;
+            while (th - prev < -std::numbers::pi)
+                th += 2.0 * std::numbers::pi;
+        }
+        out.points.push_back(c.at(t));
+        out.heading.push_back(th);
+        out.curvature.push_back(c.curvature(t));
+    }
+    return out;
 }
 
 }  // namespace sim
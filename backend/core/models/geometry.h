@@ -5,6 +5,9 @@
 
 namespace sim {
 
+// Допуск хорды для кривых: отклонение отрезка от дуги, м
+constexpr double kCurveChordError = 0.05;
+
 class Polyline {
    public:
     Polyline() = default;
@@ -13,12 +16,30 @@ class Polyline {
 
     void setPoints(std::vector<Vec2> pts);
 
+    // Кривая с равным шагом по длине: в вершинах заданы курс (без скачков
+    // на 2pi) и кривизна, между вершинами выборка идёт по дуге
+    void setCurve(std::vector<Vec2> pts, std::vector<double> heading,
+                  std::vector<double> curvature);
+
     [[nodiscard]] const std::vector<Vec2>& points() const { return points_; }
 
     [[nodiscard]] double length() const { return totalLen_; }
 
     [[nodiscard]] bool empty() const { return points_.size() < 2; }
 
+    // Длина до каждой вершины
+    [[nodiscard]] const std::vector<double>& stations() const { return accLen_; }
+
+    // Курс в вершинах (рад, без скачков); пусто у ломаных без кривой
+    [[nodiscard]] const std::vector<double>& heading() const { return heading_; }
+
+    // Кривизна в вершинах (1/м, + налево); пусто у ломаных без кривой
+    [[nodiscard]] const std::vector<double>& curvature() const {
+        return curvature_;
+    }
+
+    [[nodiscard]] double curvatureAt(double s) const;
+
     // Выборка точки и касательной по длине s вдоль кривой [0..length]
     [[nodiscard]] std::pair<Vec2, Vec2> sample(double s) const;
 
@@ -35,8 +56,12 @@ class Polyline {
    private:
     std::vector<Vec2> points_;
     std::vector<double> accLen_;
+    std::vector<double> heading_;
+    std::vector<double> curvature_;
     double totalLen_{0.0};
+    double invStep_{0.0}; // 1/шаг при равном шаге, иначе 0
     void recomputeLengths();
+    [[nodiscard]] size_t segmentAt(double s) const;
 };
 
 std::vector<Vec2> offsetPolyline(const std::vector<Vec2>& pts, double offset);
@@ -44,9 +69,18 @@ std::vector<Vec2> offsetPolyline(const std::vector<Vec2>& pts, double offset);
 Vec2 cubicBezier(const Vec2& p0, const Vec2& p1, const Vec2& p2, const Vec2& p3,
                  double t);
 
-std::vector<Vec2> bezierConnector(const Vec2& p0, const Vec2& dir0,
-                                  const Vec2& p3, const Vec2& dir1,
-                                  double handleLen0, double handleLen1,
-                                  int steps);
+struct CurveSamples {
+    std::vector<Vec2> points;
+    std::vector<double> heading;
+    std::vector<double> curvature;
+};
+
+// Кубическая Безье коннектора, выбранная с равным шагом по длине дуги.
+// Шаг h подбирается по наибольшей кривизне: хорда отходит от дуги на
+// kappa*h^2/8, это не больше maxChordError.
+CurveSamples bezierConnector(const Vec2& p0, const Vec2& dir0, const Vec2& p3,
+                             const Vec2& dir1, double handleLen0,
+                             double handleLen1,
+                             double maxChordError = kCurveChordError);
 
 }  // namespace sim
@@ -0,0 +1,125 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <type_traits>
+#include <vector>
+#include "sim_math.h"
+
+namespace sim {
+
+// Целая степень, разворачивается в умножения на этапе компиляции
+template <int N, typename R = double>
+constexpr R ipow(R x) {
+    static_assert(N >= 0, "ipow: only non-negative exponents");
+    if constexpr (N == 0) {
+        return R(1);
+    } else if constexpr (N % 2 == 0) {
+        R h = ipow<N / 2>(x);
+        return h * h;
+    } else {
+        return x * ipow<N - 1>(x);
+    }
+}
+
+// Показатель свободного разгона в IDM
+inline constexpr int kIdmDelta = 4;
+
+// Допуск пакетного ядра относительно формулы с std::pow:
+// |a_batch - a_ref| <= kIdmTolerance * max(1, |a_ref|).
+// ipow даёт ошибку порядка нескольких ulp, запас берём с избытком;
+// в float входы уже округлены до 24 бит, отсюда 1e-5.
+inline constexpr double kIdmTolerance =
+    std::is_same_v<Real, float> ? 1e-5 : 1e-9;
+
+// IDM для одной машины (скалярный путь)
+template <int Delta = kIdmDelta>
+inline double idmAccelScalar(double v, double vFront, double gap, double a,
+                             double b, double T, double s0, double v0) {
+    gap = std::max(0.1, gap);
+    double dv = v - vFront;
+    double sStar = s0 + std::max(0.0, v * T + v * dv / (2.0 * std::sqrt(a * b)));
+    double termFree = 1.0 - ipow<Delta>(std::max(0.0, v) / v0);
+    double ratio = sStar / gap;
+    return a * (termFree - ratio * ratio);
+}
+
+// Исходная формула через std::pow - эталон для проверки ядра
+inline double idmAccelReference(double v, double vFront, double gap, double a,
+                                double b, double T, double s0, double v0) {
+    gap = std::max(0.1, gap);
+    double dv = v - vFront;
+    double sStar = s0 + std::max(0.0, v * T + v * dv / (2.0 * std::sqrt(a * b)));
+    double termFree = 1.0 - std::pow(std::max(0.0, v) / v0, 4.0);
+    double termInteract = -std::pow(sStar / gap, 2.0);
+    return a * (termFree + termInteract);
+}
+
+// Входы IDM всех машин тика по столбцам (SoA), чтобы ядро векторизовалось.
+// Константы водителя (1/v0, 1/(2*sqrt(a*b))) считаются при добавлении строки:
+// в цикле не остаётся sqrt, который без -fno-math-errno не векторизуется.
+// R - скаляр столбцов (Real по умолчанию).
+template <typename R>
+struct IdmBatchT {
+    std::vector<R> v, vFront, gap;
+    std::vector<R> a, T, s0, invV0, invBrake;
+    std::vector<R> out;
+
+    [[nodiscard]] size_t size() const { return v.size(); }
+
+    void clear() {
+        v.clear();
+        vFront.clear();
+        gap.clear();
+        a.clear();
+        T.clear();
+        s0.clear();
+        invV0.clear();
+        invBrake.clear();
+        out.clear();
+    }
+
+    int push(double v_, double vFront_, double gap_, double a_, double b_,
+             double T_, double s0_, double v0_) {
+        v.push_back(R(v_));
+        vFront.push_back(R(vFront_));
+        gap.push_back(R(gap_));
+        a.push_back(R(a_));
+        T.push_back(R(T_));
+        s0.push_back(R(s0_));
+        invV0.push_back(R(1.0 / v0_));
+        invBrake.push_back(R(1.0 / (2.0 * std::sqrt(a_ * b_))));
+        out.push_back(R(0));
+        return static_cast<int>(v.size()) - 1;
+    }
+};
+
+using IdmBatch = IdmBatchT<Real>;
+
+// IDM для всех строк пакета за один проход, без ветвлений внутри цикла
+template <int Delta = kIdmDelta, typename R>
+void idmAccelBatch(IdmBatchT<R>& batch) {
+    const size_t n = batch.size();
+    const R* __restrict v = batch.v.data();
+    const R* __restrict vf = batch.vFront.data();
+    const R* __restrict gap = batch.gap.data();
+    const R* __restrict a = batch.a.data();
+    const R* __restrict T = batch.T.data();
+    const R* __restrict s0 = batch.s0.data();
+    const R* __restrict invV0 = batch.invV0.data();
+    const R* __restrict invBrake = batch.invBrake.data();
+    R* __restrict out = batch.out.data();
+
+#pragma GCC ivdep
+    for (size_t i = 0; i < n; ++i) {
+        R g = std::max(R(0.1), gap[i]);
+        R dv = v[i] - vf[i];
+        R dyn = v[i] * T[i] + v[i] * dv * invBrake[i];
+        R sStar = s0[i] + std::max(R(0), dyn);
+        R termFree = R(1) - ipow<Delta>(std::max(R(0), v[i]) * invV0[i]);
+        R ratio = sStar / g;
+        out[i] = a[i] * (termFree - ratio * ratio);
+    }
+}
+
+}  // namespace sim
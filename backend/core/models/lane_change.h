@@ -0,0 +1,115 @@
+#pragma once
+#include <concepts>
+#include "vehicle.h"
+
+namespace sim {
+
+// Политика перестроения: принять ли интервал в целевой полосе
+// (visible - машины целевой полосы по возрастанию расстояния) и можно
+// ли при отказе просить соседей уступить. Если интервал не принят и
+// договариваться нельзя, машина ждёт до PlanningTimeout.
+template <typename P>
+concept LaneChangePolicy =
+    requires(const Vehicle& ego, const VisibleVehicles& visible, double dt) {
+        { P::kModel } -> std::convertible_to<LaneChangeModel>;
+        { P::kNegotiates } -> std::convertible_to<bool>;
+        { P::accept(ego, visible, dt) } -> std::same_as<bool>;
+    };
+
+// Прежняя логика: запас по зазору и времени до сближения с каждой
+// машиной целевой полосы, при отказе - запросы уступить
+struct CooperativeLaneChange {
+    static constexpr LaneChangeModel kModel = LaneChangeModel::Cooperative;
+    static constexpr bool kNegotiates = true;
+
+    static bool accept(const Vehicle& ego, const VisibleVehicles& visible,
+                       double) {
+        const double frontGapMin = ego.params().minGap * 1.5;
+        const double rearGapMin = ego.params().minGap * 1.5;
+        const double t_req = ego.driver().laneChangeDuration * 1.2;
+
+        for (const auto& vv : visible) {
+            const Vehicle* o = vv.vehicle;
+            double gap = Vehicle::signedLongitudinalGap(&ego, o);
+
+            if (gap >= 0.0) {
+                double closing = ego.v() - o->v();
+                if (gap < frontGapMin)
+                    return false;
+                if (closing > 0.0 && gap / closing < t_req)
+                    return false;
+            } else {
+                double gapBehind = -gap;
+                double closing = o->v() - ego.v();
+                if (gapBehind < rearGapMin)
+                    return false;
+                if (closing > 0.0 && gapBehind / closing < t_req)
+                    return false;
+            }
+        }
+        return true;
+    }
+};
+
+// MOBIL (Kesting, Treiber, Helbing 2007). Безопасность: новый задний не
+// тормозит сильнее maxDecel, и сами за новым лидером тоже. Стимул: свой
+// выигрыш в ускорении плюс politeness * выигрыш нового заднего больше
+// порога. Все перестроения здесь обязательные (шаг маршрута), поэтому
+// порог сдвинут на kMandatoryBias; старый задний не учитывается - его
+// выигрыш от нашего ухода только облегчил бы перестроение.
+// Ускорения считаются моделью следования каждой машины.
+struct MobilLaneChange {
+    static constexpr LaneChangeModel kModel = LaneChangeModel::Mobil;
+    static constexpr bool kNegotiates = false;
+
+    static constexpr double kThreshold = 0.1;     // м/с^2
+    static constexpr double kMandatoryBias = 1.0; // м/с^2
+
+    static bool accept(const Vehicle& ego, const VisibleVehicles& visible,
+                       double dt) {
+        const Vehicle* leader = nullptr;
+        const Vehicle* follower = nullptr;
+        double leaderGap = 1e9;
+        double followerGap = 1e9;
+        for (const auto& vv : visible) {
+            double gap = Vehicle::signedLongitudinalGap(&ego, vv.vehicle);
+            if (gap >= 0.0 && gap < leaderGap) {
+                leader = vv.vehicle;
+                leaderGap = gap;
+            } else if (gap < 0.0 && -gap < followerGap) {
+                follower = vv.vehicle;
+                followerGap = -gap;
+            }
+        }
+
+        const double bSafe = ego.params().maxDecel;
+        double egoAfter = ego.followingAccel(
+            leader ? leader->v() : ego.params().desiredSpeed, leaderGap, dt);
+        if (egoAfter < -bSafe)
+            return false;
+
+        double followerGain = 0.0;
+        if (follower) {
+            double after = follower->followingAccel(ego.v(), followerGap, dt);
+            if (after < -bSafe)
+                return false;
+            followerGain = after - follower->a();
+        }
+
+        double incentive = egoAfter - ego.a() +
+                           ego.driver().politeness * followerGain;
+        return incentive > kThreshold - kMandatoryBias;
+    }
+};
+
+// Вызов политики перестроения по значению перечисления
+template <typename F>
+decltype(auto) visitLaneChangeModel(LaneChangeModel m, F&& f) {
+    static_assert(LaneChangePolicy<CooperativeLaneChange> &&
+                  LaneChangePolicy<MobilLaneChange>);
+    if (m == LaneChangeModel::Mobil)
+        return f(MobilLaneChange{});
+    return f(CooperativeLaneChange{});
+}
+
+} // namespace sim
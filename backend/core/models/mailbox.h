@@ -0,0 +1,27 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+namespace sim {
+
+// Сообщения между машинами. Пишутся во время шага, доставляются
+// в отдельной фазе после него (Simulation::deliverMessages), поэтому
+// шаг машины не меняет состояние других машин.
+enum class MessageType : uint8_t {
+    YieldRequest, // пропусти меня в свою полосу
+    YieldGrant,   // пропускаю (ответ на запрос с тем же epoch)
+    YieldCancel   // перестроение закончено или отменено, можно ехать
+};
+
+struct VehicleMessage {
+    uint64_t from{0};
+    uint64_t to{0};
+    MessageType type{MessageType::YieldRequest};
+    bool urgent{false};
+    uint32_t epoch{0}; // номер попытки перестроения отправителя запроса
+    uint32_t seq{0};   // порядок отправки, ставит фаза обмена
+};
+
+using Mailbox = std::vector<VehicleMessage>;
+
+} // namespace sim
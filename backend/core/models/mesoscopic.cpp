@@ -0,0 +1,260 @@
+#include "mesoscopic.h"
+#include <algorithm>
+#include <cmath>
+
+namespace sim {
+
+void MesoModel::configure(const RoadNetwork& net,
+                          const std::vector<MicroZone>& zones) {
+    const size_t n = static_cast<size_t>(net.maxLaneId()) + 1;
+    micro_.assign(n, {});
+    queues_.resize(n);
+
+    // Подходы к перекрёстку и выходы из него: по коннекторам
+    std::vector<bool> feedsJunction(n, false), fedByJunction(n, false);
+    for (const auto& [id, L] : net.lanes()) {
+        if (!L.isConnector)
+            continue;
+        if (L.connectorFrom)
+            feedsJunction[*L.connectorFrom] = true;
+        if (L.connectorTo)
+            fedByJunction[*L.connectorTo] = true;
+    }
+
+    const double step = 1.0;
+    for (const auto& [id, L] : net.lanes()) {
+        double len = L.length();
+        auto& out = micro_[id];
+        if (L.isConnector) {
+            out.emplace_back(0.0, len);
+            continue;
+        }
+
+        // Выборка по полосе с шагом в метр, подряд идущие точки в зоне
+        // склеиваются в участки
+        int samples = static_cast<int>(std::ceil(len / step));
+        double runStart = -1.0;
+        for (int i = 0; i <= samples; ++i) {
+            double s = std::min(len, i * step);
+            Pose p = L.poseAt(s);
+            bool inside = (feedsJunction[id] && s >= len - approach_) ||
+                          (fedByJunction[id] && s <= exit_);
+            for (const MicroZone& z : zones) {
+                if (inside)
+                    break;
+                inside = z.contains(Vec2(p.x, p.y));
+            }
+            if (inside && runStart < 0.0)
+                runStart = s;
+            if (!inside && runStart >= 0.0) {
+                out.emplace_back(runStart, s);
+                runStart = -1.0;
+            }
+        }
+        if (runStart >= 0.0)
+            out.emplace_back(runStart, len);
+    }
+}
+
+bool MesoModel::isMicro(LaneId lane, double s) const {
+    if (!enabled_)
+        return true;
+    if (lane < 0 || lane >= static_cast<LaneId>(micro_.size()))
+        return true;
+    for (const Interval& iv : micro_[lane]) {
+        if (s >= iv.first && s <= iv.second)
+            return true;
+    }
+    return false;
+}
+
+double MesoModel::nextBoundary(LaneId lane, double s, double len) const {
+    for (const Interval& iv : micro_[lane]) {
+        if (iv.first >= s)
+            return iv.first;
+    }
+    return len;
+}
+
+double MesoModel::mesoLength(LaneId lane, double len) const {
+    double micro = 0.0;
+    for (const Interval& iv : micro_[lane])
+        micro += iv.second - iv.first;
+    return std::max(len - micro, jamSpacing_);
+}
+
+LaneId MesoModel::nextRouteLane(const MesoVehicle& mv) const {
+    const RoutePlan& rp = mv.route.plan();
+    for (int i = rp.startIndex; i < (int)rp.steps().size(); ++i) {
+        if (rp.steps()[i].lane == mv.lane) {
+            if (i + 1 < (int)rp.steps().size())
+                return rp.steps()[i + 1].lane;
+            return -1;
+        }
+    }
+    return -1;
+}
+
+void MesoModel::settleLateral(MesoVehicle& mv, const RoadNetwork& net) const {
+    while (true) {
+        const Lane* L = net.getLane(mv.lane);
+        LaneId next = nextRouteLane(mv);
+        if (!L || next < 0 || (L->left != next && L->right != next))
+            return;
+        const Lane* N = net.getLane(next);
+        if (!N)
+            return;
+        mv.s = Real(std::min<double>(mv.s, N->length()));
+        mv.lane = next;
+    }
+}
+
+void MesoModel::enqueue(MesoVehicle mv) {
+    auto& q = queues_[mv.lane];
+    auto it = std::find_if(q.begin(), q.end(), [&](const MesoVehicle& o) {
+        return o.s < mv.s;
+    });
+    q.insert(it, std::move(mv));
+}
+
+void MesoModel::insert(MesoVehicle mv, const RoadNetwork& net) {
+    settleLateral(mv, net);
+    mv.tick = tick_;
+    enqueue(std::move(mv));
+}
+
+void MesoModel::step(double dt, const RoadNetwork& net,
+                     const CanEnter& canEnter,
+                     std::vector<MesoVehicle>& toMicro,
+                     std::vector<uint64_t>& finished) {
+    if (dt <= 0.0)
+        return;
+    ++tick_;
+
+    for (LaneId lane = 0; lane < static_cast<LaneId>(queues_.size()); ++lane) {
+        auto& q = queues_[lane];
+        if (q.empty())
+            continue;
+        const Lane* L = net.getLane(lane);
+        if (!L)
+            continue;
+        const double len = L->length();
+
+        // Зоны могли поменяться: оказавшиеся внутри сразу уходят в микро
+        for (size_t i = 0; i < q.size();) {
+            if (isMicro(lane, q[i].s) && canEnter(lane, q[i].s)) {
+                toMicro.push_back(std::move(q[i]));
+                q.erase(q.begin() + static_cast<std::ptrdiff_t>(i));
+            } else {
+                ++i;
+            }
+        }
+
+        // Равновесная скорость участка по плотности
+        double k = static_cast<double>(q.size()) / mesoLength(lane, len);
+        double frac = std::clamp(1.0 - k * jamSpacing_, minSpeedFrac_, 1.0);
+        double vEq = L->speedLimit * frac;
+
+        for (size_t i = 0; i < q.size(); ++i) {
+            MesoVehicle& mv = q[i];
+            if (mv.tick == tick_)
+                continue;
+            mv.tick = tick_;
+
+            double vWish = std::min(vEq, mv.params.desiredSpeed);
+            double v = std::min(vWish, mv.v + mv.params.maxAccel * dt);
+            double target = mv.s + v * dt;
+            if (i > 0)
+                target = std::min(target, q[i - 1].s - jamSpacing_);
+            target = std::min(target, nextBoundary(lane, mv.s, len));
+            target = std::max<double>(target, mv.s);
+
+            mv.v = (target - mv.s) / dt;
+            mv.s = target;
+        }
+
+        // Голова очереди на границе: в микро, на следующую полосу или с карты
+        while (!q.empty()) {
+            MesoVehicle& head = q.front();
+            double boundary = nextBoundary(lane, head.s, len);
+            if (head.s < boundary - 1e-9)
+                break;
+
+            if (boundary < len) {
+                if (!canEnter(lane, boundary))
+                    break;
+                head.s = boundary;
+                toMicro.push_back(std::move(head));
+                q.erase(q.begin());
+                continue;
+            }
+
+            LaneId next = nextRouteLane(head);
+            if (next < 0) {
+                finished.push_back(head.id);
+                q.erase(q.begin());
+                continue;
+            }
+
+            if (isMicro(next, 0.0)) {
+                if (!canEnter(next, 0.0))
+                    break;
+                head.lane = next;
+                head.s = 0.0;
+                head.route.advanceIfEntered(next);
+                toMicro.push_back(std::move(head));
+                q.erase(q.begin());
+                continue;
+            }
+
+            // Въезд в хвост мезо-очереди следующей полосы, если есть место
+            const auto& nq = queues_[next];
+            if (!nq.empty() && nq.back().s < jamSpacing_)
+                break;
+            MesoVehicle mv = std::move(head);
+            q.erase(q.begin());
+            mv.lane = next;
+            mv.s = 0.0;
+            mv.route.advanceIfEntered(next);
+            settleLateral(mv, net);
+            enqueue(std::move(mv));
+        }
+
+        for (MesoVehicle& mv : q) {
+            if (mv.s >= nextBoundary(lane, mv.s, len) - 1e-9)
+                mv.v = 0.0;
+        }
+    }
+}
+
+bool MesoModel::hasVehicleWithin(LaneId lane, double s0, double s1) const {
+    if (lane < 0 || lane >= static_cast<LaneId>(queues_.size()))
+        return false;
+    for (const MesoVehicle& mv : queues_[lane]) {
+        if (mv.s >= s0 && mv.s <= s1)
+            return true;
+    }
+    return false;
+}
+
+void MesoModel::drain(std::vector<MesoVehicle>& out) {
+    for (auto& q : queues_) {
+        for (MesoVehicle& mv : q)
+            out.push_back(std::move(mv));
+        q.clear();
+    }
+}
+
+void MesoModel::clear() {
+    for (auto& q : queues_)
+        q.clear();
+}
+
+size_t MesoModel::size() const {
+    size_t n = 0;
+    for (const auto& q : queues_)
+        n += q.size();
+    return n;
+}
+
+} // namespace sim
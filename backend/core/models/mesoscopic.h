@@ -0,0 +1,134 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+#include "road_network.h"
+#include "routing.h"
+#include "vehicle.h"
+
+namespace sim {
+
+// Область, где машины моделируются полностью (Vehicle): круг или прямоугольник
+struct MicroZone {
+    Vec2 min, max;
+    Vec2 center;
+    double radius{-1.0};
+
+    static MicroZone circle(const Vec2& c, double r) {
+        MicroZone z;
+        z.center = c;
+        z.radius = r;
+        return z;
+    }
+
+    static MicroZone rect(const Vec2& a, const Vec2& b) {
+        MicroZone z;
+        z.min = Vec2(std::min(a.x, b.x), std::min(a.y, b.y));
+        z.max = Vec2(std::max(a.x, b.x), std::max(a.y, b.y));
+        return z;
+    }
+
+    [[nodiscard]] bool contains(const Vec2& p) const {
+        if (radius >= 0.0) {
+            double dx = p.x - center.x, dy = p.y - center.y;
+            return dx * dx + dy * dy <= radius * radius;
+        }
+        return p.x >= min.x && p.x <= max.x && p.y >= min.y && p.y <= max.y;
+    }
+};
+
+// Машина вне микро-зон: только положение в очереди полосы, скорость и маршрут.
+// При переходе в зону из неё собирается Vehicle с тем же id.
+struct MesoVehicle {
+    uint64_t id;
+    VehicleParams params;
+    DriverProfile driver;
+    RouteTracker route;
+    LaneId lane;
+    Real s;
+    Real v;
+    uint64_t tick{0}; // последний шаг, чтобы не двигать дважды за тик
+
+    [[nodiscard]] Pose pose(const RoadNetwork& net) const {
+        const Lane* L = net.getLane(lane);
+        return L ? L->poseAt(s) : Pose{};
+    }
+};
+
+// Мезоскопическая модель полос: каждая полоса - очередь машин,
+// скорость задаётся плотностью на мезо-участке (Гриншилдс):
+// v = vf * (1 - k / kJam), без обгонов, с шагом не меньше jamSpacing.
+// Коннекторы и подходы к ним всегда микро, чтобы светофоры,
+// уступки и перестроения считала полная модель.
+class MesoModel {
+public:
+    // Можно ли поставить машину в микро-модель в точке (lane, s)
+    using CanEnter = std::function<bool(LaneId, double)>;
+
+    void configure(const RoadNetwork& net, const std::vector<MicroZone>& zones);
+
+    void setEnabled(bool on) { enabled_ = on; }
+    [[nodiscard]] bool enabled() const { return enabled_; }
+
+    // Длина микро-участка перед въездом на перекрёсток и после выезда
+    void setApproachLengths(double before, double after) {
+        approach_ = before;
+        exit_ = after;
+    }
+
+    [[nodiscard]] bool isMicro(LaneId lane, double s) const;
+
+    void insert(MesoVehicle mv, const RoadNetwork& net);
+
+    // Шаг очередей. Дошедшие до микро-зоны и пропущенные canEnter
+    // уходят в toMicro, закончившие маршрут - в finished.
+    void step(double dt, const RoadNetwork& net, const CanEnter& canEnter,
+              std::vector<MesoVehicle>& toMicro,
+              std::vector<uint64_t>& finished);
+
+    [[nodiscard]] bool hasVehicleWithin(LaneId lane, double s0,
+                                        double s1) const;
+
+    // Все машины обратно в микро (выключение гибридного режима)
+    void drain(std::vector<MesoVehicle>& out);
+
+    void clear();
+
+    [[nodiscard]] size_t size() const;
+
+    template <class F>
+    void forEach(F&& f) const {
+        for (const auto& q : queues_)
+            for (const MesoVehicle& mv : q)
+                f(mv);
+    }
+
+private:
+    using Interval = std::pair<double, double>;
+
+    bool enabled_{false};
+    double approach_{40.0};
+    double exit_{15.0};
+    double jamSpacing_{7.0}; // м на машину в пробке (1 / kJam)
+    double minSpeedFrac_{0.05}; // чтобы очередь не вставала намертво
+    uint64_t tick_{0};
+
+    // По id полосы: микро-участки и очередь (спереди - дальше по полосе)
+    std::vector<std::vector<Interval>> micro_;
+    std::vector<std::vector<MesoVehicle>> queues_;
+
+    // Начало ближайшего микро-участка не раньше s (или конец полосы)
+    [[nodiscard]] double nextBoundary(LaneId lane, double s, double len) const;
+
+    [[nodiscard]] double mesoLength(LaneId lane, double len) const;
+
+    [[nodiscard]] LaneId nextRouteLane(const MesoVehicle& mv) const;
+
+    // Боковые шаги маршрута в мезо исполняются сразу
+    void settleLateral(MesoVehicle& mv, const RoadNetwork& net) const;
+
+    void enqueue(MesoVehicle mv);
+};
+
+} // namespace sim
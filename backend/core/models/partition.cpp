@@ -0,0 +1,144 @@
+#include "partition.h"
+#include <algorithm>
+#include <limits>
+#include <numeric>
+
+namespace sim {
+
+namespace {
+
+struct Box {
+    double x0{std::numeric_limits<double>::max()};
+    double y0{std::numeric_limits<double>::max()};
+    double x1{std::numeric_limits<double>::lowest()};
+    double y1{std::numeric_limits<double>::lowest()};
+
+    void add(const Vec2& p) {
+        x0 = std::min(x0, p.x);
+        y0 = std::min(y0, p.y);
+        x1 = std::max(x1, p.x);
+        y1 = std::max(y1, p.y);
+    }
+
+    [[nodiscard]] bool intersects(const Box& o, double pad) const {
+        return x0 - pad <= o.x1 && o.x0 <= x1 + pad && y0 - pad <= o.y1 &&
+               o.y0 <= y1 + pad;
+    }
+};
+
+Vec2 midpoint(const Lane& L) {
+    Pose p = L.poseAt(0.5 * L.length());
+    return {p.x, p.y};
+}
+
+int findRoot(std::vector<int>& parent, int i) {
+    while (parent[i] != i) {
+        parent[i] = parent[parent[i]];
+        i = parent[i];
+    }
+    return i;
+}
+
+} // namespace
+
+RegionPartition RegionPartition::build(const RoadNetwork& net,
+                                       double clusterRadius, double halo) {
+    RegionPartition out;
+    const size_t n = static_cast<size_t>(net.maxLaneId()) + 1;
+    out.laneRegion.assign(n, 0);
+    out.haloOf.assign(n, {});
+
+    // Полосы по возрастанию id: разбиение не зависит от порядка хеш-таблицы
+    std::vector<LaneId> ids;
+    ids.reserve(net.lanes().size());
+    for (const auto& [id, L] : net.lanes())
+        ids.push_back(id);
+    std::sort(ids.begin(), ids.end());
+
+    std::vector<LaneId> connectors;
+    std::vector<Vec2> mids;
+    for (LaneId id : ids) {
+        const Lane* L = net.getLane(id);
+        if (L->isConnector && !L->center.empty()) {
+            connectors.push_back(id);
+            mids.push_back(midpoint(*L));
+        }
+    }
+    if (connectors.empty())
+        return out;
+
+    std::vector<int> parent(connectors.size());
+    std::iota(parent.begin(), parent.end(), 0);
+    const double r2 = clusterRadius * clusterRadius;
+    for (size_t i = 0; i < mids.size(); ++i) {
+        for (size_t j = i + 1; j < mids.size(); ++j) {
+            double dx = mids[i].x - mids[j].x, dy = mids[i].y - mids[j].y;
+            if (dx * dx + dy * dy <= r2)
+                parent[findRoot(parent, static_cast<int>(i))] =
+                    findRoot(parent, static_cast<int>(j));
+        }
+    }
+
+    // Номера областей - в порядке первого коннектора кластера
+    std::vector<int> clusterOf(connectors.size(), -1);
+    std::vector<int> rootRegion(connectors.size(), -1);
+    std::vector<Vec2> centers;
+    std::vector<int> counts;
+    for (size_t i = 0; i < connectors.size(); ++i) {
+        int root = findRoot(parent, static_cast<int>(i));
+        if (rootRegion[root] < 0) {
+            rootRegion[root] = static_cast<int>(centers.size());
+            centers.emplace_back(0.0, 0.0);
+            counts.push_back(0);
+        }
+        int r = rootRegion[root];
+        clusterOf[i] = r;
+        centers[r] = centers[r] + mids[i];
+        counts[r]++;
+    }
+    for (size_t r = 0; r < centers.size(); ++r)
+        centers[r] = centers[r] * (1.0 / counts[r]);
+    out.regionCount = static_cast<int>(centers.size());
+
+    for (size_t i = 0; i < connectors.size(); ++i)
+        out.laneRegion[connectors[i]] = clusterOf[i];
+
+    for (LaneId id : ids) {
+        const Lane* L = net.getLane(id);
+        if (L->isConnector || L->center.empty())
+            continue;
+        Vec2 m = midpoint(*L);
+        int best = 0;
+        double bestD = std::numeric_limits<double>::max();
+        for (size_t r = 0; r < centers.size(); ++r) {
+            double dx = m.x - centers[r].x, dy = m.y - centers[r].y;
+            double d = dx * dx + dy * dy;
+            if (d < bestD) {
+                bestD = d;
+                best = static_cast<int>(r);
+            }
+        }
+        out.laneRegion[id] = best;
+    }
+
+    // Кайма: габариты области, расширенные на halo
+    std::vector<Box> regionBox(out.regionCount);
+    std::vector<Box> laneBox(n);
+    for (LaneId id : ids) {
+        const Lane* L = net.getLane(id);
+        for (const Vec2& p : L->center.points()) {
+            laneBox[id].add(p);
+            regionBox[out.laneRegion[id]].add(p);
+        }
+    }
+    for (LaneId id : ids) {
+        for (int r = 0; r < out.regionCount; ++r) {
+            if (r != out.laneRegion[id] &&
+                regionBox[r].intersects(laneBox[id], halo))
+                out.haloOf[id].push_back(r);
+        }
+    }
+    return out;
+}
+
+} // namespace sim
@@ -0,0 +1,29 @@
+#pragma once
+#include <vector>
+#include "road_network.h"
+
+namespace sim {
+
+// Разбиение сети на области по кластерам перекрёстков.
+// Коннекторы, чьи середины ближе clusterRadius, образуют один кластер,
+// обычная полоса отходит к кластеру, ближайшему к её середине
+// (обе стороны дороги и соседние полосы попадают в одну область).
+// Полосы чужих областей в пределах halo от области - её кайма:
+// машины на них видны области как «призраки» (снимок начала тика).
+struct RegionPartition {
+    int regionCount{1};
+    std::vector<int> laneRegion;             // по id полосы
+    std::vector<std::vector<int>> haloOf;    // по id полосы: области, где она кайма
+
+    static RegionPartition build(const RoadNetwork& net,
+                                 double clusterRadius = 40.0,
+                                 double halo = 80.0);
+
+    [[nodiscard]] int regionOf(LaneId lane) const {
+        if (lane < 0 || lane >= static_cast<LaneId>(laneRegion.size()))
+            return 0;
+        return laneRegion[lane];
+    }
+};
+
+} // namespace sim
@@ -75,7 +75,7 @@ RoadBuildResult RoadNetwork::addStraightRoad(const Vec2& A, const Vec2& B,
 
 LaneId RoadNetwork::addConnector(LaneId inLane, LaneId outLane,
                                  double handleLenIn, double handleLenOut,
-                                 int steps) {
+                                 double maxChordError) {
     assert(lanes_.count(inLane) && lanes_.count(outLane));
     const Lane& L_in = lanes_.at(inLane);
     const Lane& L_out = lanes_.at(outLane);
@@ -89,10 +89,13 @@ LaneId RoadNetwork::addConnector(LaneId inLane, LaneId outLane,
     auto [pOut1,tOut1] = L_out.center.sample(std::min(0.5, L_out.length()));
     tOut0 = normalized(tOut1);
 
-    auto pts = bezierConnector(pIn, tIn, pOut0, tOut0, handleLenIn,
-                               handleLenOut, steps);
-    LaneId conn = addLane(pts, L_in.end, L_out.start, L_in.width,
+    CurveSamples curve = bezierConnector(pIn, tIn, pOut0, tOut0, handleLenIn,
+                                         handleLenOut, maxChordError);
+    LaneId conn = addLane(curve.points, L_in.end, L_out.start, L_in.width,
                           std::min(L_in.speedLimit, L_out.speedLimit), true);
+    lanes_[conn].center.setCurve(std::move(curve.points),
+                                 std::move(curve.heading),
+                                 std::move(curve.curvature));
 
     lanes_[inLane].next.push_back(conn);
     lanes_[conn].next.push_back(outLane);
@@ -62,10 +62,11 @@ public:
                                     double speedLimit);
 
     // Создать коннектор между полосами (например,поворот налево/направо/прямо через перекрёсток)
-    // handleLen* управляют «радиусом» (длина опорных отрезков Безье)
+    // handleLen* управляют «радиусом» (длина опорных отрезков Безье),
+    // число точек подбирается по кривизне под допуск хорды maxChordError
     LaneId addConnector(LaneId inLane, LaneId outLane,
                         double handleLenIn, double handleLenOut,
-                        int steps = 16);
+                        double maxChordError = kCurveChordError);
 
     void setNeighbors(LaneId lane, std::optional<LaneId> left,
                       std::optional<LaneId> right);
@@ -80,6 +81,9 @@ public:
     const std::unordered_map<LaneId, Lane>& lanes() const { return lanes_; }
     const std::unordered_map<NodeId, Node>& nodes() const { return nodes_; }
 
+    // id полос идут подряд с 1: годится для плотных массивов по полосам
+    LaneId maxLaneId() const { return nextLaneId_ - 1; }
+
     struct LaneRender {
         LaneId id;
         double width;
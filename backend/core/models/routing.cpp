@@ -1,7 +1,8 @@
 #include "routing.h"
+#include <atomic>
 #include <limits>
 #include <cmath>
-#include <queue>
+#include <algorithm>
 
 namespace sim {
 
@@ -19,178 +20,536 @@ bool Goal::isSatisfied(LaneId atLane, const RoadNetwork& net) const {
     return false;
 }
 
-struct NodeRec {
-    LaneId lane;
-    double g;       // накопленная стоимость
-    double f;       // g + h
-    LaneId parent;  // предок
-    bool operator<(const NodeRec& o) const { return f > o.f; }
+namespace {
+
+// Рабочие массивы поиска одного потока. Запись полосы действительна,
+// только если её stamp равен номеру текущего запроса, так что между
+// запросами ничего не чистится, а память растёт только вместе с сетью.
+// Открытый список - двоичная куча с позициями полос (decrease-key).
+// Эвристика полосы (расстояние до ближайшей точки цели) считается один
+// раз на цель: пока запросы идут к той же цели той же сети, она берётся
+// из слота по своей метке hStamp. Цели-множества всегда считаются новыми.
+struct SearchWorkspace {
+    struct Slot {
+        double g{0.0};
+        double f{0.0};
+        double h{0.0};  // расстояние до цели, м
+        LaneId parent{-1};
+        int heapPos{-1};  // -1 - не в куче
+        uint32_t stamp{0};
+        uint32_t goalStamp{0};
+        uint32_t hStamp{0};
+    };
+
+    struct GoalKey {
+        uint64_t network{0};  // Pathfinder::searchId_
+        Goal::Type type{Goal::Type::LaneSet};
+        int target{-1};
+        bool operator==(const GoalKey&) const = default;
+    };
+
+    std::vector<Slot> slots;
+    std::vector<LaneId> heap;
+    std::vector<Vec2> goalPoints;  // точки текущей цели эвристики
+    std::vector<LaneId> path;
+    uint32_t generation{0};
+    GoalKey goalKey;
+    uint32_t hGeneration{0};
+
+    // Обратный Дейкстра таблицы следующих шагов (rebuildTarget)
+    std::vector<double> dist;
+    std::vector<std::pair<double, LaneId>> queue;
+
+    void begin(size_t lanes) {
+        if (slots.size() < lanes) {
+            slots.resize(lanes);
+            heap.reserve(lanes);
+            path.reserve(lanes);
+        }
+        heap.clear();
+        path.clear();
+        if (++generation == 0) {
+            for (Slot& s : slots)
+                s.stamp = s.goalStamp = 0;
+            generation = 1;
+        }
+    }
+
+    // true - цель сменилась: goalPoints очищены, их нужно заполнить
+    bool selectGoal(const GoalKey& key) {
+        if (hGeneration != 0 && key.type != Goal::Type::LaneSet &&
+            key == goalKey)
+            return false;
+        goalKey = key;
+        goalPoints.clear();
+        if (++hGeneration == 0) {
+            for (Slot& s : slots)
+                s.hStamp = 0;
+            hGeneration = 1;
+        }
+        return true;
+    }
+
+    double distanceToGoal(LaneId lane, const Vec2& laneEnd) {
+        Slot& s = slots[lane];
+        if (s.hStamp != hGeneration) {
+            s.hStamp = hGeneration;
+            double best = goalPoints.empty()
+                              ? 0.0
+                              : std::numeric_limits<double>::infinity();
+            for (const Vec2& g : goalPoints)
+                best = std::min(best, norm(g - laneEnd));
+            s.h = best;
+        }
+        return s.h;
+    }
+
+    Slot& touch(LaneId lane) {
+        Slot& s = slots[lane];
+        if (s.stamp != generation) {
+            s.stamp = generation;
+            s.g = std::numeric_limits<double>::infinity();
+            s.parent = -1;
+            s.heapPos = -1;
+        }
+        return s;
+    }
+
+    void place(size_t i, LaneId lane) {
+        heap[i] = lane;
+        slots[lane].heapPos = static_cast<int>(i);
+    }
+
+    void siftUp(size_t i) {
+        const LaneId lane = heap[i];
+        const double f = slots[lane].f;
+        while (i > 0) {
+            size_t parent = (i - 1) / 2;
+            if (slots[heap[parent]].f <= f)
+                break;
+            place(i, heap[parent]);
+            i = parent;
+        }
+        place(i, lane);
+    }
+
+    void siftDown(size_t i) {
+        const LaneId lane = heap[i];
+        const double f = slots[lane].f;
+        const size_t n = heap.size();
+        while (true) {
+            size_t child = 2 * i + 1;
+            if (child >= n)
+                break;
+            if (child + 1 < n && slots[heap[child + 1]].f < slots[heap[child]].f)
+                ++child;
+            if (slots[heap[child]].f >= f)
+                break;
+            place(i, heap[child]);
+            i = child;
+        }
+        place(i, lane);
+    }
+
+    // Добавить полосу или поднять её после уменьшения f
+    void push(LaneId lane) {
+        int pos = slots[lane].heapPos;
+        if (pos < 0) {
+            heap.push_back(lane);
+            pos = static_cast<int>(heap.size()) - 1;
+        }
+        siftUp(static_cast<size_t>(pos));
+    }
+
+    LaneId pop() {
+        const LaneId top = heap.front();
+        slots[top].heapPos = -1;
+        const LaneId last = heap.back();
+        heap.pop_back();
+        if (!heap.empty()) {
+            heap[0] = last;
+            siftDown(0);
+        }
+        return top;
+    }
 };
 
+thread_local SearchWorkspace t_search;
+
+// Номера построений таблиц (precompute) для ключа эвристики
+std::atomic<uint64_t> g_searchIds{0};
+
+} // namespace
+
 RoutePlan Pathfinder::plan(LaneId startLane, const Goal& goal) const {
+    if (laneCount_ == 0)
+        return planUnprepared(startLane, goal);
     RoutePlan out;
+    if (mode_ == RoutingMode::NextHop && planNextHop(startLane, goal, out))
+        return out;
+    return planAStar(startLane, goal);
+}
 
-    std::unordered_map<LaneId, double> bestG;
-    std::unordered_map<LaneId, LaneId> parent;
-    std::priority_queue<NodeRec> pq;
-
-    double h0 = heuristic(startLane, goal);
-    pq.push({startLane, 0.0, h0, -1});
-    bestG[startLane] = 0.0;
-
-    auto reconstruct = [&](LaneId goalLane) {
-        std::vector<LaneId> lanes;
-        LaneId cur = goalLane;
-        while (cur != -1) {
-            lanes.push_back(cur);
-            auto it = parent.find(cur);
-            cur = (it == parent.end()) ? -1 : it->second;
-        }
-        std::reverse(lanes.begin(), lanes.end());
-        out.steps.clear();
-        out.startIndex = 0;
-        out.steps.reserve(lanes.size());
-        for (auto lid : lanes) {
-            const Lane* L = net_->getLane(lid);
-            RouteStep st;
-            st.lane = lid;
-            if (L && L->isConnector) {
-                st.connectorFrom = L->connectorFrom;
-                st.connectorTo = L->connectorTo;
-            }
-            out.steps.push_back(st);
+bool Pathfinder::hasLane(LaneId lane) const {
+    return lane >= 0 && lane < static_cast<LaneId>(info_.size()) &&
+           info_[lane].exists;
+}
+
+RoutePlan Pathfinder::makePlan(const LaneId* lanes, size_t n,
+                               const Goal& goal) const {
+    auto data = std::make_shared<RouteData>();
+    data->goal = goal;
+    data->steps.reserve(n);
+    for (size_t i = 0; i < n; ++i) {
+        const Lane* L = net_->getLane(lanes[i]);
+        RouteStep st;
+        st.lane = lanes[i];
+        if (L && L->isConnector) {
+            st.connectorFrom = L->connectorFrom.value_or(-1);
+            st.connectorTo = L->connectorTo.value_or(-1);
         }
-        return out;
-    };
+        data->steps.push_back(st);
+    }
+    RoutePlan out;
+    out.data = std::move(data);
+    return out;
+}
 
-    while (!pq.empty()) {
-        NodeRec cur = pq.top();
-        pq.pop();
+bool Pathfinder::planNextHop(LaneId startLane, const Goal& goal,
+                             RoutePlan& out) const {
+    if (goal.type != Goal::Type::LaneSingle)
+        return false;
+    const LaneId target = goal.laneSingle;
+    if (!hasLane(target) || targetSlot_[target] < 0 || !hasLane(startLane))
+        return false;
 
-        if (goal.isSatisfied(cur.lane, *net_)) {
-            return reconstruct(cur.lane);
+    const LaneId* hop =
+        nextHop_.data() + static_cast<size_t>(targetSlot_[target]) * laneCount_;
+    SearchWorkspace& ws = t_search;
+    ws.begin(laneCount_);
+    LaneId cur = startLane;
+    ws.path.push_back(cur);
+    while (cur != target) {
+        cur = hop[cur];
+        if (cur < 0 || ws.path.size() >= laneCount_) {
+            // Пути нет: план пустой, но цель сохраняем
+            out = makePlan(nullptr, 0, goal);
+            return true;
         }
+        ws.path.push_back(cur);
+    }
+    out = makePlan(ws.path.data(), ws.path.size(), goal);
+    return true;
+}
+
+void Pathfinder::precompute(const std::vector<LaneId>& targets) {
+    double vmax = 1.0;
+    for (const auto& [id, L] : net_->lanes())
+        vmax = std::max(vmax, L.speedLimit);
+    vmax_ = vmax;
 
-        const Lane* L = net_->getLane(cur.lane);
+    laneCount_ = static_cast<size_t>(net_->maxLaneId()) + 1;
+    live_.clear();
+    searchId_ = ++g_searchIds;
+
+    // Плотные таблицы полос и переходы в порядке next, затем налево
+    info_.assign(laneCount_, {});
+    std::vector<uint32_t> predCount(laneCount_ + 1, 0);
+    succStart_.assign(laneCount_ + 1, 0);
+    succ_.clear();
+    for (LaneId id = 0; id < static_cast<LaneId>(laneCount_); ++id) {
+        succStart_[id] = static_cast<uint32_t>(succ_.size());
+        const Lane* L = net_->getLane(id);
         if (!L)
             continue;
+        LaneInfo& info = info_[id];
+        info.exists = true;
+        info.baseCost = std::max(1e-6, L->length() / std::max(1.0, L->speedLimit));
+        info.lateralCost = L->width / 3;
+        info.connector = L->isConnector;
+        info.left = L->left;
+        info.right = L->right;
+        info.endNode = L->end;
+        if (const Node* n = net_->getNode(L->end))
+            info.end = n->pos;
 
         for (LaneId nxt : L->next) {
-            const Lane* LN = net_->getLane(nxt);
-            if (!LN)
-                continue;
-            double w = edgeCost(cur.lane, nxt);
-            double gNew = cur.g + w;
-            if (!bestG.count(nxt) || gNew < bestG[nxt]) {
-                bestG[nxt] = gNew;
-                parent[nxt] = cur.lane;
-                double f = gNew + heuristic(nxt, goal);
-                pq.push({nxt, gNew, f, cur.lane});
+            if (net_->getLane(nxt))
+                succ_.push_back(nxt);
+        }
+        if (L->left != -1 && net_->getLane(L->left))
+            succ_.push_back(L->left);
+    }
+    succStart_[laneCount_] = static_cast<uint32_t>(succ_.size());
+
+    // Обратные переходы для таблицы следующих шагов
+    for (LaneId v : succ_)
+        predCount[v + 1]++;
+    for (size_t i = 0; i < laneCount_; ++i)
+        predCount[i + 1] += predCount[i];
+    predStart_ = predCount;
+    pred_.assign(succ_.size(), -1);
+    for (LaneId u = 0; u < static_cast<LaneId>(laneCount_); ++u) {
+        for (uint32_t k = succStart_[u]; k < succStart_[u + 1]; ++k)
+            pred_[predCount[succ_[k]]++] = u;
+    }
+
+    targets_.clear();
+    targetSlot_.assign(laneCount_, -1);
+    for (LaneId target : targets) {
+        if (!hasLane(target) || targetSlot_[target] >= 0)
+            continue;
+        targetSlot_[target] = static_cast<int>(targets_.size());
+        targets_.push_back(target);
+    }
+    nextHop_.assign(targets_.size() * laneCount_, -1);
+    for (size_t k = 0; k < targets_.size(); ++k)
+        rebuildTarget(k);
+}
+
+void Pathfinder::rebuildTarget(size_t k) {
+    const LaneId target = targets_[k];
+    LaneId* hop = nextHop_.data() + k * laneCount_;
+    std::fill(hop, hop + laneCount_, -1);
+
+    // Буферы потока: перестройка всех целей раз в период не трогает кучу
+    SearchWorkspace& ws = t_search;
+    std::vector<double>& dist = ws.dist;
+    auto& pq = ws.queue;
+    const std::greater<std::pair<double, LaneId>> later;
+    dist.assign(laneCount_, std::numeric_limits<double>::infinity());
+    pq.clear();
+    dist[target] = 0.0;
+    hop[target] = target;
+    pq.emplace_back(0.0, target);
+    while (!pq.empty()) {
+        std::pop_heap(pq.begin(), pq.end(), later);
+        auto [d, v] = pq.back();
+        pq.pop_back();
+        if (d > dist[v])
+            continue;
+        for (uint32_t i = predStart_[v]; i < predStart_[v + 1]; ++i) {
+            const LaneId u = pred_[i];
+            double du = d + edgeCost(u, v);
+            if (du < dist[u]) {
+                dist[u] = du;
+                hop[u] = v;
+                pq.emplace_back(du, u);
+                std::push_heap(pq.begin(), pq.end(), later);
             }
         }
-        if (L->left != -1) {
-            const Lane* LN = net_->getLane(L->left);
-            if (!LN)
-                continue;
-            double w = edgeCost(cur.lane, L->left);
-            double gNew = cur.g + w;
-            if (!bestG.count(L->left) || gNew < bestG[L->left]) {
-                bestG[L->left] = gNew;
-                parent[L->left] = cur.lane;
-                double f = gNew + heuristic(L->left, goal);
-                pq.push({L->left, gNew, f, cur.lane});
+    }
+}
+
+double Pathfinder::cost(const RoutePlan& plan) const {
+    const auto& st = plan.steps();
+    double total = 0.0;
+    for (int i = plan.startIndex + 1; i < (int)st.size(); ++i)
+        total += edgeCost(st[i - 1].lane, st[i].lane);
+    return total;
+}
+
+RoutePlan Pathfinder::planAStar(LaneId startLane, const Goal& goal) const {
+    if (!hasLane(startLane))
+        return makePlan(nullptr, 0, goal);
+
+    SearchWorkspace& ws = t_search;
+    ws.begin(laneCount_);
+
+    // Цель: точки для эвристики (только при смене цели) и метки полос-целей
+    const int target = goal.type == Goal::Type::LaneSingle ? goal.laneSingle
+                       : goal.type == Goal::Type::NodeReach ? goal.node
+                                                            : -1;
+    const bool fresh = ws.selectGoal({searchId_, goal.type, target});
+    switch (goal.type) {
+        case Goal::Type::LaneSingle:
+            if (fresh && hasLane(goal.laneSingle))
+                ws.goalPoints.push_back(info_[goal.laneSingle].end);
+            break;
+        case Goal::Type::LaneSet:
+            for (LaneId lid : goal.laneSet) {
+                if (!hasLane(lid))
+                    continue;
+                ws.goalPoints.push_back(info_[lid].end);
+                ws.slots[lid].goalStamp = ws.generation;
+            }
+            break;
+        case Goal::Type::NodeReach:
+            if (const Node* n = net_->getNode(goal.node); fresh && n)
+                ws.goalPoints.push_back(n->pos);
+            break;
+    }
+    const double invV = 1.0 / std::max(1.0, vmax_);
+    auto heuristic = [&](LaneId lane) {
+        return ws.distanceToGoal(lane, info_[lane].end) * invV;
+    };
+    auto isGoal = [&](LaneId lane) {
+        switch (goal.type) {
+            case Goal::Type::LaneSingle:
+                return lane == goal.laneSingle;
+            case Goal::Type::LaneSet:
+                return ws.slots[lane].goalStamp == ws.generation;
+            case Goal::Type::NodeReach:
+                return info_[lane].endNode == goal.node;
+        }
+        return false;
+    };
+
+    SearchWorkspace::Slot& s0 = ws.touch(startLane);
+    s0.g = 0.0;
+    s0.f = heuristic(startLane);
+    ws.push(startLane);
+
+    while (!ws.heap.empty()) {
+        const LaneId cur = ws.pop();
+        if (isGoal(cur)) {
+            for (LaneId l = cur; l != -1; l = ws.slots[l].parent)
+                ws.path.push_back(l);
+            std::reverse(ws.path.begin(), ws.path.end());
+            return makePlan(ws.path.data(), ws.path.size(), goal);
+        }
+
+        const double g = ws.slots[cur].g;
+        for (uint32_t k = succStart_[cur]; k < succStart_[cur + 1]; ++k) {
+            const LaneId nxt = succ_[k];
+            const double gNew = g + edgeCost(cur, nxt);
+            SearchWorkspace::Slot& sn = ws.touch(nxt);
+            if (gNew < sn.g) {
+                sn.g = gNew;
+                sn.parent = cur;
+                sn.f = gNew + heuristic(nxt);
+                ws.push(nxt);
             }
         }
-        // if (L->right != -1) {
-        //     const Lane* LN = net_->getLane(L->right);
-        //     if (!LN)
-        //         continue;
-        //     double w = edgeCost(cur.lane, L->right);
-        //     double gNew = cur.g + w;
-        //     if (!bestG.count(L->right) || gNew < bestG[L->right]) {
-        //         bestG[L->right] = gNew;
-        //         parent[L->right] = cur.lane;
-        //         double f = gNew + heuristic(L->right, goal);
-        //         pq.push({L->right, gNew, f, cur.lane});
-        //     }
-        // }
     }
 
-    return out;
+    // Пути нет: план пустой, но цель сохраняем для перепланирования
+    return makePlan(nullptr, 0, goal);
+}
+
+// До precompute(): A* прямо по сети, без таблиц и с нулевой эвристикой
+// (лимит скорости сети ещё не известен). Стоимости - статические, как
+// в edgeCost без измеренных времён; каждый запрос выделяет память.
+RoutePlan Pathfinder::planUnprepared(LaneId startLane, const Goal& goal) const {
+    auto staticCost = [&](const Lane& from, const Lane& to) {
+        if (to.left == from.id || to.right == from.id)
+            return to.width / 3;
+        double base =
+            std::max(1e-6, to.length() / std::max(1.0, to.speedLimit));
+        return to.isConnector ? base * 1.1 : base;
+    };
+
+    std::unordered_map<LaneId, double> bestG;
+    std::unordered_map<LaneId, LaneId> parent;
+    using Entry = std::pair<double, LaneId>;
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> pq;
+    if (net_->getLane(startLane)) {
+        bestG[startLane] = 0.0;
+        pq.emplace(0.0, startLane);
+    }
+    while (!pq.empty()) {
+        auto [g, cur] = pq.top();
+        pq.pop();
+        if (g > bestG[cur])
+            continue;
+        if (goal.isSatisfied(cur, *net_)) {
+            std::vector<LaneId> lanes;
+            for (LaneId l = cur; l != startLane; l = parent[l])
+                lanes.push_back(l);
+            lanes.push_back(startLane);
+            std::reverse(lanes.begin(), lanes.end());
+            return makePlan(lanes.data(), lanes.size(), goal);
+        }
+        const Lane* L = net_->getLane(cur);
+        auto relax = [&](LaneId nxt) {
+            const Lane* LN = net_->getLane(nxt);
+            if (!LN)
+                return;
+            const double gNew = g + staticCost(*L, *LN);
+            auto it = bestG.find(nxt);
+            if (it != bestG.end() && gNew >= it->second)
+                return;
+            bestG[nxt] = gNew;
+            parent[nxt] = cur;
+            pq.emplace(gNew, nxt);
+        };
+        for (LaneId nxt : L->next)
+            relax(nxt);
+        if (L->left != -1)
+            relax(L->left);
+    }
+    return makePlan(nullptr, 0, goal);
 }
 
 double Pathfinder::edgeCost(LaneId from, LaneId to) const {
-    const Lane* L = net_->getLane(to);
-    const Lane* L2 = net_->getLane(from);
-    if (!L2 || !L)
+    if (!hasLane(to) || !hasLane(from))
         return 1e9;
-    if (L->left == L2->id || L->right == L2->id) {
-        return L->width / 3;
-    }
-    double base = std::max(1e-6, L->length() / std::max(1.0, L->speedLimit));
-    if (L->isConnector)
+    const LaneInfo& L = info_[to];
+    if (L.left == from || L.right == from)
+        return L.lateralCost;
+    double base = L.baseCost;
+    if (to < static_cast<LaneId>(live_.size()))
+        base = std::max(base, live_[to]);
+    if (L.connector)
         base *= 1.1;
     return base;
 }
 
-double Pathfinder::heuristic(LaneId lane, const Goal& goal) const {
-    const Lane* L = net_->getLane(lane);
-    if (!L)
-        return 0.0;
-    Vec2 p = net_->getNode(L->end)->pos;
+RoutePlan RouteStore::intern(LaneId startLane, const Goal& goal,
+                             const Pathfinder& pf) {
+    if (goal.type == Goal::Type::LaneSet)
+        return pf.plan(startLane, goal);
 
-    switch (goal.type) {
-        case Goal::Type::LaneSingle: {
-            const Lane* G = net_->getLane(goal.laneSingle);
-            if (!G)
-                return 0.0;
-            Vec2 g = net_->getNode(G->end)->pos;
-            return norm(g - p) / std::max(1.0, vmax_);
-        }
-        case Goal::Type::LaneSet: {
-            double best = 0.0;
-            bool init = false;
-            for (auto lid : goal.laneSet) {
-                const Lane* G = net_->getLane(lid);
-                if (!G)
-                    continue;
-                Vec2 g = net_->getNode(G->end)->pos;
-                double d = norm(g - p) / std::max(1.0, vmax_);
-                if (!init || d < best) {
-                    best = d;
-                    init = true;
-                }
-            }
-            return init ? best : 0.0;
-        }
-        case Goal::Type::NodeReach: {
-            Vec2 g = net_->getNode(goal.node)->pos;
-            return norm(g - p) / std::max(1.0, vmax_);
-        }
+    Key key{startLane, goal.type,
+            goal.type == Goal::Type::LaneSingle ? goal.laneSingle : goal.node};
+    {
+        std::lock_guard<std::mutex> lock(m_);
+        auto it = plans_.find(key);
+        if (it != plans_.end())
+            return RoutePlan{it->second, 0};
     }
-    return 0.0;
+
+    // Поиск без блокировки: при гонке первый записанный план и останется
+    RoutePlan fresh = pf.plan(startLane, goal);
+    std::lock_guard<std::mutex> lock(m_);
+    auto [it, inserted] = plans_.emplace(key, fresh.data);
+    return RoutePlan{it->second, 0};
+}
+
+void RouteStore::clear() {
+    std::lock_guard<std::mutex> lock(m_);
+    plans_.clear();
+}
+
+size_t RouteStore::size() const {
+    std::lock_guard<std::mutex> lock(m_);
+    return plans_.size();
 }
 
 bool RouteTracker::setGoalAndPlan(LaneId startLane, const Goal& goal,
-                                  const Pathfinder& pf) {
-    goal_ = goal;
-    plan_ = pf.plan(startLane, goal_);
+                                  const Pathfinder& pf, RouteStore* store) {
+    plan_ = store ? store->intern(startLane, goal, pf)
+                  : pf.plan(startLane, goal);
     return plan_.valid();
 }
 
 void RouteTracker::advanceIfEntered(LaneId lane) {
-    if (plan_.startIndex < (int)plan_.steps.size() &&
-        plan_.steps[plan_.startIndex].lane == lane) {
+    const auto& steps = plan_.steps();
+    if (plan_.startIndex < (int)steps.size() &&
+        steps[plan_.startIndex].lane == lane) {
         plan_.startIndex++;
-        while (plan_.startIndex < (int)plan_.steps.size() &&
-               plan_.steps[plan_.startIndex].lane == lane) {
+        while (plan_.startIndex < (int)steps.size() &&
+               steps[plan_.startIndex].lane == lane) {
             plan_.startIndex++;
         }
     }
 }
 
-bool RouteTracker::replanFrom(LaneId currentLane, const Pathfinder& pf) {
-    plan_ = pf.plan(currentLane, goal_);
+bool RouteTracker::replanFrom(LaneId currentLane, const Pathfinder& pf,
+                              RouteStore* store) {
+    Goal goal = this->goal();
+    plan_ = store ? store->intern(currentLane, goal, pf)
+                  : pf.plan(currentLane, goal);
     return plan_.valid();
 }
 
@@ -5,6 +5,8 @@
 #include <queue>
 #include <optional>
 #include <functional>
+#include <memory>
+#include <mutex>
 #include "road_network.h"
 #include "sim_math.h"
 
@@ -42,27 +44,49 @@ struct Goal {
     bool isSatisfied(LaneId atLane, const RoadNetwork& net) const;
 };
 
+// Шаг маршрута; для коннектора - откуда и куда он ведёт, иначе -1
 struct RouteStep {
-    LaneId lane;
-    std::optional<LaneId> connectorFrom;
-    std::optional<LaneId> connectorTo;
+    LaneId lane{-1};
+    LaneId connectorFrom{-1};
+    LaneId connectorTo{-1};
+
+    [[nodiscard]] bool isConnector() const { return connectorFrom != -1; }
 };
 
-struct RoutePlan {
+// Неизменяемые шаги и цель маршрута. Один экземпляр делят все машины
+// с тем же стартом и целью (RouteStore), у машины - только указатель и индекс.
+struct RouteData {
     std::vector<RouteStep> steps;
+    Goal goal;
+};
+
+struct RoutePlan {
+    std::shared_ptr<const RouteData> data;
     int startIndex{0};  // индекс текущего шага
-    [[nodiscard]] bool valid() const { return !steps.empty(); }
-    [[nodiscard]] LaneId currentLane() const { return steps[startIndex].lane; }
+
+    [[nodiscard]] const std::vector<RouteStep>& steps() const {
+        static const std::vector<RouteStep> kNone;
+        return data ? data->steps : kNone;
+    }
+
+    [[nodiscard]] bool valid() const { return !steps().empty(); }
+    [[nodiscard]] LaneId currentLane() const { return steps()[startIndex].lane; }
 
     [[nodiscard]] std::optional<LaneId> nextConnector() const {
-        for (int i = startIndex; i < (int)steps.size(); ++i) {
-            if (steps[i].connectorFrom)
-                return steps[i].lane;
+        const auto& st = steps();
+        for (int i = startIndex; i < (int)st.size(); ++i) {
+            if (st[i].isConnector())
+                return st[i].lane;
         }
         return std::nullopt;
     }
 };
 
+enum class RoutingMode {
+    AStar,   // поиск на каждый запрос
+    NextHop  // таблица следующих шагов к заранее известным целям
+};
+
 class Pathfinder {
    public:
     explicit Pathfinder(const RoadNetwork* net) : net_(net) {}
@@ -71,12 +95,70 @@ class Pathfinder {
 
     void setMaxSpeedForHeuristic(double vmax) { vmax_ = vmax; }
 
+    // После построения сети: скорость эвристики по самому быстрому
+    // лимиту (иначе A* может вернуть не кратчайший путь) и таблица
+    // следующих шагов к целям targets (обратный Дейкстра от каждой).
+    // Память - полосы * цели, поэтому цели - только выезды.
+    void precompute(const std::vector<LaneId>& targets);
+
+    // Измеренное время проезда полос (индекс - id полосы), заменяет
+    // статическое, если больше него. Таблицу после этого пересчитывают
+    // rebuildTarget по всем целям (можно параллельно, по цели на задачу).
+    void setLiveCosts(const std::vector<double>& travelTimes) {
+        live_ = travelTimes;
+    }
+
+    [[nodiscard]] size_t targetCount() const { return targets_.size(); }
+
+    void rebuildTarget(size_t k);
+
+    void setMode(RoutingMode mode) { mode_ = mode; }
+    [[nodiscard]] RoutingMode mode() const { return mode_; }
+
+    // Стоимость маршрута от текущего шага до конца в единицах поиска
+    [[nodiscard]] double cost(const RoutePlan& plan) const;
+
    private:
     const RoadNetwork* net_{nullptr};
     double vmax_{20.0};  // м/с для эвристики
-
+    uint64_t searchId_{0};  // номер precompute: ключ кэша эвристики
+    RoutingMode mode_{RoutingMode::NextHop};
+
+    // Плотные таблицы полос (precompute): поиск обходится без хешей.
+    // До precompute() их нет, и plan() идёт в planUnprepared.
+    struct LaneInfo {
+        double baseCost{0.0};    // длина / лимит скорости
+        double lateralCost{0.0}; // перестроение в эту полосу
+        Vec2 end;                // конечный узел, для эвристики
+        NodeId endNode{-1};
+        LaneId left{-1};
+        LaneId right{-1};
+        bool connector{false};
+        bool exists{false};
+    };
+    size_t laneCount_{0};
+    std::vector<LaneInfo> info_;
+    std::vector<uint32_t> succStart_;  // переходы полосы: next, затем налево
+    std::vector<LaneId> succ_;
+    std::vector<uint32_t> predStart_;  // обратные переходы
+    std::vector<LaneId> pred_;
+    std::vector<double> live_;
+
+    // Таблица: для цели с номером k у полосы l следующий шаг
+    // nextHop_[k * laneCount_ + l], -1 - цель недостижима
+    std::vector<LaneId> targets_;
+    std::vector<int> targetSlot_;  // полоса -> k или -1
+    std::vector<LaneId> nextHop_;
+
+    [[nodiscard]] bool hasLane(LaneId lane) const;
     [[nodiscard]] double edgeCost(LaneId from, LaneId to) const;
-    [[nodiscard]] double heuristic(LaneId lane, const Goal& goal) const;
+    [[nodiscard]] RoutePlan planAStar(LaneId startLane, const Goal& goal) const;
+    [[nodiscard]] RoutePlan planUnprepared(LaneId startLane,
+                                           const Goal& goal) const;
+    [[nodiscard]] bool planNextHop(LaneId startLane, const Goal& goal,
+                                   RoutePlan& out) const;
+    [[nodiscard]] RoutePlan makePlan(const LaneId* lanes, size_t n,
+                                     const Goal& goal) const;
 };
 
 struct EntryMovement {
@@ -84,28 +166,66 @@ struct EntryMovement {
     LaneId outLane;    // выходная полоса
 };
 
+// Общие маршруты по ключу (старт, цель). Цели-множества полос не кешируются.
+// Потокобезопасно: планы могут запрашивать рабочие потоки.
+class RouteStore {
+   public:
+    [[nodiscard]] RoutePlan intern(LaneId startLane, const Goal& goal,
+                                   const Pathfinder& pf);
+
+    void clear();
+
+    [[nodiscard]] size_t size() const;
+
+   private:
+    struct Key {
+        LaneId start;
+        Goal::Type type;
+        int target;
+        bool operator==(const Key& o) const {
+            return start == o.start && type == o.type && target == o.target;
+        }
+    };
+    struct KeyHash {
+        size_t operator()(const Key& k) const {
+            return std::hash<long long>()(
+                (static_cast<long long>(k.start) << 34) ^
+                (static_cast<long long>(k.type) << 32) ^
+                static_cast<unsigned>(k.target));
+        }
+    };
+
+    mutable std::mutex m_;
+    std::unordered_map<Key, std::shared_ptr<const RouteData>, KeyHash> plans_;
+};
+
 class RouteTracker {
    public:
     explicit RouteTracker(const RoadNetwork* net) : net_(net) {}
 
     bool setGoalAndPlan(LaneId startLane, const Goal& goal,
-                        const Pathfinder& pf);
+                        const Pathfinder& pf, RouteStore* store = nullptr);
 
     const RoutePlan& plan() const { return plan_; }
 
+    const RoadNetwork* network() const { return net_; }
+
     std::optional<LaneId> nextConnector() const {
         return plan_.nextConnector();
     }
 
     void advanceIfEntered(LaneId lane);
 
-    bool replanFrom(LaneId currentLane, const Pathfinder& pf);
+    bool replanFrom(LaneId currentLane, const Pathfinder& pf,
+                    RouteStore* store = nullptr);
 
-    const Goal& goal() const { return goal_; }
+    const Goal& goal() const {
+        static const Goal kNone;
+        return plan_.data ? plan_.data->goal : kNone;
+    }
 
    private:
     const RoadNetwork* net_;
-    Goal goal_;
     RoutePlan plan_;
 };
 
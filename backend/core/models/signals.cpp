@@ -1,24 +1,39 @@
 #include "signals.h"
 #include "world_context.h"
+#include <limits>
 
 namespace sim {
 
-void TrafficLightGroup::setProgram(const std::vector<SignalPhase>& phases) {
+void TrafficLightGroup::setProgram(const std::vector<SignalPhase>& phases,
+                                   double now) {
     prog_ = phases;
     phaseIdx_ = 0;
-    tInPhase_ = 0.0;
+    phaseStart_ = now;
+    extension_ = 0.0;
     current_ = prog_.empty() ? CarSignal::Off : prog_[0].carState;
 }
 
-void TrafficLightGroup::update(double dt) {
+double TrafficLightGroup::phaseEndsAt() const {
+    if (prog_.empty())
+        return std::numeric_limits<double>::infinity();
+    return phaseStart_ + prog_[phaseIdx_].duration + extension_;
+}
+
+void TrafficLightGroup::advanceTo(double now) {
     if (prog_.empty()) {
         current_ = CarSignal::Red;
         return;
     }
 
-    tInPhase_ += dt;
-    if (tInPhase_ >= prog_[phaseIdx_].duration) {
-        tInPhase_ = 0.0;
+    double cycle = 0.0;
+    for (const auto& ph : prog_)
+        cycle += std::max(0.0, ph.duration);
+    if (cycle <= 0.0)
+        return;
+
+    while (now >= phaseEndsAt()) {
+        phaseStart_ = phaseEndsAt();
+        extension_ = 0.0;
         phaseIdx_ = (phaseIdx_ + 1) % static_cast<int>(prog_.size());
         current_ = prog_[phaseIdx_].carState;
     }
@@ -43,7 +58,10 @@ void PedestrianLight::update(double dt) {
 }
 
 void SignalController::addCarGroup(TrafficLightGroup g) {
-    carGroups_[g.id] = std::move(g);
+    int id = g.id;
+    auto prog = g.program();
+    carGroups_[id] = std::move(g);
+    reprogram(carGroups_[id], prog);
 }
 
 void SignalController::addPedLight(PedestrianLight p) {
@@ -60,51 +78,60 @@ PedestrianLight* SignalController::pedLight(int id) {
     return it == pedLights_.end() ? nullptr : &it->second;
 }
 
+void SignalController::attachTimers(const SimulationClock* clock,
+                                    TimerWheel* timers) {
+    clock_ = clock;
+    timers_ = timers;
+}
+
+double SignalController::now() const {
+    return clock_ ? clock_->now : 0.0;
+}
+
 void SignalController::update(double dt) {
-    for (auto& kv : carGroups_)
-        kv.second.update(dt);
+    if (!timers_) {
+        for (auto& kv : carGroups_)
+            kv.second.advanceTo(now());
+    }
     for (auto& kv : pedLights_)
         kv.second.update(dt);
 }
 
-void SignalController::applyAdaptiveLogic(const WorldContext& world) {
-    auto* g1 = carGroup(1);
-    auto* g2 = carGroup(2);
-    if (!g1 || !g2)
-        return;
-
-    double q1 = estimateQueueLength(*g1, world);
-    double q2 = estimateQueueLength(*g2, world);
+bool SignalController::onPhaseExpiry(int groupId, uint32_t cookie) {
+    auto* g = carGroup(groupId);
+    auto ep = phaseEpochs_.find(groupId);
+    if (!g || ep == phaseEpochs_.end() || ep->second != cookie)
+        return false;
 
-    adaptPhaseDurations(*g1, q1, q2);
-    adaptPhaseDurations(*g2, q2, q1);
+    CarSignal before = g->state();
+    g->advanceTo(now());
+    schedulePhaseExpiry(*g);
+    return g->state() != before;
 }
 
+void SignalController::reprogram(TrafficLightGroup& g,
+                                 const std::vector<SignalPhase>& phases) {
+    g.setProgram(phases, now());
+    schedulePhaseExpiry(g);
+}
 
-void SignalController::adaptPhaseDurations(TrafficLightGroup& g, double myQueue,
-                                           double otherQueue) {
-    auto prog = g.program();
-    auto& green = prog[2];
-
-    double base = 20.0;
-    double delta = (myQueue - otherQueue) * 2.0;
-
-    green.duration = std::clamp(base + delta, 10.0, 40.0);
-
-    g.setProgram(prog);
+void SignalController::schedulePhaseExpiry(const TrafficLightGroup& g) {
+    uint32_t epoch = ++phaseEpochs_[g.id];
+    double due = g.phaseEndsAt();
+    if (timers_ && std::isfinite(due))
+        timers_->schedule(due, static_cast<uint64_t>(g.id),
+                          TimerTag::PhaseExpiry, epoch);
 }
 
-double SignalController::estimateQueueLength(const TrafficLightGroup& g,
-                                             const WorldContext& world) {
-    double count = 0.0;
-    for (int laneId : g.controlledLaneIds) {
-        double gap;
-        auto* leader = world.findLeaderInLane(laneId, 0.0, &gap);
-        if (leader)
-            count++;
+void SignalController::shiftPhases(const std::vector<int>& groupIds,
+                                   double delta) {
+    for (int id : groupIds) {
+        auto* g = carGroup(id);
+        if (!g)
+            continue;
+        g->extendPhase(delta);
+        schedulePhaseExpiry(*g);
     }
-    return count;
 }
 
-
 } // namespace sim
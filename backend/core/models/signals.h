@@ -3,10 +3,12 @@
 #include <unordered_map>
 #include <string>
 #include "sim_math.h"
+#include "timer_wheel.h"
 
 namespace sim {
 
 class WorldContext;
+struct SimulationClock;
 
 enum class CarSignal { Red, RedYellow, Green, Yellow, Off };
 
@@ -28,21 +30,38 @@ public:
     std::string name;
     std::vector<int> controlledLaneIds;
 
-    void setProgram(const std::vector<SignalPhase>& phases);
-    void update(double dt);
+    // Программа начинает первую фазу в момент now
+    void setProgram(const std::vector<SignalPhase>& phases, double now = 0.0);
+
+    // Переключает все фазы, закончившиеся к моменту now
+    void advanceTo(double now);
 
     std::vector<SignalPhase> program() {
         return this->prog_;
     }
 
     [[nodiscard]] CarSignal state() const { return current_; }
-    [[nodiscard]] double timeInPhase() const { return tInPhase_; }
+    [[nodiscard]] double timeInPhase(double now) const {
+        return now - phaseStart_;
+    }
     [[nodiscard]] int phaseIndex() const { return phaseIdx_; }
+    [[nodiscard]] const std::vector<SignalPhase>& phases() const {
+        return prog_;
+    }
+
+    // Момент окончания текущей фазы (бесконечность без программы)
+    [[nodiscard]] double phaseEndsAt() const;
+
+    // Удлинить (delta < 0 - укоротить) только текущую фазу; следующие
+    // идут по программе, отсчёт текущей фазы не сбрасывается
+    void extendPhase(double delta) { extension_ += delta; }
+    [[nodiscard]] double phaseExtension() const { return extension_; }
 
 private:
     std::vector<SignalPhase> prog_;
     int phaseIdx_{0};
-    double tInPhase_{0.0};
+    double phaseStart_{0.0};
+    double extension_{0.0};
     CarSignal current_{CarSignal::Red};
 };
 
@@ -71,9 +90,17 @@ public:
     TrafficLightGroup* carGroup(int id);
     PedestrianLight* pedLight(int id);
 
+    // Смена фаз групп идёт по таймерам; без них - опрос каждый тик
+    void attachTimers(const SimulationClock* clock, TimerWheel* timers);
+
     void update(double dt);
 
-    void applyAdaptiveLogic(const WorldContext& world);
+    // Срабатывание таймера PhaseExpiry; true, если сменился сигнал
+    bool onPhaseExpiry(int groupId, uint32_t cookie);
+
+    // Сдвинуть конец текущей фазы групп на delta (одинаково для всех
+    // групп перекрёстка - порядок и межфазные интервалы сохраняются)
+    void shiftPhases(const std::vector<int>& groupIds, double delta);
 
     const std::unordered_map<int, TrafficLightGroup>& carGroups() const {
         return carGroups_;
@@ -86,10 +113,13 @@ public:
 private:
     std::unordered_map<int, TrafficLightGroup> carGroups_;
     std::unordered_map<int, PedestrianLight> pedLights_;
-    double estimateQueueLength(const TrafficLightGroup& g,
-                               const WorldContext& world);
-    void adaptPhaseDurations(TrafficLightGroup& g,
-                             double myQueue, double otherQueue);
+    std::unordered_map<int, uint32_t> phaseEpochs_;
+    const SimulationClock* clock_{nullptr};
+    TimerWheel* timers_{nullptr};
+
+    [[nodiscard]] double now() const;
+    void reprogram(TrafficLightGroup& g, const std::vector<SignalPhase>& phases);
+    void schedulePhaseExpiry(const TrafficLightGroup& g);
 };
 
 } // namespace sim
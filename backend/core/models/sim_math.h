@@ -3,6 +3,16 @@
 #include <algorithm>
 
 namespace sim {
+
+// Скаляр горячего состояния машин и пакетов моделей следования.
+// ITS_FLOAT_STATE (опция CMake) - float: вдвое меньше памяти на проход
+// ядер и вдвое шире векторы. Время, длины полос и геометрия - double.
+#ifdef ITS_FLOAT_STATE
+using Real = float;
+#else
+using Real = double;
+#endif
+
 struct Vec2 {
     double x{0}, y{0};
     Vec2() = default;
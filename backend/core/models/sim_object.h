@@ -18,6 +18,10 @@ public:
         length_ = length;
     }
 
+    // Объект с уже выданным id (переход между моделями без смены id)
+    SimObject(uint64_t id, ObjectType t, double width, double length)
+        : id_(id), type_(t), length_(length), width_(width) {}
+
     virtual ~SimObject() = default;
 
     [[nodiscard]] uint64_t id() const { return id_; }
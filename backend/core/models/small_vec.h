@@ -0,0 +1,71 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace sim {
+
+// Короткий список с местом на N элементов внутри объекта. Пока элементов
+// не больше N, куча не нужна, даже у только что созданного владельца;
+// сверх N всё переезжает в обычный вектор (его ёмкость остаётся после
+// clear()). Порядок элементов сохраняется, итераторы - указатели.
+template <class T, size_t N>
+class SmallVec {
+public:
+    using iterator = T*;
+    using const_iterator = const T*;
+
+    [[nodiscard]] T* begin() { return spilled_ ? spill_.data() : inline_.data(); }
+    [[nodiscard]] T* end() { return begin() + size(); }
+    [[nodiscard]] const T* begin() const {
+        return spilled_ ? spill_.data() : inline_.data();
+    }
+    [[nodiscard]] const T* end() const { return begin() + size(); }
+
+    [[nodiscard]] size_t size() const { return spilled_ ? spill_.size() : count_; }
+    [[nodiscard]] bool empty() const { return size() == 0; }
+
+    void clear() {
+        count_ = 0;
+        spill_.clear();
+        spilled_ = false;
+    }
+
+    template <class... Args>
+    T& emplace_back(Args&&... args) {
+        if (!spilled_ && count_ < N) {
+            inline_[count_] = T(std::forward<Args>(args)...);
+            return inline_[count_++];
+        }
+        if (!spilled_) {
+            spill_.assign(inline_.begin(), inline_.begin() + count_);
+            spilled_ = true;
+            count_ = 0;
+        }
+        return spill_.emplace_back(std::forward<Args>(args)...);
+    }
+
+    void push_back(const T& v) { emplace_back(v); }
+
+    T* erase(T* it) {
+        const size_t i = static_cast<size_t>(it - begin());
+        if (spilled_) {
+            spill_.erase(spill_.begin() + static_cast<std::ptrdiff_t>(i));
+            return spill_.data() + i;
+        }
+        std::move(it + 1, inline_.data() + count_, it);
+        --count_;
+        return it;
+    }
+
+private:
+    std::array<T, N> inline_{};
+    std::vector<T> spill_;
+    uint32_t count_{0};
+    bool spilled_{false};
+};
+
+} // namespace sim
@@ -0,0 +1,107 @@
+#include "timer_wheel.h"
+#include <algorithm>
+#include <cmath>
+
+namespace sim {
+
+int64_t TimerWheel::tickOf(double t) const {
+    return static_cast<int64_t>(std::floor(t / resolution_));
+}
+
+void TimerWheel::schedule(double due, uint64_t owner, TimerTag tag,
+                          uint32_t cookie) {
+    int32_t node;
+    if (free_ != -1) {
+        node = free_;
+        free_ = nodes_[node].next;
+    } else {
+        node = static_cast<int32_t>(nodes_.size());
+        nodes_.emplace_back();
+    }
+    nodes_[node].ev = TimerEvent{due, owner, tag, cookie, nextSeq_++};
+    place(node);
+    pending_++;
+}
+
+void TimerWheel::place(int32_t node) {
+    int64_t tick = std::max(tickOf(nodes_[node].ev.due), curTick_);
+    int64_t delta = tick - curTick_;
+
+    int level = 0;
+    while (level < kLevels - 1 &&
+           delta >= (int64_t{1} << (kBits * (level + 1))))
+        ++level;
+
+    // Дальше горизонта колеса: кладём в последний слот верхнего уровня,
+    // при каскаде событие будет перераспределено заново
+    if (delta >= (int64_t{1} << (kBits * kLevels)))
+        tick = curTick_ + (int64_t{1} << (kBits * kLevels)) - 1;
+
+    int slot = static_cast<int>((tick >> (kBits * level)) & (kSlots - 1));
+    nodes_[node].next = heads_[level][slot];
+    heads_[level][slot] = node;
+}
+
+void TimerWheel::cascade(int level, int slot) {
+    int32_t node = heads_[level][slot];
+    heads_[level][slot] = -1;
+    while (node != -1) {
+        int32_t next = nodes_[node].next;
+        place(node);
+        node = next;
+    }
+}
+
+void TimerWheel::advance(double now, std::vector<TimerEvent>& out) {
+    const int64_t target = tickOf(now);
+    const size_t firstOut = out.size();
+
+    while (true) {
+        int32_t& head = heads_[0][curTick_ & (kSlots - 1)];
+        int32_t node = head;
+        head = -1;
+        while (node != -1) {
+            int32_t next = nodes_[node].next;
+            if (nodes_[node].ev.due <= now) {
+                out.push_back(nodes_[node].ev);
+                nodes_[node].next = free_;
+                free_ = node;
+                pending_--;
+            } else {
+                nodes_[node].next = head;
+                head = node;
+            }
+            node = next;
+        }
+
+        if (curTick_ >= target)
+            break;
+
+        ++curTick_;
+        if ((curTick_ & (kSlots - 1)) == 0) {
+            for (int level = 1; level < kLevels; ++level) {
+                int idx = static_cast<int>((curTick_ >> (kBits * level)) &
+                                           (kSlots - 1));
+                cascade(level, idx);
+                if (idx != 0)
+                    break;
+            }
+        }
+    }
+
+    std::sort(out.begin() + static_cast<std::ptrdiff_t>(firstOut), out.end(),
+              [](const TimerEvent& a, const TimerEvent& b) {
+                  return a.due < b.due || (a.due == b.due && a.seq < b.seq);
+              });
+}
+
+void TimerWheel::clear() {
+    for (auto& level : heads_)
+        level.fill(-1);
+    nodes_.clear();
+    free_ = -1;
+    curTick_ = 0;
+    pending_ = 0;
+}
+
+}  // namespace sim
@@ -0,0 +1,73 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace sim {
+
+// Что должно произойти при срабатывании таймера
+enum class TimerTag : uint8_t {
+    SignalPerception,  // водитель заново смотрит на светофор
+    PlanningTimeout,   // истекло время планирования перестроения
+    RequestTimeout,    // никто не уступил за отведённое время
+    RequestCleanup,    // очистка устаревших входящих запросов уступки
+    PhaseExpiry,       // окончание фазы светофорной группы
+    Arrival            // прибытие машины по спросу (owner - номер источника)
+};
+
+struct TimerEvent {
+    double due{0.0};     // момент срабатывания (модельное время)
+    uint64_t owner{0};   // id владельца: машины или группы светофоров
+    TimerTag tag{TimerTag::SignalPerception};
+    uint32_t cookie{0};  // метка владельца: устаревшие события он отбрасывает сам
+    uint64_t seq{0};     // порядок постановки, для детерминизма
+};
+
+// Иерархическое колесо таймеров на модельных часах.
+// 4 уровня по 64 слота, слот нижнего уровня = resolution секунд.
+// Постановка и срабатывание O(1), за тик обрабатываются только наступившие слоты.
+// Отмены нет: владелец сверяет cookie и игнорирует неактуальные события.
+class TimerWheel {
+public:
+    explicit TimerWheel(double resolution = 1.0 / 32.0)
+        : resolution_(resolution) {
+        clear();
+    }
+
+    void schedule(double due, uint64_t owner, TimerTag tag,
+                  uint32_t cookie = 0);
+
+    // Дописывает в out все события со сроком <= now в порядке (due, seq)
+    void advance(double now, std::vector<TimerEvent>& out);
+
+    void clear();
+
+    [[nodiscard]] size_t pending() const { return pending_; }
+
+private:
+    static constexpr int kLevels = 4;
+    static constexpr int kBits = 6;
+    static constexpr int kSlots = 1 << kBits;
+
+    // Узлы лежат в общем пуле и связаны в списки по слотам: после прогрева
+    // постановка таймеров не обращается к куче
+    struct Node {
+        TimerEvent ev;
+        int32_t next{-1};
+    };
+
+    double resolution_;
+    int64_t curTick_{0};
+    uint64_t nextSeq_{0};
+    size_t pending_{0};
+    std::vector<Node> nodes_;
+    int32_t free_{-1};
+    std::array<std::array<int32_t, kSlots>, kLevels> heads_;
+
+    [[nodiscard]] int64_t tickOf(double t) const;
+    void place(int32_t node);
+    void cascade(int level, int slot);
+};
+
+}  // namespace sim
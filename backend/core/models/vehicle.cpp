@@ -1,4 +1,5 @@
 #include "vehicle.h"
+#include "lane_change.h"
 #include <algorithm>
 #include <cmath>
 #include <iostream>
@@ -6,95 +7,280 @@
 
 namespace sim {
 
-Vehicle::Vehicle(const VehicleParams& vp, const DriverProfile& dp,
-                 LaneId lane, double s0, double v0, RouteTracker rt)
-    : SimObject(ObjectType::Vehicle, 3.4, 1.8),
+Vehicle::Vehicle(uint64_t id, const VehicleParams& vp, const DriverProfile& dp,
+                 LaneId lane, double s0, double v0, RouteTracker rt,
+                 bool handedOver)
+    : SimObject(id, ObjectType::Vehicle, 3.4, 1.8),
       params_(vp),
       driver_(dp),
-      rng_(id() * 1469598103934665603ULL),
+      rng_(id * 1469598103934665603ULL),
       lane_(lane),
       s_(s0),
       v_(v0),
-      route_(std::move(rt)) {}
+      route_(std::move(rt)) {
+    // Уже ехала: задержку перестроения после появления не ждём
+    if (handedOver)
+        time_since_spawn_ = driver_.minLaneChangeDelay;
+}
 
-Vehicle Vehicle::randomVehicle(int from, RouteTracker rt) {
+Vehicle Vehicle::randomVehicle(uint64_t id, int from, RouteTracker rt,
+                               const VehicleClass& cls) {
     DriverProfile dp{};
     VehicleParams vp{};
     dp.laneChangeDuration = 2;
     vp.minGap = 2;
-    return {vp, dp, from, 0, 0, std::move(rt)};
+    vp.following = cls.following;
+    vp.laneChange = cls.laneChange;
+    return {id, vp, dp, from, 0, 0, std::move(rt)};
 }
 
-static thread_local const RoadNetwork* g_lastNet = nullptr;
-static thread_local Pose g_lastPose;
-
+// Сеть берётся из маршрута машины: pose() зовут и из потока, который
+// её не шагал (вывод кадра, ближайшие объекты)
 Pose Vehicle::pose() const {
-    if (!g_lastNet)
-        return g_lastPose;
-    const Lane* L = g_lastNet->getLane(lane_);
-    if (!L) {
-        return g_lastPose;
-    }
-    Pose p = L->poseAt(s_, d_);
-    return p;
-}
-
-double Vehicle::idmAccel(double v, double vFront, double gap) const {
-    const double a = params_.maxAccel;
-    const double b = params_.comfyDecel;
-    const double T = params_.timeHeadway;
-    const double s0 = params_.minGap;
-    const double v0 = params_.desiredSpeed;
-    const double delta = 4.0;
-    gap = std::max(0.1, gap);
-    double dv = v - vFront;
-    double sStar =
-        s0 + std::max(0.0, v * T + v * dv / (2.0 * std::sqrt(a * b)));
-    double termFree = 1.0 - std::pow(std::max(0.0, v) / v0, delta);
-    double termInteract = -std::pow(sStar / gap, 2.0);
-    return a * (termFree + termInteract);
+    const RoadNetwork* net = route_.network();
+    const Lane* L = net ? net->getLane(lane_) : nullptr;
+    if (!L)
+        return {};
+    return L->poseAt(s_, d_);
+}
+
+FollowInputs Vehicle::followInputs(double vFront, double gap,
+                                  double noise) const {
+    return {v_,
+            vFront,
+            gap,
+            params_.maxAccel,
+            params_.comfyDecel,
+            params_.maxDecel,
+            params_.timeHeadway,
+            params_.minGap,
+            std::min(params_.desiredSpeed, step_.vCurve),
+            params_.reactionTime,
+            params_.dawdle,
+            noise};
+}
+
+double Vehicle::followingAccel(double vFront, double gap, double dt) const {
+    const FollowInputs in = followInputs(vFront, gap, 0.0);
+    return visitFollowingModel(params_.following, [&](auto model) {
+        return decltype(model)::accel(in, dt);
+    });
 }
 
 void Vehicle::perceiveTrafficLight(WorldContext& world, const Lane& L) {
-    CarSignal real = world.carSignalForLane(L.id);
+    if (perceivedSignal_.has_value())
+        return;
+
     double t = world.clock->now;
+    perceivedSignal_ = world.carSignalForLane(L.id);
+    nextSignalUpdateTime_ = t + driver_.reactionMean +
+                            rng_.uniform(0.0, driver_.reactionJitter);
+    world.schedule(nextSignalUpdateTime_, id(), TimerTag::SignalPerception);
+}
 
-    if (!perceivedSignal_.has_value()) {
+// Очередной взгляд на светофор: дальше обновляемся по таймеру
+void Vehicle::refreshPerceivedSignal(WorldContext& world) {
+    double t = world.clock->now;
+    if (rng_.uniform() >= driver_.missProb) {
+        CarSignal real = world.carSignalForLane(lane_);
+        if (perceivedSignal_ != real)
+            wake();
         perceivedSignal_ = real;
-        nextSignalUpdateTime_ = t + driver_.reactionMean +
-                                rng_.uniform(0.0, driver_.reactionJitter);
+    }
+    nextSignalUpdateTime_ = t + driver_.reactionMean +
+                            rng_.uniform(0.0, driver_.reactionJitter);
+    world.schedule(nextSignalUpdateTime_, id(), TimerTag::SignalPerception);
+}
+
+LaneId Vehicle::nextRouteLane() const {
+    const auto& st = route_.plan().steps();
+    for (int i = route_.plan().startIndex; i + 1 < (int)st.size(); ++i) {
+        if (st[i].lane == lane_)
+            return st[i + 1].lane;
+    }
+    return -1;
+}
+
+// Хвост следующей полосы маршрута (только продолжение, не соседняя
+// полоса). Будить спящих через границу полос некому, поэтому такая
+// помеха, как и зоны конфликтов, не даёт заснуть (sawObstacle).
+void Vehicle::followAcrossLaneEnd(WorldContext& world, const Lane& L,
+                                  double& gap, double& vFront) {
+    const double remaining = L.length() - s_;
+    if (!world.occupancy || remaining > params_.viewDistance)
+        return;
+    LaneId next = nextRouteLane();
+    if (std::find(L.next.begin(), L.next.end(), next) == L.next.end())
+        return;
+    const Vehicle* tail = nullptr;
+    for (const Vehicle* o : world.occupancy->on(next)) {
+        if (o != this && o->laneId() == next && (!tail || o->s() < tail->s()))
+            tail = o;
+    }
+    if (!tail)
         return;
+    double g = remaining + tail->s() - tail->boundingRadius();
+    if (g < gap) {
+        gap = g;
+        vFront = tail->v();
+        step_.sawObstacle = true;
     }
+}
 
-    if (t >= nextSignalUpdateTime_) {
-        if (rng_.uniform() < driver_.missProb) {
-            nextSignalUpdateTime_ = t + driver_.reactionMean +
-                                    rng_.uniform(0.0, driver_.reactionJitter);
-        } else {
-            perceivedSignal_ = real;
-            nextSignalUpdateTime_ = t + driver_.reactionMean +
-                                    rng_.uniform(0.0, driver_.reactionJitter);
+// Очерёдность в зоне: кто раньше доедет до её начала (стоящие - со
+// скоростью kCrawlSpeed), при равенстве - меньший id; уже въехавший
+// всегда первый. Порядок полный, так что взаимных ожиданий нет.
+// Не первый останавливается перед зоной. Внутри зоны пересечения не
+// стоим - освобождаем её; в зоне слияния едем за тем, кто ближе к
+// точке слияния. Кроме машин на конфликтном коннекторе смотрим его
+// подъезд в пределах kConflictLookahead, если там не красный.
+// На общем въезде машина соседнего коннектора, ещё не разошедшаяся
+// с нашим, - просто лидер.
+void Vehicle::yieldAtConflicts(WorldContext& world, LaneId conn, double s,
+                               double& gap, double& vFront) {
+    if (!world.conflicts || !world.occupancy)
+        return;
+    const Lane* C = world.net->getLane(conn);
+    if (!C)
+        return;
+    const double half = 0.5 * length();
+    const double front = s + half;
+    const double rear = s - half;
+
+    for (const ConflictZone& z : world.conflicts->zonesOf(conn)) {
+        if (rear >= z.end)
+            continue;
+        const double distMe = z.begin - front;
+        const bool meInside = distMe <= 0.0;
+        const double tMe =
+            std::max(0.0, distMe) / std::max<double>(v_, kCrawlSpeed);
+        const Lane* O = world.net->getLane(z.other);
+        if (!O)
+            continue;
+
+        if (z.kind == ConflictKind::Diverge) {
+            for (const Vehicle* o : world.occupancy->on(z.other)) {
+                const double oHalf = 0.5 * o->length();
+                if (o == this || o->laneId() != z.other ||
+                    o->s() - oHalf >= z.otherEnd || o->s() < s ||
+                    (o->s() == s && o->id() > id()))
+                    continue;
+                double g = std::max(0.0, o->s() - s - half - oHalf);
+                if (g < gap) {
+                    gap = g;
+                    vFront = o->v();
+                    step_.sawObstacle = true;
+                }
+            }
+            continue;
+        }
+
+        auto consider = [&](const Vehicle* o, double so) {
+            const double oHalf = 0.5 * o->length();
+            if (so - oHalf >= z.otherEnd)
+                return;
+            const double distO = z.otherBegin - (so + oHalf);
+            const bool oInside = distO <= 0.0;
+            if (meInside) {
+                if (z.kind != ConflictKind::Merge || !oInside)
+                    return;
+                double myRemain = C->length() - front;
+                double oRemain = O->length() - (so + oHalf);
+                bool oAhead = oRemain < myRemain ||
+                              (oRemain == myRemain && o->id() < id());
+                if (!oAhead)
+                    return;
+                double g = std::max(0.0, myRemain - oRemain - o->length());
+                if (g < gap) {
+                    gap = g;
+                    vFront = o->v();
+                    step_.sawObstacle = true;
+                }
+                return;
+            }
+            const double tO =
+                std::max(0.0, distO) / std::max(o->v(), kCrawlSpeed);
+            bool first = oInside || tO < tMe || (tO == tMe && o->id() < id());
+            if (!first || tO > kConflictHorizon)
+                return;
+            if (distMe < gap) {
+                gap = distMe;
+                vFront = 0.0;
+            }
+            step_.sawObstacle = true;
+        };
+
+        for (const Vehicle* o : world.occupancy->on(z.other)) {
+            if (o != this && o->laneId() == z.other)
+                consider(o, o->s());
+        }
+        if (meInside || !O->connectorFrom)
+            continue;
+        const LaneId from = *O->connectorFrom;
+        const Lane* F = world.net->getLane(from);
+        if (!F || world.carSignalForLane(from) == CarSignal::Red)
+            continue;
+        for (const Vehicle* o : world.occupancy->on(from)) {
+            double so = o->s() - F->length();
+            if (o != this && o->laneId() == from && so > -kConflictLookahead &&
+                o->nextRouteLane() == z.other)
+                consider(o, so);
         }
     }
 }
 
-void Vehicle::computeLongitudinal(WorldContext& world, const Lane& L,
-                                  double* outTargetAccel) {
+double Vehicle::curveSpeedAhead(const Lane& L, double from) const {
+    const auto& kappa = L.center.curvature();
+    const auto& st = L.center.stations();
+    double v = 1e9;
+    for (size_t i = 0; i < kappa.size(); ++i) {
+        double k = std::min(std::abs(kappa[i]), 1.0 / kMinTurnRadius);
+        if (st[i] < from || k < 1e-6)
+            continue;
+        double vc2 = params_.maxLateralAccel / k;
+        v = std::min(v, std::sqrt(vc2 + 2.0 * params_.comfyDecel *
+                                                (st[i] - from)));
+    }
+    return v;
+}
+
+void Vehicle::computeLongitudinal(WorldContext& world, const Lane& L) {
     double gapToLeader = 1e9;
     double vFront = params_.desiredSpeed;
+    step_.hasLeader = false;
+    step_.leaderStopped = false;
+    step_.sawObstacle = false;
     if (const Vehicle* leader =
         world.findLeaderInLane(L.id, s_, &gapToLeader)) {
         vFront = leader->v();
-    }
-    if (L.isConnector || abs(s_ - L.stopLineS.value()) < 2) {
-        std::vector<VisibleObject> objects = getVisibleObjects(world);
-        if (!objects.empty()) {
-            vFront = std::min(vFront, 0.0);
-            gapToLeader = std::min(gapToLeader, objects[0].distance);
-        }
-    }
-
-    double vLimit = std::min(params_.desiredSpeed, L.speedLimit);
+        step_.hasLeader = true;
+        step_.leaderStopped = leader->v() < 0.01;
+    }
+    if (!step_.hasLeader)
+        followAcrossLaneEnd(world, L, gapToLeader, vFront);
+    if (L.isConnector) {
+        yieldAtConflicts(world, L.id, s_, gapToLeader, vFront);
+    } else if (L.length() - s_ < kConflictLookahead) {
+        LaneId next = nextRouteLane();
+        const Lane* N = world.net->getLane(next);
+        if (N && N->isConnector)
+            yieldAtConflicts(world, next, s_ - L.length(), gapToLeader,
+                             vFront);
+    }
+
+    step_.vCurve = 1e9;
+    if (L.isConnector) {
+        step_.vCurve = curveSpeedAhead(L, s_);
+    } else if (double toEnd = L.length() - s_;
+               toEnd * 2.0 * params_.comfyDecel <
+               params_.desiredSpeed * params_.desiredSpeed) {
+        // Дальше тормозного пути с желаемой скорости поворот не ограничит
+        const Lane* N = world.net->getLane(nextRouteLane());
+        if (N && N->isConnector)
+            step_.vCurve = curveSpeedAhead(*N, -toEnd);
+    }
+    double vLimit =
+        std::min({params_.desiredSpeed, L.speedLimit, step_.vCurve});
 
     perceiveTrafficLight(world, L);
     if (L.stopLineS && perceivedSignal_.has_value()) {
@@ -117,18 +303,23 @@ void Vehicle::computeLongitudinal(WorldContext& world, const Lane& L,
         }
     }
 
-    double aIDM = idmAccel(v_, vFront, gapToLeader);
+    step_.gap = gapToLeader;
+    step_.vFront = vFront;
+    step_.vLimit = vLimit;
+}
 
-    if (gapToLeader > 200.0) {
-        if (v_ < vLimit)
-            aIDM = std::max(aIDM, 0.2 * params_.maxAccel);
-        else if (v_ > vLimit)
-            aIDM = std::min(aIDM, -0.5 * params_.comfyDecel);
+// На свободной дороге тянемся к ограничению скорости полосы
+double Vehicle::limitFreeRoadAccel(double aFollow) const {
+    if (step_.gap > 200.0) {
+        if (v_ < step_.vLimit)
+            aFollow = std::max(aFollow, 0.2 * params_.maxAccel);
+        else if (v_ > step_.vLimit)
+            aFollow = std::min(aFollow, -0.5 * params_.comfyDecel);
     }
 
-    // aIDM = std::clamp(aIDM, -params_.comfyDecel * 2.0, params_.maxAccel);
+    // aFollow = std::clamp(aFollow, -params_.comfyDecel * 2.0, params_.maxAccel);
 
-    *outTargetAccel = aIDM;
+    return aFollow;
 }
 
 void Vehicle::integrateKinematics(double dt) {
@@ -149,7 +340,6 @@ void Vehicle::integrateKinematics(double dt) {
 
 void Vehicle::advanceAlongRoute(WorldContext& world, double dt) {
     const RoadNetwork* net = world.net;
-    g_lastNet = net;
     const Lane* L = net->getLane(lane_);
     if (!L)
         return;
@@ -160,19 +350,19 @@ void Vehicle::advanceAlongRoute(WorldContext& world, double dt) {
         const RoutePlan& rp = route_.plan();
         int idx = route_.plan().startIndex;
         int nextIdx = -1;
-        for (int i = idx; i < (int)rp.steps.size(); ++i) {
-            if (rp.steps[i].lane == lane_) {
+        for (int i = idx; i < (int)rp.steps().size(); ++i) {
+            if (rp.steps()[i].lane == lane_) {
                 nextIdx = i + 1;
                 break;
             }
         }
-        if (nextIdx < 0 || nextIdx >= (int)rp.steps.size()) {
+        if (nextIdx < 0 || nextIdx >= (int)rp.steps().size()) {
             s_ = len;
             v_ = 0.0;
             a_ = 0.0;
             return;
         }
-        lane_ = rp.steps[nextIdx].lane;
+        lane_ = rp.steps()[nextIdx].lane;
         route_.advanceIfEntered(lane_);
         s_ = 0.0 + leftover;
         L = net->getLane(lane_);
@@ -190,7 +380,7 @@ void Vehicle::updateLaneChange(double dt, WorldContext& world) {
             checkLaneChangeRequirement(world);
             break;
         case LaneChangeState::Planning:
-            handlePlanningState(world);
+            handlePlanningState(world, dt);
             break;
         case LaneChangeState::Requesting:
             handleRequestingState(world);
@@ -215,16 +405,16 @@ void Vehicle::checkLaneChangeRequirement(WorldContext& world) {
     const RoutePlan& plan = route_.plan();
     int current_index = route_.plan().startIndex;
 
-    for (int i = current_index; i < (int)route_.plan().steps.size(); ++i) {
-        if (route_.plan().steps[i].lane == lane_) {
+    for (int i = current_index; i < (int)route_.plan().steps().size(); ++i) {
+        if (route_.plan().steps()[i].lane == lane_) {
             current_index = i;
             break;
         }
     }
 
-    if (current_index + 1 < plan.steps.size()) {
+    if (current_index + 1 < plan.steps().size()) {
         LaneId current_lane = lane_;
-        LaneId next_lane = plan.steps[current_index + 1].lane;
+        LaneId next_lane = plan.steps()[current_index + 1].lane;
 
         const Lane* current_lane_ptr = world.net->getLane(current_lane);
         if (!current_lane_ptr)
@@ -244,47 +434,45 @@ void Vehicle::checkLaneChangeRequirement(WorldContext& world) {
                                       .request_time = world.clock->now,
                                       .urgent = false};
                 lc_state_ = LaneChangeState::Planning;
+                planning_start_time_ = world.clock->now;
+                ++lc_epoch_;
+                world.schedule(planning_start_time_ + MAX_PLANNING_TIME, id(),
+                               TimerTag::PlanningTimeout, lc_epoch_);
             }
         }
     }
 }
 
-void Vehicle::handlePlanningState(WorldContext& world) {
-    if (planning_start_time_ == 0.0) {
-        planning_start_time_ = world.clock->now;
-    }
-
-    if (world.clock->now - planning_start_time_ > MAX_PLANNING_TIME) {
-        // std::cout << "KUHUHKHUHIL\n";
-        startLaneChangeExecution(world);
-        planning_start_time_ = 0.0;
-        return;
-    }
-
+template <typename Policy>
+void Vehicle::planLaneChange(WorldContext& world, double dt) {
     auto visible = getVisibleVehiclesInLane(world, lc_request_->target_lane);
     // std::cout << visible.size() << " " << id() << '\n';
-    if (visible.empty()) {
+    if (visible.empty() || Policy::accept(*this, visible, dt)) {
         startLaneChangeExecution(world);
-    } else {
-        bool can_merge = checkIfCanMergeSafely(visible);
-        can_merge
-            ? startLaneChangeExecution(world)
-            : sendYieldRequests(visible, world);
+    } else if constexpr (Policy::kNegotiates) {
+        sendYieldRequests(visible, world);
     }
 }
 
-void Vehicle::handleRequestingState(WorldContext& world) {
-    int yielding_count = countYieldingVehicles(world);
+void Vehicle::handlePlanningState(WorldContext& world, double dt) {
+    visitLaneChangeModel(params_.laneChange, [&](auto policy) {
+        planLaneChange<decltype(policy)>(world, dt);
+    });
+}
 
-    if (yielding_count > 0 || isLaneChangeUrgent()) {
+void Vehicle::handleRequestingState(WorldContext& world) {
+    if (grants_ > 0 || isLaneChangeUrgent()) {
         startLaneChangeExecution(world);
-    } else if (world.clock->now - lc_request_->request_time > 8.0) {
-        lc_state_ = lc_request_->urgent
-                        ? LaneChangeState::Executing
-                        : LaneChangeState::Aborting;
     }
 }
 
+// Никто не уступил за MAX_REQUEST_TIME
+void Vehicle::onRequestTimeout() {
+    lc_state_ = lc_request_->urgent
+                    ? LaneChangeState::Executing
+                    : LaneChangeState::Aborting;
+}
+
 void Vehicle::executeLaneChange(double dt, WorldContext& world) {
     lateral_progress_ += dt / driver_.laneChangeDuration;
 
@@ -305,12 +493,13 @@ void Vehicle::abortLaneChange(double dt, WorldContext& world) {
         lateral_progress_ = 0.0;
         lc_state_ = LaneChangeState::None;
         lc_request_.reset();
+        cancelYieldRequests(world);
     }
 }
 
-std::vector<VisibleVehicle> Vehicle::getVisibleVehiclesInLane(
+VisibleVehicles Vehicle::getVisibleVehiclesInLane(
     WorldContext& world, LaneId target_lane) {
-    std::vector<VisibleVehicle> result;
+    VisibleVehicles result(world.scratchResource());
 
     for (auto* obj : *world.vehicles) {
         if (obj->id() == id() || obj->type() != ObjectType::Vehicle)
@@ -336,71 +525,6 @@ std::vector<VisibleVehicle> Vehicle::getVisibleVehiclesInLane(
     return result;
 }
 
-std::vector<VisibleObject> Vehicle::getVisibleObjects(WorldContext& world) {
-    std::vector<VisibleObject> result;
-
-    for (auto* obj : *world.objects) {
-        if (obj->id() == id())
-            continue;
-
-        // Vehicle* other = static_cast<Vehicle*>(obj);
-        if (!canSee(*obj, params_.viewDistance, params_.fovRad))
-            continue;
-
-        double distance = calculateDistanceTo(*obj);
-        double speed = 0; // TODO для пешеходов
-        result.push_back({obj, distance, speed, true});
-    }
-
-    for (auto* obj : *world.vehicles) {
-        if (obj->id() == id())
-            continue;
-
-        Vehicle* other = static_cast<Vehicle*>(obj);
-        if (!canSee(*other, params_.viewDistance, params_.fovRad))
-            continue;
-
-        double distance = calculateDistanceTo(*other);
-        double speed = other->v();
-        result.push_back({other, distance, speed, true});
-    }
-
-    std::sort(result.begin(), result.end(),
-              [](const VisibleObject& a, const VisibleObject& b) {
-                  return a.distance < b.distance;
-              });
-
-    return result;
-}
-
-bool Vehicle::checkIfCanMergeSafely(const std::vector<VisibleVehicle>& vv) {
-    const double frontGapMin = params_.minGap * 1.5;
-    const double rearGapMin = params_.minGap * 1.5;
-    const double t_req = driver_.laneChangeDuration * 1.2;
-
-    for (const auto& v : vv) {
-        const Vehicle* o = v.vehicle;
-        double gap = signedLongitudinalGap(this, o);
-
-        if (gap >= 0.0) {
-            double closing = v_ - o->v();
-            if (gap < frontGapMin)
-                return false;
-            if (closing > 0.0 && gap / closing < t_req)
-                return false;
-        } else {
-            double gapBehind = -gap;
-            double closing = o->v() - v_;
-            if (gapBehind < rearGapMin)
-                return false;
-            if (closing > 0.0 && gapBehind / closing < t_req)
-                return false;
-        }
-    }
-    return true;
-}
-
-
 bool Vehicle::isLaneChangeStillSafe(WorldContext& world) {
     auto vis = getVisibleVehiclesInLane(world, lc_request_->target_lane);
     const double front = params_.minGap * 1.2;
@@ -421,25 +545,77 @@ bool Vehicle::isLaneChangeStillSafe(WorldContext& world) {
 }
 
 
-void Vehicle::sendYieldRequests(const std::vector<VisibleVehicle>& vehicles,
+void Vehicle::sendYieldRequests(const VisibleVehicles& vehicles,
                                 WorldContext& world) {
+    requested_.clear();
+    grants_ = 0;
     for (const auto& v : vehicles) {
-        v.vehicle->receiveYieldRequest(id(), lc_request_->urgent, world);
+        VehicleId to = static_cast<VehicleId>(v.vehicle->id());
+        world.post({id(), v.vehicle->id(), MessageType::YieldRequest,
+                    lc_request_->urgent, lc_epoch_});
+        requested_.push_back(to);
     }
     lc_state_ = LaneChangeState::Requesting;
+    world.schedule(lc_request_->request_time + MAX_REQUEST_TIME, id(),
+                   TimerTag::RequestTimeout, lc_epoch_);
+}
+
+// Запрошенные больше не нужны: перестроение закончено или отменено
+void Vehicle::cancelYieldRequests(WorldContext& world) {
+    for (VehicleId to : requested_)
+        world.post({id(), static_cast<uint64_t>(to), MessageType::YieldCancel,
+                    false, lc_epoch_});
+    requested_.clear();
+    grants_ = 0;
 }
 
+void Vehicle::onMessage(const VehicleMessage& msg, WorldContext& world) {
+    VehicleId from = static_cast<VehicleId>(msg.from);
+    switch (msg.type) {
+        case MessageType::YieldRequest:
+            receiveYieldRequest(from, msg.urgent, msg.epoch, world);
+            break;
+        case MessageType::YieldGrant:
+            if (lc_state_ == LaneChangeState::Requesting &&
+                msg.epoch == lc_epoch_)
+                grants_++;
+            break;
+        case MessageType::YieldCancel: {
+            auto it = std::find(yielding_to_.begin(), yielding_to_.end(), from);
+            if (it != yielding_to_.end()) {
+                yielding_to_.erase(it);
+                wake();
+            }
+            break;
+        }
+    }
+}
+
+// Чужое состояние только читаем; согласие уходит ответным сообщением
 void Vehicle::receiveYieldRequest(VehicleId requester_id, bool is_urgent,
-                                  WorldContext& world) {
-    Vehicle* requester = world.getVehicle(requester_id);
+                                  uint32_t epoch, WorldContext& world) {
+    const Vehicle* requester = world.getVehicle(requester_id);
     if (!requester)
         return;
 
+    wake();
+
     if (requester->s_ < s_ || abs(requester->s_ - s_) < 2) {
         return;
     }
 
-    received_requests_[requester_id] = world.clock->now;
+    auto req = std::find_if(received_requests_.begin(),
+                            received_requests_.end(),
+                            [&](const auto& r) { return r.first == requester_id; });
+    if (req != received_requests_.end())
+        req->second = world.clock->now;
+    else
+        received_requests_.emplace_back(requester_id, world.clock->now);
+    if (!cleanup_scheduled_) {
+        cleanup_scheduled_ = true;
+        world.schedule(world.clock->now + REQUEST_TTL, id(),
+                       TimerTag::RequestCleanup);
+    }
 
     double yield_prob = driver_.politeness;
     if (is_urgent)
@@ -448,27 +624,20 @@ void Vehicle::receiveYieldRequest(VehicleId requester_id, bool is_urgent,
         yield_prob += 0.3;
 
     if (rng_.uniform() < yield_prob) {
-        yielding_to_.insert(requester_id);
+        if (!isYieldingTo(requester_id))
+            yielding_to_.push_back(requester_id);
         startYielding(requester);
+        world.post({id(), requester->id(), MessageType::YieldGrant,
+                    is_urgent, epoch});
     }
 }
 
-int Vehicle::countYieldingVehicles(WorldContext& world) {
-    auto visible = getVisibleVehiclesInLane(world, lc_request_->target_lane);
-    int count = 0;
-    for (const auto& v : visible) {
-        if (v.vehicle->isYieldingTo(id()))
-            count++;
-    }
-    return count;
-}
-
 // Начало уступки
-void Vehicle::startYielding(Vehicle* requester) {
+void Vehicle::startYielding(const Vehicle* requester) {
     // std::cout << id() << " yielding to " << requester->id() << "\n";
     double distance = calculateDistanceTo(*requester);
     if (distance < params_.minGap * 3.0) {
-        a_ = std::min(a_, -params_.comfyDecel);
+        a_ = Real(std::min<double>(a_, -params_.comfyDecel));
     }
 }
 
@@ -486,15 +655,24 @@ void Vehicle::updateYieldingBehavior(WorldContext& world) {
             it = yielding_to_.erase(it);
         }
     }
+}
 
-    // Очистка старых запросов
-    auto now = world.clock->now;
+// Очистка старых запросов; пока они есть - ждём следующего истечения
+void Vehicle::cleanupReceivedRequests(double now, WorldContext& world) {
+    cleanup_scheduled_ = false;
+    double oldest = now;
     for (auto it = received_requests_.begin();
          it != received_requests_.end();) {
-        if (now - it->second > 10.0)
+        if (now - it->second >= REQUEST_TTL) {
             it = received_requests_.erase(it);
-        else
+        } else {
+            oldest = std::min(oldest, it->second);
             ++it;
+        }
+    }
+    if (!received_requests_.empty()) {
+        cleanup_scheduled_ = true;
+        world.schedule(oldest + REQUEST_TTL, id(), TimerTag::RequestCleanup);
     }
 }
 
@@ -502,7 +680,7 @@ void Vehicle::maintainYielding(Vehicle* other) {
     double distance = calculateDistanceTo(*other);
     if (distance < params_.minGap * 2.0 && v_ > 0.1) {
         // std::cout << id() << " i need to stop\n";
-        a_ = std::min(a_, -params_.comfyDecel * 0.7);
+        a_ = Real(std::min<double>(a_, -params_.comfyDecel * 0.7));
     }
 }
 
@@ -519,6 +697,7 @@ void Vehicle::completeLaneChange(WorldContext& world) {
     lc_state_ = LaneChangeState::None;
     lc_request_.reset();
     yielding_to_.clear();
+    cancelYieldRequests(world);
 }
 
 // Обновление боковой позиции
@@ -536,27 +715,70 @@ bool Vehicle::isLaneChangeUrgent() const {
 }
 
 bool Vehicle::isYieldingTo(VehicleId vehicle_id) const {
-    return yielding_to_.count(vehicle_id) > 0;
+    return std::find(yielding_to_.begin(), yielding_to_.end(), vehicle_id) !=
+           yielding_to_.end();
 }
 
-void Vehicle::update(double dt, WorldContext& world) {
-    g_lastNet = world.net;
+void Vehicle::onTimer(const TimerEvent& e, WorldContext& world) {
+    switch (e.tag) {
+        case TimerTag::SignalPerception:
+            refreshPerceivedSignal(world);
+            break;
+        case TimerTag::PlanningTimeout:
+            if (lc_state_ == LaneChangeState::Planning && e.cookie == lc_epoch_)
+                startLaneChangeExecution(world);
+            break;
+        case TimerTag::RequestTimeout:
+            if (lc_state_ == LaneChangeState::Requesting &&
+                e.cookie == lc_epoch_)
+                onRequestTimeout();
+            break;
+        case TimerTag::RequestCleanup:
+            cleanupReceivedRequests(world.clock->now, world);
+            break;
+        case TimerTag::PhaseExpiry:
+        case TimerTag::Arrival:
+            break; // события светофоров и спроса, не машин
+    }
+}
+
+void Vehicle::beginStep(double dt, WorldContext& world) {
+    prevLane_ = lane_;
+    prevS_ = s_;
+    prevD_ = d_;
     updateLaneChange(dt, world);
 
     const Lane* L = world.net->getLane(lane_);
 
-    if ((lc_request_.has_value() &&
-         (lc_state_ != LaneChangeState::Executing &&
-          lc_state_ != LaneChangeState::Aborting)) ||
-        !yielding_to_.empty()) {
+    step_.holding = (lc_request_.has_value() &&
+                     (lc_state_ != LaneChangeState::Executing &&
+                      lc_state_ != LaneChangeState::Aborting)) ||
+                    !yielding_to_.empty();
+    step_.follow = !step_.holding && L;
+
+    if (step_.holding) {
         v_ = 0.0;
         a_ = 0.0;
         mode_ = VehicleMode::Stopped;
-    } else {
-        if (L) {
-            double target_accel = 0.0;
-            computeLongitudinal(world, *L, &target_accel);
-            a_ = target_accel;
+    } else if (L) {
+        computeLongitudinal(world, *L);
+        if (params_.following == FollowingModel::Krauss)
+            step_.noise = rng_.uniform();
+    }
+}
+
+int Vehicle::pushFollowRow(FollowBatches& batches) const {
+    if (!step_.follow)
+        return -1;
+    return batches.push(params_.following,
+                        followInputs(step_.vFront, step_.gap, step_.noise));
+}
+
+void Vehicle::endStep(double dt, WorldContext& world, double aFollow) {
+    if (!step_.holding) {
+        if (step_.follow) {
+            coastFollow_ = aFollow;
+            a_ = limitFreeRoadAccel(aFollow);
         }
         integrateKinematics(dt);
     }
@@ -564,6 +786,87 @@ void Vehicle::update(double dt, WorldContext& world) {
     if (lc_state_ == LaneChangeState::None) {
         advanceAlongRoute(world, dt);
     }
+    updateCoarse(world);
+}
+
+// Крупный шаг только там, где ближайшие kCoarseInterval ничего не
+// происходит: нет лидера, препятствий, перестроения, светофор не мешает,
+// до конца полосы далеко и скорость почти равна целевой
+void Vehicle::updateCoarse(WorldContext& world) {
+    coarseUntil_ = 0.0;
+    const Lane* L = world.net->getLane(lane_);
+    if (!L || L->isConnector || !step_.follow || step_.sawObstacle)
+        return;
+    if (step_.gap <= 200.0 || lc_state_ != LaneChangeState::None ||
+        lc_request_ || !yielding_to_.empty() ||
+        time_since_spawn_ < driver_.minLaneChangeDelay)
+        return;
+    if (perceivedSignal_ && *perceivedSignal_ != CarSignal::Green)
+        return;
+    if (mode_ != VehicleMode::Driving || v_ < 1.0 ||
+        std::abs(v_ - step_.vLimit) > 1.0)
+        return;
+    // Дальше, чем начинается проверка перестроения (30 м) и торможение,
+    // в том числе перед поворотом
+    double margin = 35.0 + v_ * kCoarseInterval;
+    if (const Lane* N = world.net->getLane(nextRouteLane());
+        N && N->isConnector) {
+        double vc = curveSpeedAhead(*N, 0.0);
+        margin += std::max(0.0, v_ * v_ - vc * vc) / (2.0 * params_.comfyDecel);
+    }
+    if (L->length() - s_ < margin)
+        return;
+    coarseUntil_ = world.clock->now + kCoarseInterval;
+}
+
+// Тик без восприятия и модели следования: ускорение модели - с последнего
+// полного шага, ограничение по скорости и интегрирование - как в нём
+void Vehicle::coast(double dt, WorldContext& world) {
+    prevLane_ = lane_;
+    prevS_ = s_;
+    prevD_ = d_;
+    time_since_spawn_ += dt;
+
+    a_ = limitFreeRoadAccel(coastFollow_);
+    integrateKinematics(dt);
+    advanceAlongRoute(world, dt);
+}
+
+// Подползание со скоростью ниже порога остановки движением не считаем
+bool Vehicle::movedLastStep() const {
+    return lane_ != prevLane_ || d_ != prevD_ ||
+           (s_ != prevS_ && mode_ != VehicleMode::Stopped);
+}
+
+// Стоим в очереди за стоящим лидером (или у стоп-линии) и не собираемся
+// трогаться: дальнейшие шаги ничего не меняют до внешнего события
+bool Vehicle::trySleep() {
+    bool steady = mode_ == VehicleMode::Stopped && a_ < 0.05 &&
+                  !movedLastStep() && !step_.holding && step_.follow &&
+                  !step_.sawObstacle && time_since_spawn_ >= 1.0 &&
+                  lc_state_ == LaneChangeState::None && !lc_request_ &&
+                  yielding_to_.empty();
+    bool leaderIdle = !step_.hasLeader || step_.leaderStopped;
+    if (!steady || !leaderIdle)
+        return false;
+
+    v_ = 0.0;
+    a_ = 0.0;
+    asleep_ = true;
+    return true;
+}
+
+void Vehicle::update(double dt, WorldContext& world) {
+    beginStep(dt, world);
+    double aFollow = 0.0;
+    if (step_.follow) {
+        const FollowInputs in =
+            followInputs(step_.vFront, step_.gap, step_.noise);
+        aFollow = visitFollowingModel(params_.following, [&](auto model) {
+            return decltype(model)::accel(in, dt);
+        });
+    }
+    endStep(dt, world, aFollow);
 }
 
 } // namespace sim
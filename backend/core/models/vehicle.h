@@ -1,9 +1,12 @@
 #pragma once
+#include <memory_resource>
 #include <optional>
 #include <random>
 #include "sim_object.h"
 #include "routing.h"
 #include "world_context.h"
+#include "car_following.h"
+#include "small_vec.h"
 
 namespace sim {
 
@@ -19,6 +22,12 @@ struct VehicleParams {
     // секунды латерального перехода (когда добавите LC)
     double viewDistance{80.0};
     double fovRad{0.7}; // ~149°
+    FollowingModel following{FollowingModel::Idm};
+    LaneChangeModel laneChange{LaneChangeModel::Cooperative};
+    double maxDecel{4.0};     // предельное торможение (Gipps, Krauss, MOBIL)
+    double reactionTime{1.0}; // время реакции в Gipps и Krauss
+    double dawdle{0.5};       // случайное замедление Krauss, доля a*dt
+    double maxLateralAccel{3.0}; // поперечное ускорение в повороте, м/с^2
 };
 
 struct DriverProfile {
@@ -32,13 +41,6 @@ struct DriverProfile {
     double laneChangeDuration = 2.0; // секунд на полное перестроение
 };
 
-struct VisibleObject {
-    SimObject* object;
-    double distance;
-    double speed;
-    bool isInTargetLane;
-};
-
 enum class VehicleMode { Driving, Braking, Stopped, LaneChanging };
 
 struct RNG {
@@ -73,14 +75,20 @@ struct VisibleVehicle {
     bool is_in_target_lane;
 };
 
+// Выборки живут в арене тика (WorldContext::scratch)
+using VisibleVehicles = std::pmr::vector<VisibleVehicle>;
+
 
 class Vehicle : public SimObject {
 public:
-    Vehicle(const VehicleParams& vp, const DriverProfile& dp,
-            LaneId lane, double s0, double v0,
-            RouteTracker rt);
+    // id выдаёт Simulation, счёт у каждой симуляции свой: от id зависит
+    // и зерно RNG машины. handedOver - выход из мезо-модели в микро-зону
+    Vehicle(uint64_t id, const VehicleParams& vp, const DriverProfile& dp,
+            LaneId lane, double s0, double v0, RouteTracker rt,
+            bool handedOver = false);
 
-    static Vehicle randomVehicle(int from, RouteTracker rt);
+    static Vehicle randomVehicle(uint64_t id, int from, RouteTracker rt,
+                                 const VehicleClass& cls = {});
 
     static inline double signedLongitudinalGap(const Vehicle* ego,
                                                const Vehicle* other) {
@@ -96,8 +104,22 @@ public:
 
     double v() const { return v_; }
 
+    double a() const { return a_; }
+
+    double d() const { return d_; }
+
     VehicleMode mode() const { return mode_; }
 
+    const VehicleParams& params() const { return params_; }
+
+    const DriverProfile& driver() const { return driver_; }
+
+    // Не перестраивается и никому не уступает: можно передать в мезо-модель
+    bool laneChangeIdle() const {
+        return lc_state_ == LaneChangeState::None && !lc_request_ &&
+               yielding_to_.empty() && d_ == 0.0;
+    }
+
     Pose pose() const override;
 
     double boundingRadius() const override {
@@ -107,6 +129,51 @@ public:
 
     void update(double dt, WorldContext& world) override;
 
+    // Шаг в две фазы для пакетных моделей следования (Simulation::update):
+    // beginStep - перестроение и сбор входов, pushFollowRow - строка в пакет
+    // своей модели (-1, если ускорение не нужно), endStep - интегрирование
+    // и движение.
+    void beginStep(double dt, WorldContext& world);
+
+    int pushFollowRow(FollowBatches& batches) const;
+
+    void endStep(double dt, WorldContext& world, double aFollow);
+
+    // Ускорение своей модели следования за лидером со скоростью vFront
+    // на зазоре gap, без случайной составляющей (оценки при перестроении)
+    double followingAccel(double vFront, double gap, double dt) const;
+
+    // Спящая машина стоит в очереди и пропускается в Simulation::update.
+    // Будят её движение впереди по полосе, смена сигнала и запрос уступки.
+    bool asleep() const { return asleep_; }
+
+    void wake() {
+        asleep_ = false;
+        coarseUntil_ = 0.0;
+    }
+
+    bool trySleep();
+
+    bool movedLastStep() const;
+
+    // Многошаговое интегрирование: одна на свободной дороге с ровной
+    // скоростью машина делает полный шаг раз в kCoarseInterval, между ними
+    // (coast) - только кинематика с ускорением модели следования с
+    // последнего полного шага. Оно за интервал меняется не больше чем
+    // на свою величину |a|, так что за интервал положение уходит от шага
+    // на каждом тике не больше чем на 0.5 * |a| * kCoarseInterval^2.
+    static constexpr double kCoarseInterval = 0.5;
+
+    bool coasting(double now) const { return now < coarseUntil_; }
+
+    void coast(double dt, WorldContext& world);
+
+    // Доставка сообщения другой машины (фаза обмена после шага)
+    void onMessage(const VehicleMessage& msg, WorldContext& world);
+
+    // Срабатывание таймера, поставленного этой машиной
+    void onTimer(const TimerEvent& e, WorldContext& world);
+
     RouteTracker& route() { return route_; }
 
     const RouteTracker& route() const { return route_; }
@@ -115,16 +182,20 @@ public:
         return route_.nextConnector();
     }
 
+    // Полоса маршрута после текущей (-1 - маршрут здесь кончается)
+    LaneId nextRouteLane() const;
+
 private:
     VehicleParams params_;
     DriverProfile driver_;
     RNG rng_;
 
     LaneId lane_{-1};
-    double s_{0.0}; // положение вдоль полосы (м)
-    double d_{0.0}; // поперечный оффсет
-    double v_{0.0}; // скорость (м/с)
-    double a_{0.0}; // текущ. продольное ускорение
+    // Горячее состояние в скаляре сборки (Real), наружу - double
+    Real s_{0}; // положение вдоль полосы (м)
+    Real d_{0}; // поперечный оффсет
+    Real v_{0}; // скорость (м/с)
+    Real a_{0}; // текущ. продольное ускорение
     VehicleMode mode_{VehicleMode::Driving};
 
     std::optional<CarSignal> perceivedSignal_;
@@ -136,23 +207,78 @@ private:
 
     void perceiveTrafficLight(WorldContext& world, const Lane& L);
 
-    void computeLongitudinal(WorldContext& world, const Lane& L,
-                             double* outTargetAccel);
+    void refreshPerceivedSignal(WorldContext& world);
+
+    void onRequestTimeout();
+
+    void cleanupReceivedRequests(double now, WorldContext& world);
+
+    // Входы продольной модели текущего шага
+    struct StepState {
+        bool holding{false}; // стоим: ждём перестроения или уступаем
+        bool follow{false};  // нужен IDM
+        double gap{1e9};
+        double vFront{0.0};
+        double vLimit{0.0};
+        double vCurve{1e9}; // предел по кривизне впереди (желаемая в модели)
+        bool hasLeader{false};
+        bool leaderStopped{false};
+        bool sawObstacle{false}; // мешал объект из поля зрения
+        double noise{0.0};       // случайное число модели Krauss
+    };
+
+    StepState step_;
+    bool asleep_{false};
+    LaneId prevLane_{-1};
+    double prevS_{0.0};
+    double prevD_{0.0};
+    double coarseUntil_{0.0};
+    double coastFollow_{0.0}; // ускорение модели на последнем полном шаге
+
+    void updateCoarse(WorldContext& world);
+
+    void computeLongitudinal(WorldContext& world, const Lane& L);
+
+    double limitFreeRoadAccel(double aFollow) const;
 
     void integrateKinematics(double dt);
 
     void advanceAlongRoute(WorldContext& world, double dt);
 
-    double idmAccel(double v, double vFront, double gap) const;
+    FollowInputs followInputs(double vFront, double gap, double noise) const;
+
+    // Лидер в начале следующей полосы маршрута, если на своей его нет.
+    // Помеха сужает gap и vFront.
+    void followAcrossLaneEnd(WorldContext& world, const Lane& L, double& gap,
+                             double& vFront);
+
+    // Уступка в зонах конфликта коннектора conn; s - своё положение на
+    // нём (отрицательное - ещё на подъезде)
+    void yieldAtConflicts(WorldContext& world, LaneId conn, double s,
+                          double& gap, double& vFront);
+
+    // Наибольшая скорость в точке from полосы L, с которой успеваем
+    // комфортно сбросить до v = sqrt(maxLateralAccel / |kappa|) в каждой
+    // вершине кривой впереди; from < 0 - ещё на подъезде. Изломы
+    // коннекторов с короткими ручками считаем поворотом kMinTurnRadius.
+    [[nodiscard]] double curveSpeedAhead(const Lane& L, double from) const;
+
+    static constexpr double kMinTurnRadius = 5.0; // м
 
-    std::vector<VisibleObject> getVisibleObjects(WorldContext& world);
+    static constexpr double kConflictLookahead = 15.0; // м до коннектора
+    static constexpr double kCrawlSpeed = 2.0;  // для оценки времени подъезда
+    static constexpr double kConflictHorizon = 8.0; // дальше по времени - не мешает
 
     // ПЕРЕСТРОЙКА ААА
     void updateLaneChange(double dt, WorldContext& world);
 
     void checkLaneChangeRequirement(WorldContext& world);
 
-    void handlePlanningState(WorldContext& world);
+    void handlePlanningState(WorldContext& world, double dt);
+
+    // Шаг планирования с политикой перестроения (lane_change.h)
+    template <typename Policy>
+    void planLaneChange(WorldContext& world, double dt);
 
     void handleRequestingState(WorldContext& world);
 
@@ -160,19 +286,17 @@ private:
 
     void abortLaneChange(double dt, WorldContext& world);
 
-    bool checkIfCanMergeSafely(const std::vector<VisibleVehicle>& visible);
-
     bool isLaneChangeStillSafe(WorldContext& world);
 
-    void sendYieldRequests(const std::vector<VisibleVehicle>& vehicles,
+    void sendYieldRequests(const VisibleVehicles& vehicles,
                            WorldContext& world);
 
-    int countYieldingVehicles(WorldContext& world);
-
     void receiveYieldRequest(VehicleId requester_id, bool is_urgent,
-                             WorldContext& world);
+                             uint32_t epoch, WorldContext& world);
 
-    void startYielding(Vehicle* requester);
+    void cancelYieldRequests(WorldContext& world);
+
+    void startYielding(const Vehicle* requester);
 
     void updateYieldingBehavior(WorldContext& world);
 
@@ -188,7 +312,7 @@ private:
 
     bool isYieldingTo(VehicleId vehicle_id) const;
 
-    std::vector<VisibleVehicle> getVisibleVehiclesInLane(
+    VisibleVehicles getVisibleVehiclesInLane(
         WorldContext& world, LaneId target_lane);
 
     LaneChangeState lc_state_ = LaneChangeState::None;
@@ -197,10 +321,19 @@ private:
     double lateral_progress_ = 0.0;
     double time_since_spawn_ = 0.0;
 
-    std::unordered_set<VehicleId> yielding_to_;
-    std::unordered_map<VehicleId, double> received_requests_;
+    // Плоские списки: их мало, место - внутри машины, так что ни
+    // появление машины, ни уступки посреди тика не трогают кучу
+    SmallVec<VehicleId, 4> yielding_to_;
+    SmallVec<std::pair<VehicleId, double>, 4> received_requests_;
+    SmallVec<VehicleId, 16> requested_; // кому отправлен запрос текущей попытки
+    int grants_ = 0;                   // сколько ответили согласием
+
+    uint32_t lc_epoch_ = 0; // номер текущей попытки перестроения
+    bool cleanup_scheduled_ = false;
 
     double MAX_PLANNING_TIME = 5.0;
+    double MAX_REQUEST_TIME = 8.0;
+    double REQUEST_TTL = 10.0;
 
 };
 
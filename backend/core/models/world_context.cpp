@@ -1,5 +1,6 @@
 #include "world_context.h"
 #include "vehicle.h"
+#include <algorithm>
 
 namespace sim {
 
@@ -23,6 +24,29 @@ Vehicle* WorldContext::findLeaderInLane(int laneId, double myS,
     return best;
 }
 
+void LaneOccupancy::rebuild(const std::vector<Vehicle*>& vehicles,
+                            LaneId maxLane) {
+    const size_t n = static_cast<size_t>(std::max(maxLane, 0)) + 1;
+    start_.assign(n + 1, 0);
+    for (const Vehicle* v : vehicles) {
+        LaneId lane = v->laneId();
+        if (lane >= 0 && static_cast<size_t>(lane) < n)
+            start_[lane + 1]++;
+    }
+    for (size_t i = 0; i < n; ++i)
+        start_[i + 1] += start_[i];
+    items_.resize(start_[n]);
+    // Раскладываем, сдвигая начала к концам, затем возвращаем на место
+    for (Vehicle* v : vehicles) {
+        LaneId lane = v->laneId();
+        if (lane >= 0 && static_cast<size_t>(lane) < n)
+            items_[start_[lane]++] = v;
+    }
+    for (size_t i = n; i > 0; --i)
+        start_[i] = start_[i - 1];
+    start_[0] = 0;
+}
+
 CarSignal WorldContext::carSignalForLane(int laneId) const {
     if (!net)
         return CarSignal::Green;
@@ -35,7 +59,23 @@ CarSignal WorldContext::carSignalForLane(int laneId) const {
     return g ? g->state() : CarSignal::Green;
 }
 
+void WorldContext::schedule(double due, uint64_t owner, TimerTag tag,
+                            uint32_t cookie) const {
+    if (deferredTimers)
+        deferredTimers->push_back(TimerEvent{due, owner, tag, cookie, 0});
+    else if (timers)
+        timers->schedule(due, owner, tag, cookie);
+}
+
 Vehicle* WorldContext::getVehicle(int vehicleId) const {
+    if (vehicleIndex) {
+        auto key = static_cast<uint64_t>(vehicleId);
+        auto it = std::lower_bound(
+            vehicleIndex->begin(), vehicleIndex->end(), key,
+            [](const auto& e, uint64_t k) { return e.first < k; });
+        return (it != vehicleIndex->end() && it->first == key) ? it->second
+                                                               : nullptr;
+    }
     for (Vehicle* vehicle : *vehicles) {
         if (vehicle->id() == vehicleId) {
             return vehicle;
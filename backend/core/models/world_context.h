@@ -1,7 +1,13 @@
 #pragma once
 #include <vector>
+#include <memory_resource>
+#include <span>
+#include <utility>
+#include "conflicts.h"
 #include "road_network.h"
 #include "signals.h"
+#include "timer_wheel.h"
+#include "mailbox.h"
 
 namespace sim {
 
@@ -12,6 +18,27 @@ struct SimulationClock {
     double now{0.0};  // текущее моделируемое время, сек
 };
 
+// Пары (id, машина), отсортированные по id: поиск без обращений к куче
+using VehicleIndex = std::vector<std::pair<uint64_t, Vehicle*>>;
+
+// Машины по полосам: сортировка подсчётом по id полосы, внутри полосы -
+// порядок исходного списка. Строится перед шагом машин, так что полосы
+// - состояние начала тика.
+class LaneOccupancy {
+public:
+    void rebuild(const std::vector<Vehicle*>& vehicles, LaneId maxLane);
+
+    [[nodiscard]] std::span<Vehicle* const> on(LaneId lane) const {
+        if (lane < 0 || static_cast<size_t>(lane) + 1 >= start_.size())
+            return {};
+        return {items_.data() + start_[lane], items_.data() + start_[lane + 1]};
+    }
+
+private:
+    std::vector<uint32_t> start_;
+    std::vector<Vehicle*> items_;
+};
+
 struct WorldContext {
     const RoadNetwork* net{nullptr};
     SignalController* signals{nullptr};
@@ -20,6 +47,37 @@ struct WorldContext {
     const std::vector<SimObject*>* objects{nullptr};
     const std::vector<Vehicle*>* vehicles{nullptr};
 
+    TimerWheel* timers{nullptr};
+    const VehicleIndex* vehicleIndex{nullptr};
+
+    // Параллельный проход по областям: таймеры копятся здесь и ставятся
+    // в колесо после прохода в порядке областей (детерминированно)
+    std::vector<TimerEvent>* deferredTimers{nullptr};
+
+    // Зоны конфликтов коннекторов и машины по полосам для их проверки
+    const ConflictTable* conflicts{nullptr};
+    const LaneOccupancy* occupancy{nullptr};
+
+    // Исходящие сообщения машин текущего тика
+    Mailbox* outbox{nullptr};
+
+    // Арена текущего тика для временных выборок (сбрасывается симуляцией)
+    std::pmr::memory_resource* scratch{nullptr};
+
+    [[nodiscard]] std::pmr::memory_resource* scratchResource() const {
+        return scratch ? scratch : std::pmr::get_default_resource();
+    }
+
+    // Разбудить владельца в момент due (без колеса таймеров - ничего не делает)
+    void schedule(double due, uint64_t owner, TimerTag tag,
+                  uint32_t cookie = 0) const;
+
+    // Отправить сообщение (без ящика - теряется)
+    void post(const VehicleMessage& msg) const {
+        if (outbox)
+            outbox->push_back(msg);
+    }
+
     Vehicle* findLeaderInLane(int laneId, double myS,
                               double* outGapMeters) const;
 
@@ -0,0 +1,55 @@
+#include "alloc_counter.h"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#ifdef ITS_COUNT_ALLOCATIONS
+
+static std::atomic<uint64_t> g_allocations{0};
+
+void* operator new(std::size_t size) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+namespace sim::alloc {
+
+uint64_t count() {
+    return g_allocations.load(std::memory_order_relaxed);
+}
+
+}  // namespace sim::alloc
+
+#else
+
+namespace sim::alloc {
+
+uint64_t count() {
+    return 0;
+}
+
+}  // namespace sim::alloc
+
+#endif
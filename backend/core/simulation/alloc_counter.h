@@ -0,0 +1,10 @@
+#pragma once
+#include <cstdint>
+
+namespace sim::alloc {
+
+// Число обращений к operator new с начала работы процесса.
+// Считается только при сборке с ITS_COUNT_ALLOCATIONS, иначе всегда 0.
+uint64_t count();
+
+}  // namespace sim::alloc
@@ -0,0 +1,173 @@
+#include "demand.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <sstream>
+
+namespace sim {
+
+bool parseOdMatrix(std::istream& in, std::vector<OdSlice>& out,
+                   std::string& error) {
+    out.clear();
+    std::string line;
+    int lineNo = 0;
+    while (std::getline(in, line)) {
+        ++lineNo;
+        auto hash = line.find('#');
+        if (hash != std::string::npos)
+            line.erase(hash);
+        std::istringstream iss(line);
+        double start = 0.0;
+        OdEntry e;
+        if (!(iss >> start)) {
+            if (line.find_first_not_of(" \t\r") == std::string::npos)
+                continue;
+            error = "line " + std::to_string(lineNo) + ": expected t_from";
+            return false;
+        }
+        std::string extra;
+        if (!(iss >> e.origin >> e.destination >> e.rate) || (iss >> extra) ||
+            e.rate < 0.0) {
+            error = "line " + std::to_string(lineNo) +
+                    ": expected 't_from origin destination rate'";
+            return false;
+        }
+        if (out.empty() || out.back().start != start) {
+            if (!out.empty() && start < out.back().start) {
+                error = "line " + std::to_string(lineNo) +
+                        ": slices must go in increasing t_from";
+                return false;
+            }
+            out.push_back({start, {}});
+        }
+        out.back().entries.push_back(e);
+    }
+    return true;
+}
+
+void DemandModel::setMatrix(std::vector<OdSlice> slices,
+                            const RoadNetwork& net) {
+    slices_ = std::move(slices);
+    origins_.clear();
+    originOf_.assign(static_cast<size_t>(net.maxLaneId()) + 1, -1);
+
+    for (const OdSlice& slice : slices_) {
+        for (const OdEntry& e : slice.entries) {
+            if (!net.getLane(e.origin) || !net.getLane(e.destination))
+                continue;
+            if (originOf_[e.origin] < 0) {
+                originOf_[e.origin] = static_cast<int>(origins_.size());
+                origins_.emplace_back();
+                origins_.back().lane = e.origin;
+            }
+        }
+    }
+
+    const size_t nSlices = slices_.size();
+    for (Origin& o : origins_) {
+        o.total.assign(nSlices, 0.0);
+        o.cumulative.assign(nSlices, {});
+        o.destinations.assign(nSlices, {});
+    }
+    for (size_t s = 0; s < nSlices; ++s) {
+        for (const OdEntry& e : slices_[s].entries) {
+            if (e.rate <= 0.0 || !net.getLane(e.destination) ||
+                originOf(e.origin) < 0)
+                continue;
+            Origin& o = origins_[originOf_[e.origin]];
+            o.total[s] += e.rate / 3600.0;
+            o.cumulative[s].push_back(o.total[s]);
+            o.destinations[s].push_back(e.destination);
+        }
+    }
+}
+
+size_t DemandModel::sliceAt(double t) const {
+    auto it = std::upper_bound(
+        slices_.begin(), slices_.end(), t,
+        [](double x, const OdSlice& s) { return x < s.start; });
+    return it == slices_.begin() ? 0
+                                 : static_cast<size_t>(it - slices_.begin()) - 1;
+}
+
+void DemandModel::start(double now, TimerWheel& timers, RNG& rng) {
+    ++epoch_;
+    for (size_t o = 0; o < origins_.size(); ++o)
+        scheduleNext(o, now, timers, rng);
+}
+
+// Следующее прибытие по текущей интенсивности. Если оно позже начала
+// следующего среза, ставится пересчёт на границу: поток без памяти,
+// так что розыгрыш с границы заново даёт верный процесс. До первого
+// среза спроса нет, граница - начало самого первого среза.
+void DemandModel::scheduleNext(size_t o, double now, TimerWheel& timers,
+                               RNG& rng) {
+    if (slices_.empty())
+        return;
+    const size_t s = sliceAt(now);
+    const bool before = now < slices_[s].start;
+    const double boundary = before ? slices_[s].start
+                            : s + 1 < slices_.size()
+                                ? slices_[s + 1].start
+                                : std::numeric_limits<double>::infinity();
+    const double rate = before ? 0.0 : origins_[o].total[s] * scale_;
+
+    double due = std::numeric_limits<double>::infinity();
+    if (rate > 0.0)
+        due = now - std::log(1.0 - rng.uniform()) / rate;
+
+    const uint32_t cookie = epoch_ << 1;
+    if (due < boundary)
+        timers.schedule(due, o, TimerTag::Arrival, cookie | 1u);
+    else if (std::isfinite(boundary))
+        timers.schedule(boundary, o, TimerTag::Arrival, cookie);
+}
+
+void DemandModel::onArrival(const TimerEvent& e, TimerWheel& timers,
+                            RNG& rng) {
+    if ((e.cookie >> 1) != (epoch_ & 0x7fffffffu) || e.owner >= origins_.size())
+        return;
+    const size_t o = e.owner;
+
+    if (e.cookie & 1u) {
+        const Origin& org = origins_[o];
+        const size_t s = sliceAt(e.due);
+        const auto& cum = org.cumulative[s];
+        if (!cum.empty()) {
+            double r = rng.uniform(0.0, cum.back());
+            auto it = std::upper_bound(cum.begin(), cum.end(), r);
+            size_t d = std::min(static_cast<size_t>(it - cum.begin()),
+                                cum.size() - 1);
+            push(o, {org.destinations[s][d], e.due});
+        }
+    }
+    scheduleNext(o, e.due, timers, rng);
+}
+
+void DemandModel::push(size_t o, const Pending& p) {
+    Origin& org = origins_[o];
+    if (org.count == kQueueCapacity) {
+        ++dropped_;
+        return;
+    }
+    org.queue[(org.head + org.count) % kQueueCapacity] = p;
+    org.count++;
+}
+
+void DemandModel::pop(size_t o) {
+    Origin& org = origins_[o];
+    if (org.count == 0)
+        return;
+    org.head = (org.head + 1) % kQueueCapacity;
+    org.count--;
+}
+
+void DemandModel::clearPending() {
+    for (Origin& org : origins_) {
+        org.head = 0;
+        org.count = 0;
+    }
+    dropped_ = 0;
+}
+
+} // namespace sim
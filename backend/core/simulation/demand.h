@@ -0,0 +1,116 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <istream>
+#include <string>
+#include <vector>
+#include "../models/road_network.h"
+#include "../models/timer_wheel.h"
+#include "../models/vehicle.h"
+
+namespace sim {
+
+// Поток корреспонденции origin -> destination, авт/ч
+struct OdEntry {
+    LaneId origin{-1};
+    LaneId destination{-1};
+    double rate{0.0};
+};
+
+// Срез матрицы: действует с момента start до начала следующего
+struct OdSlice {
+    double start{0.0};
+    std::vector<OdEntry> entries;
+};
+
+// Матрица из текста: строки "t_from origin destination rate" (авт/ч),
+// '#' - комментарий. Строки с одним t_from образуют срез.
+bool parseOdMatrix(std::istream& in, std::vector<OdSlice>& out,
+                   std::string& error);
+
+// Спрос по матрице корреспонденций. У каждого источника (въездной
+// полосы) свой пуассоновский поток с кусочно-постоянной интенсивностью;
+// прибытия - события TimerTag::Arrival в общем колесе таймеров.
+// Прибывшая машина ждёт в короткой очереди въезда, пока начало полосы
+// не освободится; переполнение очереди - потерянный спрос.
+class DemandModel {
+public:
+    struct Pending {
+        LaneId destination;
+        double time; // момент прибытия
+    };
+
+    // Срезы по возрастанию start; источники - все origin из матрицы
+    void setMatrix(std::vector<OdSlice> slices, const RoadNetwork& net);
+
+    // Множитель всех интенсивностей
+    void setScale(double k) { scale_ = std::max(0.0, k); }
+
+    // Поставить первые прибытия всех источников (старые события устаревают)
+    void start(double now, TimerWheel& timers, RNG& rng);
+
+    // Событие Arrival: owner - номер источника
+    void onArrival(const TimerEvent& e, TimerWheel& timers, RNG& rng);
+
+    [[nodiscard]] size_t originCount() const { return origins_.size(); }
+    [[nodiscard]] LaneId originLane(size_t o) const { return origins_[o].lane; }
+
+    // Номер источника для полосы или -1
+    [[nodiscard]] int originOf(LaneId lane) const {
+        return lane >= 0 && lane < static_cast<LaneId>(originOf_.size())
+                   ? originOf_[lane]
+                   : -1;
+    }
+
+    [[nodiscard]] bool hasPending(size_t o) const {
+        return origins_[o].count > 0;
+    }
+    [[nodiscard]] const Pending& front(size_t o) const {
+        const Origin& org = origins_[o];
+        return org.queue[org.head];
+    }
+    void pop(size_t o);
+
+    [[nodiscard]] uint64_t dropped() const { return dropped_; }
+
+    // f(origin, destination) для каждой пары всех срезов (повторы возможны)
+    template <class F>
+    void forEachPair(F&& f) const {
+        for (const Origin& org : origins_)
+            for (const std::vector<LaneId>& dests : org.destinations)
+                for (LaneId d : dests)
+                    f(org.lane, d);
+    }
+
+    void clearPending();
+
+private:
+    static constexpr size_t kQueueCapacity = 16;
+
+    struct Origin {
+        LaneId lane{-1};
+        // По срезам: суммарная интенсивность (авт/с) и накопленные доли
+        // назначений для выбора за O(log n)
+        std::vector<double> total;
+        std::vector<std::vector<double>> cumulative;
+        std::vector<std::vector<LaneId>> destinations;
+
+        std::array<Pending, kQueueCapacity> queue{};
+        size_t head{0};
+        size_t count{0};
+    };
+
+    std::vector<OdSlice> slices_;
+    std::vector<Origin> origins_;
+    std::vector<int> originOf_;
+    double scale_{1.0};
+    uint32_t epoch_{0}; // cookie событий; start() обесценивает старые
+    uint64_t dropped_{0};
+
+    [[nodiscard]] size_t sliceAt(double t) const;
+    void scheduleNext(size_t o, double now, TimerWheel& timers, RNG& rng);
+    void push(size_t o, const Pending& p);
+};
+
+} // namespace sim
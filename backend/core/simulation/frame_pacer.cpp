@@ -0,0 +1,113 @@
+#include "frame_pacer.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <thread>
+#if defined(__linux__)
+#include <time.h>
+#endif
+
+namespace sim {
+
+namespace {
+
+int64_t nowNs() {
+#if defined(__linux__)
+    timespec ts{};
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1'000'000'000 + ts.tv_nsec;
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+#endif
+}
+
+void sleepUntilNs(int64_t deadline) {
+#if defined(__linux__)
+    timespec ts{};
+    ts.tv_sec = static_cast<time_t>(deadline / 1'000'000'000);
+    ts.tv_nsec = static_cast<long>(deadline % 1'000'000'000);
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) ==
+           EINTR) {
+    }
+#else
+    std::this_thread::sleep_until(std::chrono::steady_clock::time_point(
+        std::chrono::nanoseconds(deadline)));
+#endif
+}
+
+} // namespace
+
+FramePacer::FramePacer(double period, double spin)
+    : periodNs_(std::max<int64_t>(1, std::llround(period * 1e9))),
+      spinNs_(std::max<int64_t>(0, std::llround(spin * 1e9))) {
+    reset();
+}
+
+void FramePacer::reset() {
+    deadline_ = nowNs() + periodNs_;
+}
+
+int FramePacer::wait(bool spin) {
+    const int64_t spinNs = spin ? spinNs_ : 0;
+    int64_t now = nowNs();
+    if (deadline_ - now > spinNs) {
+        sleepUntilNs(deadline_ - spinNs);
+        now = nowNs();
+    }
+    while (now < deadline_ && spinNs > 0) {
+        std::this_thread::yield();
+        now = nowNs();
+    }
+
+    record(std::max<int64_t>(0, now - deadline_));
+
+    // Сколько сроков уже прошло, включая текущий
+    int64_t due = 1 + std::max<int64_t>(0, now - deadline_) / periodNs_;
+    if (due > kMaxBacklog) {
+        dropped_ += static_cast<uint64_t>(due - kMaxBacklog);
+        deadline_ = now + periodNs_;
+        return kMaxBacklog;
+    }
+    deadline_ += due * periodNs_;
+    return static_cast<int>(due);
+}
+
+void FramePacer::record(int64_t latenessNs) {
+    ++frames_;
+    sumNs_ += latenessNs;
+    maxNs_ = std::max(maxNs_, latenessNs);
+    if (latenessNs > static_cast<int64_t>(kLateThreshold * 1e9))
+        ++late_;
+    ++hist_[std::min<int64_t>(kBuckets, latenessNs / kBucketNs)];
+}
+
+FramePacer::Stats FramePacer::takeStats() {
+    Stats st;
+    st.frames = frames_;
+    st.late = late_;
+    st.dropped = dropped_;
+    if (frames_ > 0) {
+        st.meanLateness = static_cast<double>(sumNs_) / frames_ * 1e-9;
+        st.maxLateness = static_cast<double>(maxNs_) * 1e-9;
+        // Верхняя граница корзины, в которую попал 99-й перцентиль
+        uint64_t need = (frames_ * 99 + 99) / 100, seen = 0;
+        for (int b = 0; b <= kBuckets; ++b) {
+            seen += hist_[b];
+            if (seen >= need) {
+                st.p99Lateness = b == kBuckets
+                                     ? st.maxLateness
+                                     : static_cast<double>((b + 1) * kBucketNs) * 1e-9;
+                break;
+            }
+        }
+    }
+    frames_ = late_ = dropped_ = 0;
+    sumNs_ = maxNs_ = 0;
+    hist_.fill(0);
+    return st;
+}
+
+} // namespace sim
@@ -0,0 +1,59 @@
+#pragma once
+#include <array>
+#include <cstdint>
+
+namespace sim {
+
+// Темп кадров по абсолютным срокам: сон до deadline (clock_nanosleep с
+// TIMER_ABSTIME на CLOCK_MONOTONIC), последние spin секунд - опрос
+// часов. Срок следующего кадра - прошлый срок плюс период, так что
+// опоздание одного кадра не сдвигает остальные. Отстав больше чем на
+// kMaxBacklog периодов, пейсер пропускает долг и начинает с текущего
+// момента.
+class FramePacer {
+public:
+    static constexpr int kMaxBacklog = 4;
+    static constexpr double kDefaultSpin = 200e-6;
+    static constexpr double kLateThreshold = 1e-3; // опоздание больше - late
+
+    explicit FramePacer(double period, double spin = kDefaultSpin);
+
+    // Отсчёт сроков заново от текущего момента
+    void reset();
+
+    // Ждать срока следующего кадра. Возвращает число наступивших
+    // периодов (1..kMaxBacklog); больше 1 - кадры не успели.
+    // spin = false - только сон (пауза: процессор не занят).
+    int wait(bool spin = true);
+
+    struct Stats {
+        uint64_t frames{0};
+        uint64_t late{0};    // опоздание больше kLateThreshold
+        uint64_t dropped{0}; // периоды, срок которых прошёл без кадра
+        double meanLateness{0.0};
+        double p99Lateness{0.0};
+        double maxLateness{0.0};
+    };
+
+    // Статистика с прошлого вызова; счётчики обнуляются
+    Stats takeStats();
+
+private:
+    static constexpr int kBuckets = 200;     // гистограмма опозданий
+    static constexpr int64_t kBucketNs = 50'000; // 50 мкс на корзину
+
+    int64_t periodNs_;
+    int64_t spinNs_;
+    int64_t deadline_{0};
+
+    uint64_t frames_{0};
+    uint64_t late_{0};
+    uint64_t dropped_{0};
+    int64_t sumNs_{0};
+    int64_t maxNs_{0};
+    std::array<uint32_t, kBuckets + 1> hist_{};
+
+    void record(int64_t latenessNs);
+};
+
+} // namespace sim
@@ -0,0 +1,115 @@
+#include "lane_frames.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace sim {
+
+namespace {
+
+using namespace lane_frame_format;
+
+template <typename T>
+void put(std::vector<uint8_t>& out, T value) {
+    const size_t at = out.size();
+    out.resize(at + sizeof(T));
+    std::memcpy(out.data() + at, &value, sizeof(T));
+}
+
+void putMagic(std::vector<uint8_t>& out, const char (&magic)[4]) {
+    for (char c : magic)
+        out.push_back(static_cast<uint8_t>(c));
+}
+
+constexpr char kBase64[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+} // namespace
+
+bool LaneFrameEncoder::encodeGeometry(const RoadNetwork& net) {
+    if (net.maxLaneId() > kMaxLaneId)
+        return false;
+
+    std::vector<const Lane*> lanes;
+    lanes.reserve(net.lanes().size());
+    for (const auto& [id, L] : net.lanes())
+        lanes.push_back(&L);
+    std::sort(lanes.begin(), lanes.end(),
+              [](const Lane* a, const Lane* b) { return a->id < b->id; });
+
+    buf_.clear();
+    putMagic(buf_, kGeometryMagic);
+    put<uint8_t>(buf_, kVersion);
+    put<uint32_t>(buf_, static_cast<uint32_t>(lanes.size()));
+    for (const Lane* L : lanes) {
+        const auto& pts = L->center.points();
+        const auto& heading = L->center.heading();
+        uint8_t flags = (L->isConnector ? kConnector : 0) |
+                        (heading.empty() ? 0 : kCurve);
+        put<uint32_t>(buf_, static_cast<uint32_t>(L->id));
+        put<float>(buf_, static_cast<float>(L->width));
+        put<uint8_t>(buf_, flags);
+        put<float>(buf_, L->stopLineS
+                             ? static_cast<float>(*L->stopLineS)
+                             : std::numeric_limits<float>::quiet_NaN());
+        put<int32_t>(buf_, L->signalGroupId.value_or(-1));
+        put<uint16_t>(buf_, static_cast<uint16_t>(pts.size()));
+        for (const Vec2& p : pts) {
+            put<float>(buf_, static_cast<float>(p.x));
+            put<float>(buf_, static_cast<float>(p.y));
+        }
+        for (double th : heading)
+            put<float>(buf_, static_cast<float>(th));
+    }
+    return true;
+}
+
+void LaneFrameEncoder::beginFrame(double t) {
+    buf_.clear();
+    putMagic(buf_, kFrameMagic);
+    put<uint32_t>(buf_, static_cast<uint32_t>(std::llround(t * 1000.0)));
+    countAt_ = buf_.size();
+    put<uint32_t>(buf_, 0);
+    count_ = 0;
+}
+
+void LaneFrameEncoder::add(uint64_t id, const Lane& lane, double s, double d) {
+    const double len = lane.length();
+    const double frac = len > 0.0 ? std::clamp(s / len, 0.0, 1.0) : 0.0;
+    const long dq = std::clamp(std::lround(d / kDStep), -127L, 127L);
+    put<uint32_t>(buf_, static_cast<uint32_t>(id));
+    put<uint16_t>(buf_, static_cast<uint16_t>(lane.id));
+    put<uint16_t>(buf_, static_cast<uint16_t>(std::lround(frac * kSScale)));
+    put<int8_t>(buf_, static_cast<int8_t>(dq));
+    ++count_;
+}
+
+void LaneFrameEncoder::endFrame() {
+    std::memcpy(buf_.data() + countAt_, &count_, sizeof(count_));
+}
+
+const std::string& LaneFrameEncoder::base64() {
+    text_.clear();
+    text_.reserve((buf_.size() + 2) / 3 * 4);
+    size_t i = 0;
+    for (; i + 2 < buf_.size(); i += 3) {
+        uint32_t v = (buf_[i] << 16) | (buf_[i + 1] << 8) | buf_[i + 2];
+        text_.push_back(kBase64[(v >> 18) & 63]);
+        text_.push_back(kBase64[(v >> 12) & 63]);
+        text_.push_back(kBase64[(v >> 6) & 63]);
+        text_.push_back(kBase64[v & 63]);
+    }
+    if (i < buf_.size()) {
+        uint32_t v = buf_[i] << 16;
+        if (i + 1 < buf_.size())
+            v |= buf_[i + 1] << 8;
+        text_.push_back(kBase64[(v >> 18) & 63]);
+        text_.push_back(kBase64[(v >> 12) & 63]);
+        text_.push_back(i + 1 < buf_.size() ? kBase64[(v >> 6) & 63] : '=');
+        text_.push_back('=');
+    }
+    return text_;
+}
+
+} // namespace sim
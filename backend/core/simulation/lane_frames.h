@@ -0,0 +1,59 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "../models/road_network.h"
+
+namespace sim {
+
+// Кадры в координатах полосы: геометрия сети уходит клиенту один раз,
+// а машина в кадре - это (id, полоса, s, d). Позу по ним клиент (или
+// мост) считает сам и только для тех машин, что видны.
+//
+// Геометрия (все числа little-endian):
+//   kGeometryMagic, u8 версия, u32 число полос; на полосу:
+//   u32 id, f32 ширина, u8 флаги (kConnector, kCurve), f32 стоп-линия
+//   (NaN - нет), i32 группа светофора (-1 - нет), u16 число точек,
+//   точки f32 x, y; при kCurve - f32 курс в каждой точке
+//   (Polyline::setCurve: выборка по дуге между точками).
+// Кадр:
+//   kFrameMagic, u32 время в мс, u32 число машин; на машину
+//   u32 id, u16 полоса, u16 s в долях длины полосы (65535 - конец),
+//   i8 d в шагах kDStep.
+namespace lane_frame_format {
+inline constexpr char kGeometryMagic[4] = {'I', 'T', 'S', 'G'};
+inline constexpr char kFrameMagic[4] = {'I', 'T', 'S', 'F'};
+inline constexpr uint8_t kVersion = 1;
+
+inline constexpr uint8_t kConnector = 1;
+inline constexpr uint8_t kCurve = 2;
+
+inline constexpr double kSScale = 65535.0;   // s / длина полосы
+inline constexpr double kDStep = 1.0 / 32.0; // d: +-3.97 м
+inline constexpr size_t kRecordBytes = 9;
+inline constexpr LaneId kMaxLaneId = 65535;
+} // namespace lane_frame_format
+
+class LaneFrameEncoder {
+public:
+    // false, если id полос не помещаются в u16 кадра
+    bool encodeGeometry(const RoadNetwork& net);
+
+    void beginFrame(double t);
+    void add(uint64_t id, const Lane& lane, double s, double d);
+    void endFrame();
+
+    // Последний закодированный блок (геометрия или кадр)
+    [[nodiscard]] const std::vector<uint8_t>& bytes() const { return buf_; }
+
+    // Он же в base64 для строкового канала stdout
+    [[nodiscard]] const std::string& base64();
+
+private:
+    std::vector<uint8_t> buf_;
+    std::string text_;
+    size_t countAt_{0};
+    uint32_t count_{0};
+};
+
+} // namespace sim
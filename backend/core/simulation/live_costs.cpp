@@ -0,0 +1,39 @@
+#include "live_costs.h"
+#include <algorithm>
+
+namespace sim {
+
+void LiveLaneCosts::configure(const RoadNetwork& net) {
+    const size_t n = static_cast<size_t>(net.maxLaneId()) + 1;
+    length_.assign(n, 0.0);
+    freeFlow_.assign(n, 0.0);
+    for (const auto& [id, L] : net.lanes()) {
+        length_[id] = L.length();
+        freeFlow_[id] = L.length() / std::max(1.0, L.speedLimit);
+    }
+    travel_ = freeFlow_;
+    speedSum_.assign(n, 0.0);
+    samples_.assign(n, 0);
+}
+
+void LiveLaneCosts::update() {
+    for (size_t i = 0; i < travel_.size(); ++i) {
+        double measured = freeFlow_[i];
+        if (samples_[i] > 0) {
+            double v = std::max(kMinSpeed, speedSum_[i] / samples_[i]);
+            measured = std::clamp(length_[i] / v, freeFlow_[i],
+                                  freeFlow_[i] * kMaxFactor);
+        }
+        travel_[i] += kAlpha * (measured - travel_[i]);
+        speedSum_[i] = 0.0;
+        samples_[i] = 0;
+    }
+}
+
+void LiveLaneCosts::clear() {
+    travel_ = freeFlow_;
+    std::fill(speedSum_.begin(), speedSum_.end(), 0.0);
+    std::fill(samples_.begin(), samples_.end(), 0);
+}
+
+} // namespace sim
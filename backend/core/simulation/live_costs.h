@@ -0,0 +1,51 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "../models/road_network.h"
+
+namespace sim {
+
+// Текущее время проезда полос по измеренным скоростям. Скорости машин
+// копятся за период, update() сглаживает оценку (EWMA) и возвращает
+// пустые полосы к свободному проезду. Оценка не меньше времени
+// свободного проезда - эвристика A* остаётся допустимой.
+class LiveLaneCosts {
+public:
+    void configure(const RoadNetwork& net);
+
+    void sample(LaneId lane, double v) {
+        if (lane < 0 || lane >= static_cast<LaneId>(speedSum_.size()))
+            return;
+        speedSum_[lane] += v;
+        samples_[lane]++;
+    }
+
+    void update();
+
+    void clear();
+
+    // Время проезда полосы, с; индекс - id полосы
+    [[nodiscard]] const std::vector<double>& travelTimes() const {
+        return travel_;
+    }
+
+    // Полоса заметно медленнее свободного проезда
+    [[nodiscard]] bool congested(LaneId lane) const {
+        return lane >= 0 && lane < static_cast<LaneId>(travel_.size()) &&
+               travel_[lane] > freeFlow_[lane] * kCongestedFactor;
+    }
+
+private:
+    std::vector<double> length_;
+    std::vector<double> freeFlow_;
+    std::vector<double> travel_;
+    std::vector<double> speedSum_;
+    std::vector<uint32_t> samples_;
+
+    static constexpr double kAlpha = 0.5;       // вес нового замера
+    static constexpr double kMinSpeed = 0.5;    // м/с, стоящая очередь
+    static constexpr double kMaxFactor = 10.0;  // потолок к свободному
+    static constexpr double kCongestedFactor = 1.5;
+};
+
+} // namespace sim
@@ -0,0 +1,223 @@
+#include "metrics.h"
+#include <algorithm>
+#include <cmath>
+
+namespace sim {
+
+int LogHistogram::binOf(double x) {
+    if (!(x > 0.0))
+        return 0;
+    int exp = 0;
+    double frac = std::frexp(x, &exp); // x = frac * 2^exp, frac в [0.5, 1)
+    int octave = exp - 1 - kMinExp;
+    if (octave < 0)
+        return 0;
+    if (octave >= kOctaves)
+        return kBins - 1;
+    int sub = static_cast<int>((frac * 2.0 - 1.0) * kSub);
+    return 1 + octave * kSub + std::min(sub, kSub - 1);
+}
+
+double LogHistogram::binMid(int bin) {
+    if (bin <= 0)
+        return 0.0;
+    int octave = (bin - 1) / kSub;
+    int sub = (bin - 1) % kSub;
+    double lo = std::ldexp(1.0 + static_cast<double>(sub) / kSub,
+                           octave + kMinExp);
+    double hi = std::ldexp(1.0 + static_cast<double>(sub + 1) / kSub,
+                           octave + kMinExp);
+    return 0.5 * (lo + hi);
+}
+
+void LogHistogram::record(double x) {
+    x = std::max(0.0, x);
+    bins_[binOf(x)]++;
+    count_++;
+    sum_ += x;
+    max_ = std::max(max_, x);
+}
+
+void LogHistogram::clear() {
+    bins_.fill(0);
+    count_ = 0;
+    sum_ = 0.0;
+    max_ = 0.0;
+}
+
+double LogHistogram::quantile(double q) const {
+    if (count_ == 0)
+        return 0.0;
+    auto rank = static_cast<uint64_t>(std::ceil(std::clamp(q, 0.0, 1.0) *
+                                                static_cast<double>(count_)));
+    rank = std::max<uint64_t>(rank, 1);
+    uint64_t seen = 0;
+    for (int b = 0; b < kBins; ++b) {
+        seen += bins_[b];
+        if (seen >= rank)
+            return std::min(binMid(b), max_);
+    }
+    return max_;
+}
+
+void Metrics::configure(const RoadNetwork& net) {
+    net_ = &net;
+    const size_t n = static_cast<size_t>(net.maxLaneId()) + 1;
+    lanes_.assign(n, {});
+    capacity_.assign(n, 1.0);
+    approach_.assign(n, false);
+    for (const auto& [id, L] : net.lanes()) {
+        capacity_[id] = std::max(1.0, L.length() / kJamSpacing);
+        approach_[id] = L.signalGroupId.has_value();
+    }
+}
+
+void Metrics::onSpawn(uint64_t id, double now, const RoutePlan& plan,
+                      double desiredSpeed) {
+    Trip trip;
+    trip.spawnTime = now;
+
+    // Свободный проезд: длины полос маршрута на разрешённой скорости,
+    // боковой шаг (перестроение) длины не добавляет
+    const auto& steps = plan.steps();
+    for (size_t i = 0; i < steps.size(); ++i) {
+        const Lane* L = net_ ? net_->getLane(steps[i].lane) : nullptr;
+        if (!L)
+            continue;
+        if (i > 0) {
+            const Lane* prev = net_->getLane(steps[i - 1].lane);
+            if (prev && (prev->left == L->id || prev->right == L->id))
+                continue;
+        }
+        double v = std::max(1.0, std::min(desiredSpeed, L->speedLimit));
+        trip.freeFlowTime += L->length() / v;
+    }
+    trips_[id] = trip;
+}
+
+void Metrics::onTripEnd(uint64_t id, double now) {
+    auto it = trips_.find(id);
+    if (it == trips_.end())
+        return;
+    const Trip& trip = it->second;
+    if (trip.lane >= 0 && trip.lane < static_cast<LaneId>(lanes_.size()))
+        lanes_[trip.lane].exits++;
+
+    double travel = now - trip.spawnTime;
+    travelTime_.record(travel);
+    delay_.record(travel - trip.freeFlowTime);
+    tripStops_.record(trip.stops);
+    tripsInPeriod_++;
+    trips_.erase(it);
+}
+
+void Metrics::beginTick(double dt) {
+    dt_ = dt;
+    periodTime_ += dt;
+    for (LaneStats& ls : lanes_)
+        ls.queueNow = 0;
+}
+
+void Metrics::sample(const MetricSample& s) {
+    if (s.lane < 0 || s.lane >= static_cast<LaneId>(lanes_.size()))
+        return;
+    LaneStats& ls = lanes_[s.lane];
+    ls.speedSum += s.v;
+    ls.speedSamples++;
+    ls.vehicleTime += dt_;
+    if (s.v < kQueueSpeed)
+        ls.queueNow++;
+
+    auto it = trips_.find(s.id);
+    if (it == trips_.end())
+        return;
+    Trip& trip = it->second;
+    if (trip.lane != s.lane) {
+        if (trip.lane >= 0 && trip.lane < static_cast<LaneId>(lanes_.size()))
+            lanes_[trip.lane].exits++;
+        trip.lane = s.lane;
+    }
+    if (!trip.stopped && s.v < kStopSpeed) {
+        trip.stopped = true;
+        trip.stops++;
+        if (approach_[s.lane])
+            ls.stops++;
+    } else if (trip.stopped && s.v > kQueueSpeed) {
+        trip.stopped = false;
+    }
+}
+
+void Metrics::endTick() {
+    for (size_t id = 0; id < lanes_.size(); ++id) {
+        LaneStats& ls = lanes_[id];
+        ls.queueMax = std::max(ls.queueMax, ls.queueNow);
+        ls.queueTime += ls.queueNow * dt_;
+        if (approach_[id])
+            queuePeak_ = std::max(queuePeak_, ls.queueNow);
+    }
+}
+
+void Metrics::write(std::ostream& out, double now) {
+    const double T = std::max(periodTime_, 1e-9);
+    for (size_t id = 0; id < lanes_.size(); ++id) {
+        LaneStats& ls = lanes_[id];
+        if (ls.speedSamples == 0 && ls.exits == 0)
+            continue;
+        double flow = ls.exits * 3600.0 / T;
+        double speed = ls.speedSamples ? ls.speedSum / ls.speedSamples : 0.0;
+        double occupancy = ls.vehicleTime / T / capacity_[id];
+        out << "kpi lane " << id << " " << flow << " " << speed << " "
+            << occupancy << "\n";
+        if (approach_[id]) {
+            out << "kpi approach " << id << " " << ls.queueTime / T << " "
+                << ls.queueMax << " " << ls.stops << "\n";
+        }
+        ls = LaneStats{};
+    }
+
+    out << "kpi trips " << tripsInPeriod_ << " " << travelTime_.count() << " "
+        << travelTime_.mean() << " " << travelTime_.quantile(0.5) << " "
+        << travelTime_.quantile(0.95) << " " << delay_.mean() << " "
+        << delay_.quantile(0.95) << " " << tripStops_.mean() << std::endl;
+
+    tripsInPeriod_ = 0;
+    periodTime_ = 0.0;
+    periodStart_ = now;
+}
+
+MetricsSummary Metrics::summary(double now) const {
+    MetricsSummary out;
+    out.trips = travelTime_.count();
+    const double T = now - totalsStart_;
+    out.throughput = T > 0.0 ? out.trips * 3600.0 / T : 0.0;
+    out.meanTravel = travelTime_.mean();
+    out.meanDelay = delay_.mean();
+    out.p95Delay = delay_.quantile(0.95);
+    out.meanStops = tripStops_.mean();
+    out.maxQueue = queuePeak_;
+    return out;
+}
+
+void Metrics::restartTotals(double now) {
+    travelTime_.clear();
+    delay_.clear();
+    tripStops_.clear();
+    queuePeak_ = 0;
+    totalsStart_ = now;
+}
+
+void Metrics::clear() {
+    for (LaneStats& ls : lanes_)
+        ls = LaneStats{};
+    trips_.clear();
+    travelTime_.clear();
+    delay_.clear();
+    tripStops_.clear();
+    tripsInPeriod_ = 0;
+    queuePeak_ = 0;
+    totalsStart_ = 0.0;
+    periodTime_ = 0.0;
+    periodStart_ = 0.0;
+}
+
+} // namespace sim
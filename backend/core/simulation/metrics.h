@@ -0,0 +1,146 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <memory_resource>
+#include <ostream>
+#include <unordered_map>
+#include <vector>
+#include "../models/road_network.h"
+#include "../models/routing.h"
+
+namespace sim {
+
+// Гистограмма с логарифмическими корзинами фиксированного размера
+// (как HDR): 8 корзин на каждую степень двойки от 1/16 до 2^27,
+// относительная ошибка квантилей не больше ~9%. Память не растёт.
+class LogHistogram {
+public:
+    void record(double x);
+
+    void clear();
+
+    [[nodiscard]] uint64_t count() const { return count_; }
+    [[nodiscard]] double mean() const { return count_ ? sum_ / count_ : 0.0; }
+    [[nodiscard]] double max() const { return max_; }
+
+    // Значение q-квантиля (середина корзины)
+    [[nodiscard]] double quantile(double q) const;
+
+private:
+    static constexpr int kSubBits = 3;
+    static constexpr int kSub = 1 << kSubBits;
+    static constexpr int kMinExp = -4;
+    static constexpr int kOctaves = 32;
+    static constexpr int kBins = kOctaves * kSub + 1; // [0] - ниже минимума
+
+    std::array<uint64_t, kBins> bins_{};
+    uint64_t count_{0};
+    double sum_{0.0};
+    double max_{0.0};
+
+    static int binOf(double x);
+    static double binMid(int bin);
+};
+
+// Снимок машины для метрик (и микро-, и мезо-модели)
+struct MetricSample {
+    uint64_t id;
+    LaneId lane;
+    double v;
+};
+
+// Итоги по всей сети с начала счёта (Metrics::restartTotals)
+struct MetricsSummary {
+    uint64_t trips{0};       // завершённых поездок
+    double throughput{0.0};  // авт/ч
+    double meanTravel{0.0};  // с
+    double meanDelay{0.0};   // с, относительно свободного проезда
+    double p95Delay{0.0};
+    double meanStops{0.0};   // остановок на поездку
+    uint32_t maxQueue{0};    // наибольшая очередь на подходе, машин
+};
+
+// Показатели движения, считаются по ходу симуляции:
+// - по полосам: поток (выезды, авт/ч), средняя скорость, занятость
+//   (средняя доля полосы, занятая машинами с шагом jamSpacing);
+// - по подходам к светофору: очередь (машины медленнее 1 м/с), остановки;
+// - по поездкам: время в пути и задержка относительно свободного проезда.
+// Накопители периода сбрасываются после write(), гистограммы поездок
+// копятся за всё время.
+class Metrics {
+public:
+    void configure(const RoadNetwork& net);
+
+    void setPeriod(double seconds) { period_ = seconds; }
+
+    void onSpawn(uint64_t id, double now, const RoutePlan& plan,
+                 double desiredSpeed);
+
+    void onTripEnd(uint64_t id, double now);
+
+    // Машины одного тика подаются подряд между beginTick и endTick
+    void beginTick(double dt);
+    void sample(const MetricSample& s);
+    void endTick();
+
+    [[nodiscard]] bool due(double now) const {
+        return now - periodStart_ >= period_;
+    }
+
+    // Строки "kpi ..." за период и сброс накопителей периода
+    void write(std::ostream& out, double now);
+
+    // Гистограммы поездок и наибольшая очередь копятся от restartTotals();
+    // поездки, начатые раньше, засчитываются при завершении
+    [[nodiscard]] MetricsSummary summary(double now) const;
+    void restartTotals(double now);
+
+    void clear();
+
+private:
+    struct LaneStats {
+        uint32_t exits{0};
+        double speedSum{0.0};
+        uint64_t speedSamples{0};
+        double vehicleTime{0.0};  // сумма (машин на полосе * dt)
+        uint32_t queueNow{0};
+        uint32_t queueMax{0};
+        double queueTime{0.0};
+        uint32_t stops{0};
+    };
+
+    struct Trip {
+        double spawnTime{0.0};
+        double freeFlowTime{0.0};
+        LaneId lane{-1};
+        bool stopped{false};
+        uint32_t stops{0};
+    };
+
+    const RoadNetwork* net_{nullptr};
+    double period_{60.0};
+    double periodStart_{0.0};
+    double periodTime_{0.0};
+    double dt_{0.0};
+
+    std::vector<LaneStats> lanes_;
+    std::vector<double> capacity_;  // машин на полосе при плотной очереди
+    std::vector<bool> approach_;    // полоса перед стоп-линией со светофором
+    // Узлы поездок - из пула: завершённая поездка отдаёт узел новой,
+    // появление машины после прогрева не обращается к куче
+    std::pmr::unsynchronized_pool_resource tripNodes_;
+    std::pmr::unordered_map<uint64_t, Trip> trips_{&tripNodes_};
+
+    LogHistogram travelTime_;
+    LogHistogram delay_;
+    LogHistogram tripStops_;
+    uint32_t tripsInPeriod_{0};
+    uint32_t queuePeak_{0}; // по подходам, с restartTotals()
+    double totalsStart_{0.0};
+
+    static constexpr double kJamSpacing = 7.0;
+    static constexpr double kQueueSpeed = 1.0;
+    static constexpr double kStopSpeed = 0.1;
+};
+
+} // namespace sim
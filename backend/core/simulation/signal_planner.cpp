@@ -0,0 +1,410 @@
+#include "signal_planner.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <limits>
+
+namespace sim {
+
+namespace {
+
+constexpr double kQueueSpeed = 1.0;  // медленнее - стоит в очереди
+constexpr double kMinDecel = 9.0;    // предел торможения в прогоне
+
+} // namespace
+
+CarSignal SignalPlanner::PhaseCursor::at(double t) {
+    if (!phases || phases->empty())
+        return CarSignal::Green;
+    // Цикл нулевой длины не крутим
+    for (size_t guard = 0; t >= end && guard < 4 * phases->size(); ++guard) {
+        idx = (idx + 1) % static_cast<int>(phases->size());
+        end += std::max(0.0, (*phases)[idx].duration);
+    }
+    return (*phases)[idx].carState;
+}
+
+void SignalPlanner::configure(const RoadNetwork& net,
+                              std::vector<std::vector<int>> junctions) {
+    net_ = &net;
+    junctions_.clear();
+    maxGroupId_ = 0;
+    const size_t n = static_cast<size_t>(net.maxLaneId()) + 1;
+
+    std::vector<LaneId> ids;
+    for (const auto& [id, L] : net.lanes())
+        ids.push_back(id);
+    std::sort(ids.begin(), ids.end());
+
+    for (size_t j = 0; j < junctions.size(); ++j) {
+        Junction J;
+        J.groups = std::move(junctions[j]);
+        std::vector<char> in(n, 0);
+        auto add = [&](LaneId id) {
+            if (id >= 0 && static_cast<size_t>(id) < n)
+                in[id] = 1;
+        };
+        // Подходы, их коннекторы и выезды
+        for (LaneId id : ids) {
+            const Lane& L = *net.getLane(id);
+            if (!L.signalGroupId ||
+                std::find(J.groups.begin(), J.groups.end(),
+                          *L.signalGroupId) == J.groups.end())
+                continue;
+            add(id);
+            for (LaneId c : L.next) {
+                add(c);
+                if (const Lane* C = net.getLane(c); C && C->connectorTo)
+                    add(*C->connectorTo);
+            }
+        }
+        // Коннекторы, ведущие на подходы, и полосы перед ними
+        for (LaneId id : ids) {
+            const Lane& L = *net.getLane(id);
+            if (L.isConnector && L.connectorTo && in[*L.connectorTo] &&
+                net.getLane(*L.connectorTo)->signalGroupId) {
+                add(id);
+                if (L.connectorFrom)
+                    add(*L.connectorFrom);
+            }
+        }
+        // Соседние полосы: маршрут может начинаться с перестроения
+        for (LaneId id : ids) {
+            const Lane& L = *net.getLane(id);
+            if (in[id] && !L.isConnector) {
+                add(L.left);
+                add(L.right);
+            }
+        }
+
+        for (LaneId id : ids) {
+            if (!in[id])
+                continue;
+            J.lanes.push_back(id);
+            const Lane& L = *net.getLane(id);
+            if (L.signalGroupId &&
+                std::find(J.signalGroups.begin(), J.signalGroups.end(),
+                          *L.signalGroupId) == J.signalGroups.end())
+                J.signalGroups.push_back(*L.signalGroupId);
+        }
+        for (int g : J.signalGroups)
+            maxGroupId_ = std::max(maxGroupId_, g);
+        // Решения перекрёстков разнесены по периоду
+        J.nextDecision = kDecisionPeriod * static_cast<double>(j) /
+                         static_cast<double>(std::max<size_t>(1, junctions.size()));
+        junctions_.push_back(std::move(J));
+    }
+    needed_.assign(n, 0);
+}
+
+void SignalPlanner::update(double now, SignalController& ctl,
+                           const std::vector<Vehicle>& vehicles,
+                           const MesoModel& meso, WorkerPool* pool) {
+    if (!net_)
+        return;
+    due_.clear();
+    for (size_t j = 0; j < junctions_.size() && due_.size() < kMaxDecisionsPerTick;
+         ++j) {
+        Junction& J = junctions_[j];
+        // После reset() часы пошли заново
+        if (J.nextDecision - now > kDecisionPeriod)
+            J.nextDecision = now;
+        if (J.nextDecision <= now)
+            due_.push_back(j);
+    }
+    if (due_.empty())
+        return;
+
+    const auto start = std::chrono::steady_clock::now();
+    signals_.assign(static_cast<size_t>(maxGroupId_) + 1, PhaseCursor{});
+    for (const auto& [id, g] : ctl.carGroups()) {
+        if (id < 0 || id > maxGroupId_)
+            continue;
+        signals_[id] = {&g.phases(), g.phaseIndex(), g.phaseEndsAt()};
+    }
+
+    candidates_.clear();
+    for (size_t j : due_) {
+        junctions_[j].nextDecision = now + kDecisionPeriod;
+        candidatesFor(j, now, ctl);
+    }
+    if (candidates_.empty())
+        return;
+
+    for (size_t j : due_)
+        for (LaneId id : junctions_[j].lanes)
+            needed_[id] = 1;
+    snapshot(vehicles, meso);
+    for (size_t j : due_)
+        for (LaneId id : junctions_[j].lanes)
+            needed_[id] = 0;
+
+    if (scratch_.size() < candidates_.size())
+        scratch_.resize(candidates_.size());
+    const std::function<void(size_t)> task = [this, now](size_t i) {
+        candidates_[i].cost = rollout(candidates_[i], now, scratch_[i]);
+    };
+    if (pool)
+        pool->run(candidates_.size(), task);
+    else
+        for (size_t i = 0; i < candidates_.size(); ++i)
+            task(i);
+    stats_.rollouts += candidates_.size();
+
+    // Варианты перекрёстка идут подряд, первый - без сдвига
+    for (size_t i = 0; i < candidates_.size();) {
+        const size_t j = candidates_[i].junction;
+        const double keep = candidates_[i].cost;
+        size_t best = i;
+        for (++i; i < candidates_.size() && candidates_[i].junction == j; ++i) {
+            if (candidates_[i].cost < candidates_[best].cost)
+                best = i;
+        }
+        ++stats_.decisions;
+        if (candidates_[best].delta == 0.0 ||
+            keep - candidates_[best].cost <= kMinGain * keep)
+            continue;
+        ctl.shiftPhases(junctions_[j].groups, candidates_[best].delta);
+        ++stats_.shifts;
+    }
+
+    std::chrono::duration<double, std::milli> took =
+        std::chrono::steady_clock::now() - start;
+    stats_.lastMs = took.count();
+    stats_.maxMs = std::max(stats_.maxMs, stats_.lastMs);
+}
+
+// Варианты сдвига, пока у перекрёстка горит зелёный: без сдвига,
+// продлить на один-два шага, сократить на шаг или переключить сразу.
+// Зелёный остаётся в [kMinGreen, kMaxGreen], текущие фазы остальных
+// групп не короче шага прогона.
+void SignalPlanner::candidatesFor(size_t j, double now,
+                                  const SignalController& ctl) {
+    const Junction& J = junctions_[j];
+    const TrafficLightGroup* green = nullptr;
+    double lo = -std::numeric_limits<double>::infinity();
+    for (int id : J.groups) {
+        auto it = ctl.carGroups().find(id);
+        if (it == ctl.carGroups().end())
+            continue;
+        const TrafficLightGroup& g = it->second;
+        lo = std::max(lo, kStep - (g.phaseEndsAt() - now));
+        if (g.state() == CarSignal::Green && !green)
+            green = &g;
+    }
+    if (!green)
+        return;
+
+    const double length = green->timeInPhase(now) + green->phaseEndsAt() - now;
+    lo = std::max(lo, kMinGreen - length);
+    const double hi = kMaxGreen - length;
+
+    const size_t first = candidates_.size();
+    candidates_.push_back({j, 0.0});
+    for (double d : {kHoldStep, 2.0 * kHoldStep, -kHoldStep, lo}) {
+        if (d < lo || d > hi)
+            continue;
+        bool seen = false;
+        for (size_t k = first; k < candidates_.size(); ++k)
+            seen = seen || std::abs(candidates_[k].delta - d) < 1e-6;
+        if (!seen)
+            candidates_.push_back({j, d});
+    }
+    if (candidates_.size() == first + 1)
+        candidates_.pop_back(); // выбирать не из чего
+}
+
+void SignalPlanner::addCar(LaneId lane, double s, double v, double length,
+                           const VehicleParams& p, const RoutePlan& plan) {
+    Car c{lane, s, v, length, p.maxAccel, p.comfyDecel, p.timeHeadway,
+          p.minGap, p.desiredSpeed, {}};
+    c.route.fill(-1);
+
+    const auto& st = plan.steps();
+    int i = std::max(0, plan.startIndex - 1);
+    while (i < static_cast<int>(st.size()) && st[i].lane != lane)
+        ++i;
+    int k = 0;
+    for (++i; i < static_cast<int>(st.size()) && k < kRouteAhead; ++i) {
+        const Lane* cur = net_->getLane(c.lane);
+        // Перестроение по маршруту - сразу на соседнюю полосу
+        if (k == 0 && cur && (cur->left == st[i].lane || cur->right == st[i].lane)) {
+            c.lane = st[i].lane;
+            continue;
+        }
+        c.route[k++] = st[i].lane;
+    }
+    if (c.lane >= 0 && static_cast<size_t>(c.lane) < needed_.size() &&
+        needed_[c.lane])
+        cars_.push_back(c);
+}
+
+void SignalPlanner::snapshot(const std::vector<Vehicle>& vehicles,
+                             const MesoModel& meso) {
+    cars_.clear();
+    for (const Vehicle& v : vehicles) {
+        if (v.laneId() >= 0 && needed_[v.laneId()])
+            addCar(v.laneId(), v.s(), v.v(), v.length(), v.params(),
+                   v.route().plan());
+    }
+    meso.forEach([this](const MesoVehicle& mv) {
+        if (mv.lane >= 0 && needed_[mv.lane])
+            addCar(mv.lane, mv.s, mv.v, kMesoLength, mv.params,
+                   mv.route.plan());
+    });
+    std::sort(cars_.begin(), cars_.end(), [](const Car& a, const Car& b) {
+        return a.lane < b.lane || (a.lane == b.lane && a.s > b.s);
+    });
+
+    laneStart_.assign(needed_.size() + 1, 0);
+    for (const Car& c : cars_)
+        laneStart_[c.lane + 1]++;
+    for (size_t i = 1; i < laneStart_.size(); ++i)
+        laneStart_[i] += laneStart_[i - 1];
+}
+
+double SignalPlanner::rollout(const Candidate& cand, double now,
+                              Scratch& sc) const {
+    const Junction& J = junctions_[cand.junction];
+
+    sc.localOf.assign(needed_.size(), -1);
+    sc.cursors.clear();
+    for (int g : J.signalGroups) {
+        PhaseCursor c = signals_[g];
+        if (std::find(J.groups.begin(), J.groups.end(), g) != J.groups.end())
+            c.end += cand.delta;
+        sc.cursors.push_back(c);
+    }
+
+    sc.lanes.resize(J.lanes.size());
+    sc.cars.clear();
+    for (size_t k = 0; k < J.lanes.size(); ++k) {
+        const Lane& L = *net_->getLane(J.lanes[k]);
+        RolloutLane& rl = sc.lanes[k];
+        rl.id = L.id;
+        rl.length = L.length();
+        rl.stopS = L.stopLineS.value_or(rl.length);
+        rl.vFree = L.speedLimit;
+        rl.cursor = -1;
+        if (L.signalGroupId) {
+            auto it = std::find(J.signalGroups.begin(), J.signalGroups.end(),
+                                *L.signalGroupId);
+            rl.cursor = static_cast<int>(it - J.signalGroups.begin());
+        }
+        rl.items.clear();
+        rl.head = 0;
+        sc.localOf[L.id] = static_cast<int>(k);
+        for (uint32_t i = laneStart_[L.id]; i < laneStart_[L.id + 1]; ++i) {
+            rl.items.push_back(static_cast<int>(sc.cars.size()));
+            sc.cars.push_back({cars_[i], static_cast<int>(k), 0, -1, false});
+        }
+    }
+
+    double cost = 0.0;
+    const int steps = static_cast<int>(std::lround(kHorizon / kStep));
+    const double dt = kStep;
+    for (int step = 0; step < steps; ++step) {
+        const double t = now + step * dt;
+        for (RolloutLane& rl : sc.lanes) {
+            const CarSignal sig =
+                rl.cursor >= 0 ? sc.cursors[rl.cursor].at(t) : CarSignal::Green;
+            for (size_t pos = rl.head; pos < rl.items.size(); ++pos) {
+                RolloutCar& rc = sc.cars[rl.items[pos]];
+                if (rc.movedAt == step)
+                    continue;
+                rc.movedAt = step;
+                Car& c = rc.car;
+
+                double gap = 1e9, vFront = c.v0, limit = 1e9;
+                if (pos > rl.head) {
+                    const Car& l = sc.cars[rl.items[pos - 1]].car;
+                    gap = l.s - l.length - c.s;
+                    vFront = l.v;
+                    limit = l.s - l.length;
+                } else {
+                    // Стоп-линия: на красный всегда, на жёлтый - если
+                    // успеваем спокойно остановиться
+                    const double toStop = rl.stopS - c.s - 0.5 * c.length;
+                    const bool stop =
+                        sig == CarSignal::Red ||
+                        ((sig == CarSignal::Yellow ||
+                          sig == CarSignal::RedYellow) &&
+                         toStop * 2.0 * c.b > c.v * c.v);
+                    if (sig != CarSignal::Green && stop && toStop > -0.5) {
+                        gap = std::max(0.1, toStop);
+                        vFront = 0.0;
+                        limit = rl.stopS;
+                    } else if (rc.hop < kRouteAhead && c.route[rc.hop] >= 0) {
+                        const int nl = sc.localOf[c.route[rc.hop]];
+                        if (nl >= 0 && sc.lanes[nl].head < sc.lanes[nl].items.size()) {
+                            const Car& tail =
+                                sc.cars[sc.lanes[nl].items.back()].car;
+                            gap = rl.length - c.s + tail.s - tail.length;
+                            vFront = tail.v;
+                        }
+                    }
+                }
+
+                const double v0 = std::max(1.0, std::min(c.v0, rl.vFree));
+                const double sStar =
+                    c.s0 + std::max(0.0, c.v * c.T + c.v * (c.v - vFront) /
+                                                         (2.0 * std::sqrt(c.a * c.b)));
+                const double r = c.v / v0;
+                const double g = std::max(gap, 0.1);
+                double acc = c.a * (1.0 - r * r * r * r - (sStar / g) * (sStar / g));
+                acc = std::max(acc, -kMinDecel);
+                double vNew = std::max(0.0, c.v + acc * dt);
+                double ds = 0.5 * (c.v + vNew) * dt;
+                if (c.s + ds > limit) {
+                    ds = std::max(0.0, limit - c.s);
+                    vNew = std::min(vNew, vFront);
+                }
+                cost += std::max(0.0, dt - ds / v0);
+                c.s += ds;
+                c.v = vNew;
+            }
+
+            // Доехавшие до конца полосы - на следующую по маршруту
+            while (rl.head < rl.items.size()) {
+                RolloutCar& rc = sc.cars[rl.items[rl.head]];
+                if (rc.car.s < rl.length)
+                    break;
+                const LaneId next =
+                    rc.hop < kRouteAhead ? rc.car.route[rc.hop] : -1;
+                const int nl = next >= 0 ? sc.localOf[next] : -1;
+                if (nl >= 0) {
+                    rc.car.s -= rl.length;
+                    rc.car.lane = next;
+                    rc.lane = nl;
+                    rc.hop++;
+                    sc.lanes[nl].items.push_back(rl.items[rl.head]);
+                } else {
+                    rc.gone = true;
+                }
+                rl.head++;
+            }
+        }
+    }
+
+    // Стоящие перед красным в конце горизонта подождут ещё до зелёного
+    const double tEnd = now + steps * dt;
+    for (RolloutLane& rl : sc.lanes) {
+        if (rl.cursor < 0)
+            continue;
+        PhaseCursor cur = sc.cursors[rl.cursor];
+        double wait = 0.0;
+        for (double t = tEnd; wait < kHorizon && cur.at(t) != CarSignal::Green;
+             t += dt)
+            wait += dt;
+        if (wait == 0.0)
+            continue;
+        for (size_t pos = rl.head; pos < rl.items.size(); ++pos) {
+            if (sc.cars[rl.items[pos]].car.v < kQueueSpeed)
+                cost += wait;
+        }
+    }
+    return cost;
+}
+
+} // namespace sim
@@ -0,0 +1,135 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <vector>
+#include "../models/mesoscopic.h"
+#include "../models/road_network.h"
+#include "../models/signals.h"
+#include "../models/vehicle.h"
+#include "worker_pool.h"
+
+namespace sim {
+
+// Адаптивные светофоры с прогнозом (MPC). Раз в kDecisionPeriod у
+// перекрёстка, где горит зелёный, снимаются машины его окрестности
+// (подходы, коннекторы, выезды и полосы перед подходами): положение,
+// скорость, параметры и ближайшие шаги маршрута. Сеть не копируется,
+// прогоны читают её по ссылке.
+//
+// Вариант плана - сдвиг конца текущих фаз всех групп перекрёстка:
+// продлить зелёный, оставить как есть или переключить раньше. Сдвиг
+// одинаков для всех групп, так что порядок фаз и межфазные интервалы
+// программы сохраняются. Каждый вариант прокатывается на kHorizon
+// вперёд упрощённой моделью (IDM по полосам, стоп-линии по фазам),
+// варианты считаются параллельно на пуле. Берётся вариант с наименьшей
+// задержкой (плюс ожидание зелёного для стоящих в конце горизонта).
+// За тик - не больше kMaxDecisionsPerTick перекрёстков, остальные ждут
+// следующего тика: время решения ограничено независимо от размера сети.
+class SignalPlanner {
+public:
+    static constexpr double kDecisionPeriod = 2.0;
+    static constexpr double kHorizon = 30.0;
+    static constexpr double kStep = 0.5;     // шаг прогона, с
+    static constexpr double kHoldStep = 4.0; // шаг продления и сокращения
+    static constexpr double kMinGreen = 6.0;
+    static constexpr double kMaxGreen = 60.0;
+    static constexpr double kMinGain = 0.02; // доля выигрыша для сдвига
+    static constexpr size_t kMaxDecisionsPerTick = 8;
+
+    // junctions - id групп светофоров по перекрёсткам
+    void configure(const RoadNetwork& net,
+                   std::vector<std::vector<int>> junctions);
+
+    void update(double now, SignalController& ctl,
+                const std::vector<Vehicle>& vehicles, const MesoModel& meso,
+                WorkerPool* pool);
+
+    struct Stats {
+        uint64_t decisions{0};
+        uint64_t rollouts{0};
+        uint64_t shifts{0};  // решений со сдвигом фаз
+        double lastMs{0.0};  // последний тик с решениями
+        double maxMs{0.0};
+    };
+
+    [[nodiscard]] const Stats& stats() const { return stats_; }
+
+private:
+    static constexpr int kRouteAhead = 4;
+    static constexpr double kMesoLength = 1.8; // как у Vehicle
+
+    struct Junction {
+        std::vector<int> groups;
+        std::vector<LaneId> lanes;     // окрестность
+        std::vector<int> signalGroups; // группы на полосах окрестности
+        double nextDecision{0.0};
+    };
+
+    // Машина снимка
+    struct Car {
+        LaneId lane;
+        double s, v;
+        double length, a, b, T, s0, v0;
+        std::array<LaneId, kRouteAhead> route; // -1 - дальше не знаем
+    };
+
+    // Фаза группы в прогоне: номер и момент окончания
+    struct PhaseCursor {
+        const std::vector<SignalPhase>* phases{nullptr};
+        int idx{0};
+        double end{0.0};
+
+        CarSignal at(double t);
+    };
+
+    struct Candidate {
+        size_t junction;
+        double delta;
+        double cost{0.0};
+    };
+
+    struct RolloutLane {
+        LaneId id;
+        double length, stopS, vFree;
+        int cursor; // -1 - без светофора
+        std::vector<int> items; // машины от головы к хвосту
+        size_t head;
+    };
+
+    struct RolloutCar {
+        Car car;
+        int lane; // локальный номер полосы
+        int hop;
+        int movedAt;
+        bool gone;
+    };
+
+    // Рабочая память одного прогона, живёт между тиками
+    struct Scratch {
+        std::vector<int> localOf;
+        std::vector<RolloutLane> lanes;
+        std::vector<RolloutCar> cars;
+        std::vector<PhaseCursor> cursors; // по Junction::signalGroups
+    };
+
+    const RoadNetwork* net_{nullptr};
+    std::vector<Junction> junctions_;
+    int maxGroupId_{0};
+
+    std::vector<char> needed_; // полоса в окрестности решаемых перекрёстков
+    std::vector<Car> cars_;    // снимок, по (полоса, s убыв.)
+    std::vector<uint32_t> laneStart_;
+    std::vector<PhaseCursor> signals_; // фазы групп на момент снимка, по id
+    std::vector<size_t> due_;
+    std::vector<Candidate> candidates_;
+    std::vector<Scratch> scratch_;
+    Stats stats_;
+
+    void snapshot(const std::vector<Vehicle>& vehicles, const MesoModel& meso);
+    void addCar(LaneId lane, double s, double v, double length,
+                const VehicleParams& p, const RoutePlan& plan);
+    void candidatesFor(size_t j, double now, const SignalController& ctl);
+    double rollout(const Candidate& c, double now, Scratch& sc) const;
+};
+
+} // namespace sim
@@ -4,8 +4,25 @@
 #include "../models/routing.h"
 #include "../models/world_context.h"
 #include "../models/vehicle.h"
+#include "../models/frame_arena.h"
+#include "../models/mesoscopic.h"
+#include "../models/partition.h"
+#include "alloc_counter.h"
+#include "demand.h"
+#include "live_costs.h"
+#include "metrics.h"
+#include "signal_planner.h"
+#include "trajectory_recorder.h"
+#include "worker_pool.h"
+#include <array>
+#include <atomic>
+#include <fstream>
 #include <iostream>
 #include <chrono>
+#include <cassert>
+#include <memory>
+#include <mutex>
+#include <numeric>
 
 namespace sim {
 
@@ -14,8 +31,14 @@ class Simulation {
 public:
     Simulation()
         : world_(&network_, &controller_, &clock_, &object_ptrs_,
-                 &vehicle_ptrs_),
-          pathfinder_(&network_) {}
+                 &vehicle_ptrs_, &timers_, &vehicle_index_),
+          pathfinder_(&network_) {
+        controller_.attachTimers(&clock_, &timers_);
+        world_.scratch = &frame_arena_;
+        world_.outbox = &outbox_;
+        world_.conflicts = &conflicts_;
+        world_.occupancy = &occupancy_;
+    }
 
     void initRoadNetwork() {
         buildRoad(Vec2(42.75, 50.00), Vec2(0, 50.00), "North_Out");
@@ -24,55 +47,272 @@ public:
         buildRoad(Vec2(50.00, 42.92), Vec2(50.00, 0), "West_Out");
 
         createIntersectionConnectors();
+
+        spawn_lanes_ = {2, 4, 6, 8, 10, 12};
+        exit_lanes_ = {1, 3, 5, 7, 9, 11, 13, 15};
+        signal_groups_ = {{1, {2, 4, 12, 10}, false}, {2, {8, 6}, true}};
         initSignals();
+        pathfinder_.precompute(exit_lanes_);
+        route_store_.clear();
+        conflicts_.build(network_);
+        if (!custom_demand_)
+            rebuildDefaultDemand();
+        metrics_.configure(network_);
+        live_costs_.configure(network_);
+        regions_dirty_ = true;
+    }
+
+    // Сетка rows x cols перекрёстков с шагом spacing: дороги по 2 полосы
+    // в каждую сторону, на каждом перекрёстке прямо/налево с внутренней
+    // полосы и прямо/направо с внешней, светофор на две группы (В-З, С-Ю).
+    // По краям - короткие подъезды, где машины появляются и уезжают.
+    void initGridNetwork(int rows, int cols, double spacing = 100.0) {
+        const double gap = 7.0; // от центра перекрёстка до начала дороги
+        const std::array<Vec2, 4> dirs = {Vec2(1, 0), Vec2(0, 1), Vec2(-1, 0),
+                                          Vec2(0, -1)};
+        struct Arm {
+            std::vector<LaneId> in, out; // [0] - ближе к оси дороги
+        };
+        auto junction = [cols](int r, int c) { return r * cols + c; };
+        auto center = [spacing](int r, int c) {
+            return Vec2(c * spacing, r * spacing);
+        };
+        std::vector<std::array<Arm, 4>> arms(rows * cols);
+
+        spawn_lanes_.clear();
+        exit_lanes_.clear();
+        signal_groups_.clear();
+
+        for (int r = 0; r < rows; ++r) {
+            for (int c = 0; c < cols; ++c) {
+                Vec2 C = center(r, c);
+                for (int d = 0; d < 4; ++d) {
+                    int nr = r + static_cast<int>(dirs[d].y);
+                    int nc = c + static_cast<int>(dirs[d].x);
+                    bool inside = nr >= 0 && nr < rows && nc >= 0 && nc < cols;
+                    if (inside && d >= 2)
+                        continue; // дорогу к соседу строит тот, кто левее/ниже
+
+                    Vec2 from = C + dirs[d] * gap;
+                    Vec2 to = inside ? center(nr, nc) - dirs[d] * gap
+                                     : C + dirs[d] * (0.5 * spacing);
+                    auto road = network_.addStraightRoad(from, to, 2, 3.5, 50.0);
+                    Arm& here = arms[junction(r, c)][d];
+                    here.out = road.forward;
+                    here.in = road.backward;
+                    if (inside) {
+                        Arm& there = arms[junction(nr, nc)][(d + 2) % 4];
+                        there.in = road.forward;
+                        there.out = road.backward;
+                    } else {
+                        spawn_lanes_.insert(spawn_lanes_.end(),
+                                            road.backward.begin(),
+                                            road.backward.end());
+                        exit_lanes_.insert(exit_lanes_.end(),
+                                           road.forward.begin(),
+                                           road.forward.end());
+                    }
+                }
+            }
+        }
+
+        for (int j = 0; j < rows * cols; ++j) {
+            SignalGroupSpec ew{2 * j + 1, {}, false, j};
+            SignalGroupSpec ns{2 * j + 2, {}, true, j};
+            for (int a = 0; a < 4; ++a) {
+                const Arm& from = arms[j][a];
+                auto& group = (a % 2 == 0) ? ew : ns;
+                group.lanes.insert(group.lanes.end(), from.in.begin(),
+                                   from.in.end());
+                Vec2 heading = dirs[a] * -1.0;
+                for (int e = 0; e < 4; ++e) {
+                    const Arm& to = arms[j][e];
+                    if (e == a || to.out.empty())
+                        continue;
+                    double turn = cross(heading, dirs[e]);
+                    if (turn >= 0.0) { // прямо или налево - с внутренней
+                        double h = turn > 0.0 ? 8.0 : 5.0;
+                        network_.addConnector(from.in[0], to.out[0], h, h);
+                    }
+                    if (turn <= 0.0) { // прямо или направо - с внешней
+                        double h = turn < 0.0 ? 4.0 : 5.0;
+                        network_.addConnector(from.in[1], to.out[1], h, h);
+                    }
+                }
+            }
+            signal_groups_.push_back(std::move(ew));
+            signal_groups_.push_back(std::move(ns));
+        }
+
+        initSignals();
+        pathfinder_.precompute(exit_lanes_);
+        route_store_.clear();
+        conflicts_.build(network_);
+        if (!custom_demand_)
+            rebuildDefaultDemand();
+        metrics_.configure(network_);
+        live_costs_.configure(network_);
+        regions_dirty_ = true;
     }
 
     Vehicle& addVehicle(const VehicleParams& params,
                         const DriverProfile& driver, LaneId startLane,
                         const Goal& goal, double s0 = 0.0) {
         RouteTracker route(&network_);
-        route.setGoalAndPlan(startLane, goal, pathfinder_);
-        vehicles_.emplace_back(params, driver, startLane, s0, 0.0,
-                               std::move(route));
+        route.setGoalAndPlan(startLane, goal, pathfinder_, &route_store_);
+        vehicles_.emplace_back(next_vehicle_id_++, params, driver, startLane,
+                               s0, 0.0, std::move(route));
+        metrics_.onSpawn(vehicles_.back().id(), clock_.now,
+                         vehicles_.back().route().plan(), params.desiredSpeed);
         syncVehicles();
         return vehicles_.back();
     }
 
-    void addRandomVehicle() {
-        auto rt = getRandomRoute();
-        if (rt.first == -1) {
-            return;
+    // Спрос из файла матрицы корреспонденций (см. parseOdMatrix) вместо
+    // равномерного по въездам; вызывать после построения сети
+    bool loadDemand(const std::string& path) {
+        std::ifstream in(path);
+        std::vector<OdSlice> slices;
+        std::string error = "cannot open file";
+        if (!in || !parseOdMatrix(in, slices, error)) {
+            std::cerr << "[demand] " << path << ": " << error << std::endl;
+            return false;
         }
-        if (!rt.second.plan().valid()) {
-            return;
-        }
-        vehicles_.emplace_back(Vehicle::randomVehicle(rt.first, rt.second));
-        std::cout << "vh spawned " << vehicles_.back().id() << std::endl;
-        syncVehicles();
+        custom_demand_ = true;
+        demand_.setMatrix(std::move(slices), network_);
+        restartDemand();
+        return true;
+    }
+
+    // Средний интервал между машинами для спроса по умолчанию, для
+    // матрицы из файла - обратный множитель её интенсивностей.
+    // Применяется в начале следующего update() (команды из потока ввода).
+    void setSpawnInterval(double seconds) {
+        std::lock_guard<std::mutex> lk(demand_mutex_);
+        demand_scale_ = 1.0 / std::max(0.1, seconds);
+        demand_dirty_ = true;
+    }
+
+    // Классы новых машин: модели следования и перестроения с долями
+    // в потоке. Применяются в начале следующего update(); уже едущие
+    // машины остаются при своих моделях.
+    void setVehicleClasses(std::vector<VehicleClass> classes) {
+        if (classes.empty())
+            classes.emplace_back();
+        std::lock_guard<std::mutex> lk(demand_mutex_);
+        pending_classes_ = std::move(classes);
+        classes_dirty_ = true;
+    }
+
+    // A* на каждый запрос или таблица следующих шагов к выездам;
+    // стоимость маршрутов одинаковая, кэш маршрутов сбрасывается.
+    // Применяется в начале следующего update().
+    void setRoutingMode(RoutingMode mode) {
+        pending_routing_mode_ = static_cast<int>(mode);
+    }
+
+    // Объезд заторов (по умолчанию выключен): маршруты считаются по
+    // измеренному времени проезда полос, машины в пути раз в период
+    // перепланируются (см. reroute). Применяется в начале следующего update().
+    void setRerouting(bool on) {
+        pending_rerouting_ = on ? 1 : 0;
+    }
+
+    // Машин, сменивших маршрут на последнем перепланировании
+    size_t lastRerouted() const { return last_rerouted_; }
+
+    // Параллельный шаг по областям сети (RegionPartition): каждая область
+    // считается целиком в одном потоке, соседей из чужих областей видит
+    // снимками начала тика. Результат не зависит от числа потоков.
+    // threads == 0 - прежний последовательный шаг по всем машинам.
+    void setWorkerThreads(int threads) {
+        worker_threads_ = std::max(0, threads);
+        pool_ = worker_threads_ > 1 ? std::make_unique<WorkerPool>(worker_threads_)
+                                    : nullptr;
+        regions_dirty_ = true;
     }
 
     void update(double dt) {
-        clock_.now += dt;
-        if (isControllerAdaptive) {
-            controller_.applyAdaptiveLogic(world_);
+        const uint64_t allocsBefore = alloc::count();
+        frame_arena_.reset();
+        if (reset_pending_.exchange(false))
+            applyReset();
+        if (demand_dirty_)
+            applyDemandChanges();
+        if (classes_dirty_) {
+            std::lock_guard<std::mutex> lk(demand_mutex_);
+            vehicle_classes_.swap(pending_classes_);
+            classes_dirty_ = false;
+        }
+
+        if (program_dirty_) {
+            std::array<double, 3> p;
+            {
+                std::lock_guard<std::mutex> lk(control_mutex_);
+                p = pending_program_;
+                program_dirty_ = false;
+            }
+            applySignalProgram(p[0], p[1], p[2]);
+        }
+        if (zones_dirty_)
+            applyZoneSettings();
+        if (const double p = pending_kpi_period_.exchange(0.0); p > 0.0)
+            metrics_.setPeriod(p);
+        if (const int m = pending_routing_mode_.exchange(-1); m >= 0) {
+            pathfinder_.setMode(static_cast<RoutingMode>(m));
+            route_store_.clear();
+            warmRoutes();
         }
+        if (const int r = pending_rerouting_.exchange(-1); r >= 0)
+            applyRerouting(r != 0);
+
+        clock_.now += dt;
+        if (isControllerAdaptive)
+            planner_.update(clock_.now, controller_, vehicles_, meso_,
+                            pool_.get());
         controller_.update(dt);
-        for (auto& v : vehicles_)
-            v.update(dt, world_);
+
+        fired_timers_.clear();
+        timers_.advance(clock_.now, fired_timers_);
+        for (const TimerEvent& e : fired_timers_)
+            dispatchTimer(e);
+
+        if (meso_.enabled())
+            stepMeso(dt);
+        stepVehicles(dt);
+        deliverMessages();
+        if (meso_.enabled())
+            handOverToMeso();
         kill();
+        spawnDemand();
+        sampleMetrics(dt);
+        if (rerouting_ && clock_.now >= next_reroute_)
+            reroute();
+        recordFrame();
+
+        last_update_allocations_ = alloc::count() - allocsBefore;
     }
 
-    void reset() {
-        vehicles_.clear();
-        vehicle_ptrs_.clear();
-        object_ptrs_.clear();
+    // Обращения к куче за последний update() (только с ITS_COUNT_ALLOCATIONS)
+    uint64_t lastUpdateAllocations() const { return last_update_allocations_; }
 
-        clock_.now = 0.0;
+    // Полных шагов машин за последний update(): без спящих и катящихся
+    size_t lastEffectiveUpdates() const { return effective_updates_; }
 
-        initSignals();
+    // false - эталонный режим: каждая машина делает полный шаг на каждом тике
+    void setMultiRate(bool on) { multi_rate_ = on; }
 
-        syncVehicles();
-    }
+    // Зерно RNG спроса и классов машин (без вызова - от часов). Вызывать
+    // до построения сети: первые прибытия ставятся при построении.
+    // Зёрна машин - от их id, счёт id у каждой симуляции свой.
+    void setSeed(uint64_t seed) { rngg = RNG(seed); }
+
+    // Куда писать "vh spawned/deleted"; nullptr - никуда (прогоны без клиента)
+    void setEventOutput(std::ostream* out) { events_ = out; }
+
+    // Начать прогон заново: машины, таймеры, спрос и метрики с нуля.
+    // Применяется в начале следующего update() (команды из потока ввода).
+    void reset() { reset_pending_ = true; }
 
     void buildRoad(const Vec2& from, const Vec2& to, const std::string& name) {
         auto result = network_.addStraightRoad(from, to, 2, 3.5, 50.0);
@@ -83,65 +323,70 @@ public:
     }
 
     void createIntersectionConnectors() {
-        network_.addConnector(2, 7, 6.00, 6.00, 30);
-        network_.addConnector(2, 5, 5.00, 5.00, 30);
+        network_.addConnector(2, 7, 6.00, 6.00);
+        network_.addConnector(2, 5, 5.00, 5.00);
 
-        // network_.addConnector(4, 5, 7.00, 7.00, 30);
-        // network_.addConnector(4, 7, 8.00, 8.00, 30);
+        // network_.addConnector(4, 5, 7.00, 7.00);
+        // network_.addConnector(4, 7, 8.00, 8.00);
 
-        network_.addConnector(2, 9, 7.00, 7.00, 30);
-        network_.addConnector(4, 11, 8.00, 8.00, 30);
-        network_.addConnector(4, 13, 6.00, 0.10, 30);
+        network_.addConnector(2, 9, 7.00, 7.00);
+        network_.addConnector(4, 11, 8.00, 8.00);
+        network_.addConnector(4, 13, 6.00, 0.10);
 
-        network_.addConnector(10, 15, 6.00, 6.00, 30);
-        network_.addConnector(10, 13, 5.00, 5.00, 30);
-        network_.addConnector(12, 7, 0.5, 0.5, 30);
-        network_.addConnector(12, 5, 6.00, 0.10, 30);
-        network_.addConnector(12, 3, 8.00, 8.00, 30);
-        network_.addConnector(10, 1, 7.00, 7.00, 30);
+        network_.addConnector(10, 15, 6.00, 6.00);
+        network_.addConnector(10, 13, 5.00, 5.00);
+        network_.addConnector(12, 7, 0.5, 0.5);
+        network_.addConnector(12, 5, 6.00, 0.10);
+        network_.addConnector(12, 3, 8.00, 8.00);
+        network_.addConnector(10, 1, 7.00, 7.00);
 
-        network_.addConnector(6, 11, 6.00, 6.00, 30);
-        network_.addConnector(6, 9, 5.00, 5.00, 30);
-        network_.addConnector(6, 13, 5.00, 5.00, 30);
-        network_.addConnector(8, 1, 5.00, 1, 30);
-        network_.addConnector(8, 3, 0.50, 0.5, 30);
-        network_.addConnector(8, 15, 5.00, 5.00, 30);
+        network_.addConnector(6, 11, 6.00, 6.00);
+        network_.addConnector(6, 9, 5.00, 5.00);
+        network_.addConnector(6, 13, 5.00, 5.00);
+        network_.addConnector(8, 1, 5.00, 1);
+        network_.addConnector(8, 3, 0.50, 0.5);
+        network_.addConnector(8, 15, 5.00, 5.00);
     }
 
     void initSignals() {
-        SignalPhase red{30, CarSignal::Red};
-        SignalPhase green{20, CarSignal::Green};
-        SignalPhase yellow{3, CarSignal::Yellow};
-        TrafficLightGroup group1;
-        TrafficLightGroup group2;
-        group1.id = 1;
-        group2.id = 2;
-        group1.setProgram({red, yellow, green, yellow});
-        group2.setProgram({green, yellow, red, yellow});
-        network_.getLane(2)->signalGroupId = group1.id;
-        network_.getLane(4)->signalGroupId = group1.id;
-        network_.getLane(12)->signalGroupId = group1.id;
-        network_.getLane(10)->signalGroupId = group1.id;
-        network_.getLane(8)->signalGroupId = group2.id;
-        network_.getLane(6)->signalGroupId = group2.id;
-        controller_.addCarGroup(group1);
-        controller_.addCarGroup(group2);
+        for (const SignalGroupSpec& spec : signal_groups_) {
+            for (LaneId lane : spec.lanes)
+                network_.getLane(lane)->signalGroupId = spec.id;
+        }
+        applySignalProgram(30, 3, 20);
+
+        std::vector<std::vector<int>> junctions;
+        for (const SignalGroupSpec& spec : signal_groups_) {
+            if (spec.junction >= static_cast<int>(junctions.size()))
+                junctions.resize(spec.junction + 1);
+            junctions[spec.junction].push_back(spec.id);
+        }
+        planner_.configure(network_, std::move(junctions));
     }
 
+    // Программа всех групп (change_phases); применяется в начале
+    // следующего update(): колесо таймеров трогает только поток симуляции
     void setSignalProgram(double red_s, double yellow_s, double green_s) {
+        std::lock_guard<std::mutex> lk(control_mutex_);
+        pending_program_ = {red_s, yellow_s, green_s};
+        program_dirty_ = true;
+    }
+
+    void applySignalProgram(double red_s, double yellow_s, double green_s) {
         SignalPhase red{red_s, CarSignal::Red};
         SignalPhase yellow{yellow_s, CarSignal::Yellow};
         SignalPhase green{green_s, CarSignal::Green};
 
-        TrafficLightGroup group1, group2;
-        group1.id = 1;
-        group2.id = 2;
-
-        group1.setProgram({red, yellow, green, yellow});
-        group2.setProgram({green, yellow, red, yellow});
-
-        controller_.addCarGroup(group1);
-        controller_.addCarGroup(group2);
+        for (const SignalGroupSpec& spec : signal_groups_) {
+            TrafficLightGroup group;
+            group.id = spec.id;
+            group.controlledLaneIds = spec.lanes;
+            if (spec.startsGreen)
+                group.setProgram({green, yellow, red, yellow});
+            else
+                group.setProgram({red, yellow, green, yellow});
+            controller_.addCarGroup(group);
+        }
     }
 
     void setAdaptiveMode(bool state) {
@@ -162,11 +407,79 @@ public:
             return;
         }
 
+        std::lock_guard<std::mutex> lk(demand_mutex_);
         for (int lane : it->second) {
             spawnWeights_[lane] = value;
         }
+        demand_weights_changed_ = true;
+        demand_dirty_ = true;
+    }
+
+
+    // Гибридный режим: вне микро-зон машины идут очередями по полосам.
+    // Микро-зоны - круги вокруг перекрёстков и, если задано, окно просмотра.
+    // Режим и зоны меняются в начале следующего update().
+    void setHybridMode(bool on) {
+        std::lock_guard<std::mutex> lk(control_mutex_);
+        pending_zones_.hybrid = on;
+        zones_dirty_ = true;
     }
 
+    void setJunctionZoneRadius(double r) {
+        std::lock_guard<std::mutex> lk(control_mutex_);
+        pending_zones_.junctionRadius = std::max(0.0, r);
+        zones_dirty_ = true;
+    }
+
+    void setViewport(const Vec2& a, const Vec2& b) {
+        std::lock_guard<std::mutex> lk(control_mutex_);
+        pending_zones_.viewport = MicroZone::rect(a, b);
+        zones_dirty_ = true;
+    }
+
+    void clearViewport() {
+        std::lock_guard<std::mutex> lk(control_mutex_);
+        pending_zones_.viewport.reset();
+        zones_dirty_ = true;
+    }
+
+    const MesoModel& meso() const { return meso_; }
+
+    // Показатели за период: строки "kpi ..." (см. Metrics)
+    bool kpiDue() const { return metrics_.due(clock_.now); }
+
+    void writeKpi(std::ostream& out) { metrics_.write(out, clock_.now); }
+
+    // Применяется в начале следующего update() (команда из потока ввода)
+    void setKpiPeriod(double seconds) {
+        pending_kpi_period_ = std::max(1.0, seconds);
+    }
+
+    // Итоги за прогон (см. Metrics::summary); restartKpiTotals - начать
+    // их заново, например после разгона
+    MetricsSummary kpiSummary() const { return metrics_.summary(clock_.now); }
+
+    void restartKpiTotals() { metrics_.restartTotals(clock_.now); }
+
+    // Счётчики и время решений планировщика светофоров (SignalPlanner)
+    const SignalPlanner::Stats& signalPlannerStats() const {
+        return planner_.stats();
+    }
+
+    // Запись траекторий в файл (см. TrajectoryRecorder), compress - zlib
+    bool startRecording(const std::string& path, bool compress) {
+        std::lock_guard<std::mutex> lk(recorder_mutex_);
+        return recorder_.start(path, compress);
+    }
+
+    void stopRecording() {
+        std::lock_guard<std::mutex> lk(recorder_mutex_);
+        if (!recorder_.active())
+            return;
+        recorder_.stop();
+        std::cerr << "[record] " << recorder_.framesWritten() << " ticks, "
+                  << recorder_.bytesWritten() << " bytes" << std::endl;
+    }
 
     void removeVehicleById(int id) {
         auto it =
@@ -175,28 +488,32 @@ public:
         if (it != vehicles_.end()) {
             vehicles_.erase(it, vehicles_.end());
             syncVehicles();
-            std::cout << "vh deleted " << id << std::endl;
+            if (events_)
+                *events_ << "vh deleted " << id << std::endl;
         }
     }
 
     void kill() {
-        std::vector<int> idsToRemove;
+        std::vector<int>& idsToRemove = kill_buf_;
+        idsToRemove.clear();
 
         for (auto& v : vehicles_) {
             Lane* L = network_.getLane(v.laneId());
             if (!L)
                 continue;
-            if (v.route().plan().steps.empty())
+            if (v.route().plan().steps().empty())
                 continue;
 
-            if (v.laneId() == v.route().plan().steps.back().lane &&
+            if (v.laneId() == v.route().plan().steps().back().lane &&
                 v.s() >= L->length()) {
                 idsToRemove.push_back(v.id());
             }
         }
 
-        for (int id : idsToRemove)
+        for (int id : idsToRemove) {
+            metrics_.onTripEnd(id, clock_.now);
             removeVehicleById(id);
+        }
     }
 
     const RoadNetwork& network() const { return network_; }
@@ -212,9 +529,107 @@ private:
     std::vector<Vehicle> vehicles_;
     std::vector<Vehicle*> vehicle_ptrs_;
     std::vector<SimObject*> object_ptrs_;
+    VehicleIndex vehicle_index_;
+    ConflictTable conflicts_;
+    LaneOccupancy occupancy_;
+    TimerWheel timers_;
+    std::vector<TimerEvent> fired_timers_;
+    Mailbox outbox_;
+    Mailbox inbox_;
+    FrameArena frame_arena_;
+    std::vector<int> kill_buf_;
+    FollowBatches follow_batch_;
+    std::vector<int> follow_rows_;
+    std::vector<double> lane_mover_front_;
+    uint64_t last_update_allocations_{0};
+    MesoModel meso_;
+    bool multi_rate_{true};
+    size_t effective_updates_{0};
+    struct ZoneSettings {
+        bool hybrid{false};
+        double junctionRadius{30.0};
+        std::optional<MicroZone> viewport;
+    };
+    ZoneSettings zones_;
+    std::vector<MesoVehicle> to_micro_;
+    std::vector<uint64_t> meso_finished_;
+
+    // Светофорная группа сети: полосы перед стоп-линией и стартовая фаза
+    struct SignalGroupSpec {
+        int id;
+        std::vector<LaneId> lanes;
+        bool startsGreen;
+        int junction{0}; // группы одного перекрёстка переключаются вместе
+    };
+    std::vector<SignalGroupSpec> signal_groups_;
+    std::vector<LaneId> spawn_lanes_;
+    std::vector<LaneId> exit_lanes_;
+
+    // Область сети со своим видом мира: свои машины, призраки соседей,
+    // арена, отложенные таймеры и строки IDM
+    struct Region {
+        WorldContext ctx;
+        std::vector<size_t> members; // индексы в vehicles_
+        std::vector<Vehicle> ghosts;
+        size_t ghostCount{0};
+        std::vector<Vehicle*> view;
+        VehicleIndex index;
+        LaneOccupancy occupancy;
+        FrameArena arena;
+        std::vector<TimerEvent> deferred;
+        Mailbox outbox;
+        FollowBatches batch;
+        std::vector<int> rows;
+        size_t updates{0};
+    };
+    int worker_threads_{0};
+    bool regions_dirty_{true};
+    RegionPartition partition_;
+    std::vector<std::unique_ptr<Region>> regions_;
+    std::unique_ptr<WorkerPool> pool_;
+    std::vector<size_t> all_members_;
     WorldContext world_;
     Pathfinder pathfinder_;
+    RouteStore route_store_;
+    Metrics metrics_;
+    LiveLaneCosts live_costs_;
+    bool rerouting_{false};
+    double next_reroute_{kReroutePeriod};
+    size_t last_rerouted_{0};
+    std::vector<size_t> reroute_candidates_;
+    std::vector<RouteTracker> reroute_results_;
+    std::vector<char> reroute_accept_;
+
+    static constexpr double kReroutePeriod = 5.0;
+    static constexpr size_t kRerouteBatch = 32;
+    static constexpr double kRerouteMinDistance = 40.0; // до конца полосы
+    static constexpr double kRerouteGain = 0.1;         // выигрыш от 10%
+    TrajectoryRecorder recorder_;
+    std::mutex recorder_mutex_; // команды записи приходят из потока ввода
     bool isControllerAdaptive = false;
+    SignalPlanner planner_;
+    std::mutex control_mutex_; // прочие настройки из потока ввода
+    std::array<double, 3> pending_program_{}; // красный, жёлтый, зелёный
+    std::atomic<bool> program_dirty_{false};
+    ZoneSettings pending_zones_;
+    std::atomic<bool> zones_dirty_{false};
+    std::atomic<double> pending_kpi_period_{0.0}; // 0 - без изменений
+    std::atomic<int> pending_routing_mode_{-1};   // RoutingMode, -1 - нет
+    std::atomic<int> pending_rerouting_{-1};      // 0/1, -1 - нет
+    std::atomic<bool> reset_pending_{false};
+    DemandModel demand_;
+    bool custom_demand_{false};
+    std::vector<double> origin_tail_;
+    std::mutex demand_mutex_;  // веса и масштаб меняет поток ввода
+    std::atomic<bool> demand_dirty_{false};
+    double demand_scale_{1.0};
+    bool demand_weights_changed_{false};
+    static constexpr double kEntryClearance = 5.0; // свободное начало въезда
+    uint64_t next_vehicle_id_{0};
+    std::ostream* events_{&std::cout};
+    std::vector<VehicleClass> vehicle_classes_{VehicleClass{}};
+    std::vector<VehicleClass> pending_classes_;
+    std::atomic<bool> classes_dirty_{false};
     RNG rngg{static_cast<uint64_t>(
         std::chrono::high_resolution_clock::now().time_since_epoch().count())};
     std::unordered_map<int, double> spawnWeights_ = {
@@ -230,73 +645,598 @@ private:
     void syncVehicles() {
         vehicle_ptrs_.clear();
         object_ptrs_.clear();
-        for (auto& v : vehicles_)
+        vehicle_index_.clear();
+        for (auto& v : vehicles_) {
             vehicle_ptrs_.push_back(&v);
+            vehicle_index_.emplace_back(v.id(), &v);
+        }
+        std::sort(vehicle_index_.begin(), vehicle_index_.end());
         for (auto& v : objects_)
             object_ptrs_.push_back(v);
     }
 
-    int chooseLaneWeighted(const std::vector<int>& lanes) {
-        double total = 0;
+    void rebuildMicroZones() {
+        std::vector<MicroZone> zones;
+        for (const auto& [id, L] : network_.lanes()) {
+            if (!L.isConnector || L.center.empty())
+                continue;
+            const Vec2& a = L.center.points().front();
+            const Vec2& b = L.center.points().back();
+            zones.push_back(MicroZone::circle((a + b) * 0.5,
+                                              zones_.junctionRadius));
+        }
+        if (zones_.viewport)
+            zones.push_back(*zones_.viewport);
+        meso_.configure(network_, zones);
+    }
 
-        for (int lane : lanes)
-            total += spawnWeights_[lane];
+    // Сброс по reset(): здесь, в update(), пока пул потоков свободен
+    void applyReset() {
+        vehicles_.clear();
+        vehicle_ptrs_.clear();
+        object_ptrs_.clear();
 
-        double r = rngg.uniform(0.0, total);
-        double accum = 0.0;
+        clock_.now = 0.0;
+        timers_.clear();
+        meso_.clear();
+        outbox_.clear();
+        metrics_.clear();
+        live_costs_.clear();
+        next_reroute_ = kReroutePeriod;
+        refreshRouteCosts();
+        demand_.clearPending();
+        restartDemand();
+
+        initSignals();
+
+        syncVehicles();
+    }
 
-        for (int lane : lanes) {
-            accum += spawnWeights_[lane];
-            if (r <= accum)
-                return lane;
+    // Новые зоны или режим: при выключении все мезо-машины
+    // возвращаются в микро-модель на своих местах
+    void applyZoneSettings() {
+        const bool wasHybrid = zones_.hybrid;
+        {
+            std::lock_guard<std::mutex> lk(control_mutex_);
+            zones_ = pending_zones_;
+            zones_dirty_ = false;
         }
+        if (zones_.hybrid) {
+            meso_.setEnabled(true);
+            rebuildMicroZones();
+            return;
+        }
+        if (!wasHybrid)
+            return;
+        meso_.setEnabled(false);
+        to_micro_.clear();
+        meso_.drain(to_micro_);
+        for (MesoVehicle& mv : to_micro_)
+            spawnFromMeso(std::move(mv));
+        syncVehicles();
+    }
 
-        return lanes.back();
+    void spawnFromMeso(MesoVehicle mv) {
+        vehicles_.emplace_back(mv.id, mv.params, mv.driver, mv.lane, mv.s,
+                               mv.v, std::move(mv.route), true);
     }
 
+    // Место в микро-модели свободно, если рядом на полосе нет машины
+    bool canEnterMicro(LaneId lane, double s) const {
+        for (const Vehicle& v : vehicles_) {
+            if (v.laneId() == lane &&
+                std::abs(v.s() - s) < v.params().minGap + v.length() + 2.0)
+                return false;
+        }
+        return true;
+    }
 
-    std::pair<LaneId, RouteTracker> getRandomRoute() {
-        std::vector<int> startLanes = {2, 4, 6, 8, 10, 12};
-        std::vector<int> endLanes = {1, 3, 5, 7, 9, 11, 13, 15};
+    void stepMeso(double dt) {
+        to_micro_.clear();
+        meso_finished_.clear();
+        meso_.step(dt, network_,
+                   [this](LaneId lane, double s) {
+                       return canEnterMicro(lane, s);
+                   },
+                   to_micro_, meso_finished_);
 
-        std::vector<int> freeLanes;
-        for (int laneId : startLanes) {
-            bool isOccupied = false;
-            for (const Vehicle& veh : vehicles_) {
-                if (veh.laneId() == laneId && veh.s() < 5.0) {
-                    isOccupied = true;
-                    break;
-                }
+        for (uint64_t id : meso_finished_) {
+            metrics_.onTripEnd(id, clock_.now);
+            if (events_)
+                *events_ << "vh deleted " << id << std::endl;
+        }
+        if (to_micro_.empty())
+            return;
+        for (MesoVehicle& mv : to_micro_)
+            spawnFromMeso(std::move(mv));
+        syncVehicles();
+    }
+
+    // Машины, выехавшие из микро-зон, уходят в очереди мезо-модели
+    // с тем же id, положением, скоростью и маршрутом
+    void handOverToMeso() {
+        bool moved = false;
+        for (Vehicle& v : vehicles_) {
+            if (meso_.isMicro(v.laneId(), v.s()) || !v.laneChangeIdle())
+                continue;
+            meso_.insert(MesoVehicle{v.id(), v.params(), v.driver(),
+                                     v.route(), v.laneId(), Real(v.s()),
+                                     Real(v.v())},
+                         network_);
+            moved = true;
+        }
+        if (!moved)
+            return;
+        vehicles_.erase(
+            std::remove_if(vehicles_.begin(), vehicles_.end(),
+                           [this](const Vehicle& v) {
+                               return !meso_.isMicro(v.laneId(), v.s()) &&
+                                      v.laneChangeIdle();
+                           }),
+            vehicles_.end());
+        syncVehicles();
+    }
+
+    // Все машины за три прохода: сбор входов, пакеты моделей следования
+    // (по одному однородному ядру на модель), движение.
+    // Лидеров читаем в состоянии начала тика - порядок машин не важен.
+    void stepVehicles(double dt) {
+        if (worker_threads_ > 0) {
+            stepRegions(dt);
+        } else {
+            occupancy_.rebuild(vehicle_ptrs_, network_.maxLaneId());
+            all_members_.resize(vehicles_.size());
+            std::iota(all_members_.begin(), all_members_.end(), size_t{0});
+            effective_updates_ =
+                stepGroup(all_members_, world_, follow_batch_, follow_rows_, dt);
+        }
+        updateSleep();
+    }
+
+    size_t stepGroup(const std::vector<size_t>& members, WorldContext& ctx,
+                     FollowBatches& batch, std::vector<int>& rows, double dt) {
+        size_t updates = 0;
+        batch.clear();
+        rows.resize(members.size());
+        for (size_t k = 0; k < members.size(); ++k) {
+            Vehicle& v = vehicles_[members[k]];
+            rows[k] = -1;
+            if (v.asleep() || coasting(v))
+                continue;
+            ++updates;
+            v.beginStep(dt, ctx);
+            rows[k] = v.pushFollowRow(batch);
+        }
+
+        batch.run(dt);
+#ifndef NDEBUG
+        const IdmBatch& idm = batch.of<IdmModel>();
+        for (size_t r = 0; r < idm.size(); ++r) {
+            double ref = idmAccelReference(
+                idm.v[r], idm.vFront[r], idm.gap[r], idm.a[r],
+                1.0 / (4.0 * idm.a[r] * idm.invBrake[r] * idm.invBrake[r]),
+                idm.T[r], idm.s0[r], 1.0 / idm.invV0[r]);
+            assert(std::abs(idm.out[r] - ref) <=
+                   kIdmTolerance * std::max(1.0, std::abs(ref)));
+        }
+#endif
+
+        for (size_t k = 0; k < members.size(); ++k) {
+            Vehicle& v = vehicles_[members[k]];
+            if (v.asleep())
+                continue;
+            if (coasting(v)) {
+                v.coast(dt, ctx);
+                continue;
+            }
+            v.endStep(dt, ctx,
+                      rows[k] >= 0 ? batch.out(v.params().following, rows[k])
+                                   : 0.0);
+        }
+        return updates;
+    }
+
+    void rebuildRegions() {
+        partition_ = RegionPartition::build(network_);
+        regions_.clear();
+        for (int r = 0; r < partition_.regionCount; ++r) {
+            auto region = std::make_unique<Region>();
+            region->ctx = world_;
+            region->ctx.vehicles = &region->view;
+            region->ctx.vehicleIndex = &region->index;
+            region->ctx.occupancy = &region->occupancy;
+            region->ctx.timers = nullptr;
+            region->ctx.deferredTimers = &region->deferred;
+            region->ctx.scratch = &region->arena;
+            region->ctx.outbox = &region->outbox;
+            regions_.push_back(std::move(region));
+        }
+        regions_dirty_ = false;
+    }
+
+    // Машина, видимая области как призрак: копия на начало тика.
+    // Запросы уступки призраку до оригинала не доходят - партнёры
+    // по перестроению едут по одной дороге и всегда в одной области.
+    void addGhost(Region& r, const Vehicle& v) {
+        if (r.ghostCount < r.ghosts.size())
+            r.ghosts[r.ghostCount] = v;
+        else
+            r.ghosts.push_back(v);
+        r.ghostCount++;
+    }
+
+    void stepRegions(double dt) {
+        if (regions_dirty_)
+            rebuildRegions();
+
+        for (auto& r : regions_) {
+            r->members.clear();
+            r->ghostCount = 0;
+            r->deferred.clear();
+            r->outbox.clear();
+            r->arena.reset();
+        }
+        for (size_t i = 0; i < vehicles_.size(); ++i) {
+            LaneId lane = vehicles_[i].laneId();
+            regions_[partition_.regionOf(lane)]->members.push_back(i);
+            if (lane >= 0 && lane < (LaneId)partition_.haloOf.size()) {
+                for (int r : partition_.haloOf[lane])
+                    addGhost(*regions_[r], vehicles_[i]);
             }
-            if (!isOccupied)
-                freeLanes.push_back(laneId);
+        }
+        for (auto& r : regions_) {
+            r->view.clear();
+            r->index.clear();
+            for (size_t i : r->members)
+                r->view.push_back(&vehicles_[i]);
+            for (size_t g = 0; g < r->ghostCount; ++g)
+                r->view.push_back(&r->ghosts[g]);
+            for (Vehicle* v : r->view)
+                r->index.emplace_back(v->id(), v);
+            std::sort(r->index.begin(), r->index.end());
+            r->occupancy.rebuild(r->view, network_.maxLaneId());
         }
 
-        if (freeLanes.empty()) {
-            return {-1, RouteTracker(&network_)};
+        const std::function<void(size_t)> task = [this, dt](size_t i) {
+            Region& r = *regions_[i];
+            r.updates = stepGroup(r.members, r.ctx, r.batch, r.rows, dt);
+        };
+        if (pool_)
+            pool_->run(regions_.size(), task);
+        else
+            for (size_t i = 0; i < regions_.size(); ++i)
+                task(i);
+
+        effective_updates_ = 0;
+        for (auto& r : regions_) {
+            effective_updates_ += r->updates;
+            for (const TimerEvent& e : r->deferred)
+                timers_.schedule(e.due, e.owner, e.tag, e.cookie);
+            outbox_.insert(outbox_.end(), r->outbox.begin(), r->outbox.end());
         }
+    }
 
-        int startLane = chooseLaneWeighted(freeLanes);
+    // Фаза обмена: сообщения тика доставляются по получателям в порядке
+    // отправки. Ответы, написанные при доставке, уходят в следующий тик.
+    // Порядок отправки - номер seq, так что хватает std::sort без буфера.
+    void deliverMessages() {
+        inbox_.swap(outbox_);
+        outbox_.clear();
+        for (size_t i = 0; i < inbox_.size(); ++i)
+            inbox_[i].seq = static_cast<uint32_t>(i);
+        std::sort(inbox_.begin(), inbox_.end(),
+                  [](const VehicleMessage& a, const VehicleMessage& b) {
+                      return a.to < b.to || (a.to == b.to && a.seq < b.seq);
+                  });
+        for (const VehicleMessage& msg : inbox_) {
+            if (Vehicle* v = world_.getVehicle(static_cast<int>(msg.to)))
+                v->onMessage(msg, world_);
+        }
+        inbox_.clear();
+    }
 
-        int k = (startLane - 2) / 4;
-        int forbid1 = 4 * k + 1;
-        int forbid2 = 4 * k + 3;
+    void sampleMetrics(double dt) {
+        metrics_.beginTick(dt);
+        for (const Vehicle& v : vehicles_) {
+            metrics_.sample({v.id(), v.laneId(), v.v()});
+            live_costs_.sample(v.laneId(), v.v());
+        }
+        meso_.forEach([this](const MesoVehicle& mv) {
+            metrics_.sample({mv.id, mv.lane, mv.v});
+            live_costs_.sample(mv.lane, mv.v);
+        });
+        metrics_.endTick();
+    }
+
+    void applyRerouting(bool on) {
+        rerouting_ = on;
+        if (!on)
+            live_costs_.clear();
+        next_reroute_ = clock_.now + kReroutePeriod;
+        refreshRouteCosts();
+        warmRoutes();
+    }
 
-        std::vector<int> allowedEndLanes;
-        for (int laneId : endLanes) {
-            if (laneId != forbid1 && laneId != forbid2)
-                allowedEndLanes.push_back(laneId);
+    // Текущие стоимости полос в поиск, таблица следующих шагов
+    // пересчитывается по цели на задачу, кэш маршрутов сбрасывается.
+    // Только из update() (reroute, applyRerouting, applyReset): пул
+    // не реентерабелен и в это время свободен.
+    void refreshRouteCosts() {
+        pathfinder_.setLiveCosts(live_costs_.travelTimes());
+        const std::function<void(size_t)> task = [this](size_t k) {
+            pathfinder_.rebuildTarget(k);
+        };
+        if (pool_)
+            pool_->run(pathfinder_.targetCount(), task);
+        else
+            for (size_t k = 0; k < pathfinder_.targetCount(); ++k)
+                task(k);
+        route_store_.clear();
+    }
+
+    // Перепланирование раз в kReroutePeriod: обновить стоимости полос,
+    // выбрать машины, чей оставшийся путь идёт через затор, и посчитать
+    // им маршруты пачками на пуле потоков. Новый маршрут берётся, если
+    // он дешевле текущего на kRerouteGain; подмена - после всех пачек,
+    // до следующего тика. Мезо-машины маршрут не меняют.
+    void reroute() {
+        next_reroute_ = clock_.now + kReroutePeriod;
+        live_costs_.update();
+        refreshRouteCosts();
+
+        reroute_candidates_.clear();
+        for (size_t i = 0; i < vehicles_.size(); ++i) {
+            if (canReroute(vehicles_[i]))
+                reroute_candidates_.push_back(i);
         }
+        const size_t n = reroute_candidates_.size();
+        reroute_results_.assign(n, RouteTracker(&network_));
+        reroute_accept_.assign(n, 0);
 
-        int goalLane = allowedEndLanes[rngg.uniform(
-            0, (int)allowedEndLanes.size() - 1)];
+        const std::function<void(size_t)> task = [this, n](size_t b) {
+            const size_t end = std::min(n, (b + 1) * kRerouteBatch);
+            for (size_t j = b * kRerouteBatch; j < end; ++j) {
+                const Vehicle& v = vehicles_[reroute_candidates_[j]];
+                RouteTracker& rt = reroute_results_[j];
+                rt = v.route();
+                if (!rt.replanFrom(v.laneId(), pathfinder_, &route_store_))
+                    continue;
+                double fresh = pathfinder_.cost(rt.plan());
+                reroute_accept_[j] =
+                    fresh < remainingCost(v) * (1.0 - kRerouteGain);
+            }
+        };
+        const size_t batches = (n + kRerouteBatch - 1) / kRerouteBatch;
+        if (pool_)
+            pool_->run(batches, task);
+        else
+            for (size_t b = 0; b < batches; ++b)
+                task(b);
 
-        RouteTracker route_tracker(&network_);
-        route_tracker.setGoalAndPlan(startLane,
-                                     Goal::toLane(goalLane),
-                                     pathfinder_);
+        last_rerouted_ = 0;
+        for (size_t j = 0; j < n; ++j) {
+            if (!reroute_accept_[j])
+                continue;
+            vehicles_[reroute_candidates_[j]].route() =
+                std::move(reroute_results_[j]);
+            ++last_rerouted_;
+        }
+    }
+
+    // Менять маршрут можно на обычной полосе вдали от её конца, без
+    // перестроения; имеет смысл, если впереди по маршруту затор
+    bool canReroute(const Vehicle& v) const {
+        const Lane* L = network_.getLane(v.laneId());
+        const RoutePlan& plan = v.route().plan();
+        if (!L || L->isConnector || !plan.valid() || !v.laneChangeIdle())
+            return false;
+        if (L->length() - v.s() < kRerouteMinDistance)
+            return false;
+        const auto& st = plan.steps();
+        for (int i = plan.startIndex; i < (int)st.size(); ++i) {
+            if (live_costs_.congested(st[i].lane))
+                return true;
+        }
+        return false;
+    }
 
-        return {startLane, route_tracker};
+    // Стоимость оставшегося маршрута от текущей полосы машины
+    double remainingCost(const Vehicle& v) const {
+        RoutePlan rest = v.route().plan();
+        const auto& st = rest.steps();
+        for (int i = std::max(0, rest.startIndex - 1); i < (int)st.size(); ++i) {
+            if (st[i].lane == v.laneId()) {
+                rest.startIndex = i;
+                break;
+            }
+        }
+        return pathfinder_.cost(rest);
+    }
+
+    void recordFrame() {
+        std::lock_guard<std::mutex> lk(recorder_mutex_);
+        if (!recorder_.active())
+            return;
+        recorder_.beginFrame(clock_.now);
+        for (const Vehicle& v : vehicles_) {
+            recorder_.add({static_cast<uint64_t>(v.id()), v.laneId(), v.s(),
+                           v.v(), v.a(), v.d(), v.pose()});
+        }
+        meso_.forEach([this](const MesoVehicle& mv) {
+            recorder_.add({mv.id, mv.lane, mv.s, mv.v, 0.0, 0.0,
+                           mv.pose(network_)});
+        });
+        recorder_.endFrame();
+    }
+
+    bool coasting(const Vehicle& v) const {
+        return multi_rate_ && v.coasting(clock_.now);
+    }
+
+    void updateSleep() {
+        lane_mover_front_.assign(network_.maxLaneId() + 1, -1e18);
+        for (const Vehicle& v : vehicles_) {
+            if (!v.asleep() && v.movedLastStep()) {
+                double& front = lane_mover_front_[v.laneId()];
+                front = std::max(front, v.s());
+            }
+        }
+        for (Vehicle& v : vehicles_) {
+            bool moverAhead = lane_mover_front_[v.laneId()] > v.s();
+            if (v.asleep()) {
+                if (moverAhead)
+                    v.wake();
+            } else if (!moverAhead) {
+                v.trySleep();
+            }
+        }
+    }
+
+    // Смена сигнала будит всех на полосах группы
+    void wakeSignalGroup(int groupId) {
+        for (Vehicle& v : vehicles_) {
+            const Lane* L = network_.getLane(v.laneId());
+            if (L && L->signalGroupId == groupId)
+                v.wake();
+        }
+    }
+
+    void dispatchTimer(const TimerEvent& e) {
+        if (e.tag == TimerTag::Arrival) {
+            demand_.onArrival(e, timers_, rngg);
+            return;
+        }
+        if (e.tag == TimerTag::PhaseExpiry) {
+            if (controller_.onPhaseExpiry(static_cast<int>(e.owner), e.cookie))
+                wakeSignalGroup(static_cast<int>(e.owner));
+            return;
+        }
+        // Машина могла уже уехать - тогда событие просто теряется
+        if (Vehicle* v = world_.getVehicle(static_cast<int>(e.owner)))
+            v->onTimer(e, world_);
+    }
+
+    double spawnWeight(LaneId lane) const {
+        auto it = spawnWeights_.find(lane);
+        return it == spawnWeights_.end() ? 1.0 : it->second;
+    }
+
+    // Спрос по умолчанию: 1 авт/с на всю сеть, доли въездов - веса
+    // направлений, выезд равновероятен среди достижимых без разворота
+    // на ту же дорогу
+    void rebuildDefaultDemand() {
+        double totalWeight = 0.0;
+        for (LaneId lane : spawn_lanes_)
+            totalWeight += spawnWeight(lane);
+
+        OdSlice slice;
+        for (LaneId origin : spawn_lanes_) {
+            const Lane* start = network_.getLane(origin);
+            std::vector<LaneId> reachable;
+            for (LaneId dest : exit_lanes_) {
+                const Lane* end = network_.getLane(dest);
+                if (end->start == start->end && end->end == start->start)
+                    continue;
+                if (pathfinder_.plan(origin, Goal::toLane(dest)).valid())
+                    reachable.push_back(dest);
+            }
+            for (LaneId dest : reachable) {
+                double rate = 3600.0 * spawnWeight(origin) / totalWeight /
+                              static_cast<double>(reachable.size());
+                slice.entries.push_back({origin, dest, rate});
+            }
+        }
+        std::vector<OdSlice> slices;
+        slices.push_back(std::move(slice));
+        demand_.setMatrix(std::move(slices), network_);
+        restartDemand();
+    }
+
+    void restartDemand() {
+        demand_.start(clock_.now, timers_, rngg);
+        warmRoutes();
+    }
+
+    // Маршруты всех пар спроса - в кэш заранее: появление машины берёт
+    // готовый план и не обращается к куче
+    void warmRoutes() {
+        demand_.forEachPair([this](LaneId origin, LaneId destination) {
+            (void)route_store_.intern(origin, Goal::toLane(destination),
+                                      pathfinder_);
+        });
+    }
+
+    void applyDemandChanges() {
+        std::lock_guard<std::mutex> lk(demand_mutex_);
+        demand_dirty_ = false;
+        demand_.setScale(demand_scale_);
+        if (demand_weights_changed_ && !custom_demand_)
+            rebuildDefaultDemand();
+        else
+            restartDemand();
+        demand_weights_changed_ = false;
+    }
+
+    // Класс новой машины по долям; при одном классе RNG не трогаем
+    const VehicleClass& pickVehicleClass() {
+        if (vehicle_classes_.size() == 1)
+            return vehicle_classes_.front();
+        double total = 0.0;
+        for (const VehicleClass& c : vehicle_classes_)
+            total += c.share;
+        double r = rngg.uniform(0.0, total);
+        for (const VehicleClass& c : vehicle_classes_) {
+            if (r < c.share)
+                return c;
+            r -= c.share;
+        }
+        return vehicle_classes_.back();
+    }
+
+    // Въезд ожидающих машин: начало полосы (kEntryClearance) свободно
+    // и от микро-, и от мезо-машин; за тик не больше одной на въезд.
+    // Хвосты въездных полос собираются одним проходом по машинам.
+    void spawnDemand() {
+        bool pending = false;
+        for (size_t o = 0; o < demand_.originCount(); ++o)
+            pending = pending || demand_.hasPending(o);
+        if (!pending)
+            return;
+
+        origin_tail_.assign(demand_.originCount(),
+                            std::numeric_limits<double>::infinity());
+        for (const Vehicle& v : vehicles_) {
+            int o = demand_.originOf(v.laneId());
+            if (o >= 0)
+                origin_tail_[o] = std::min(origin_tail_[o], v.s());
+        }
+
+        bool spawned = false;
+        for (size_t o = 0; o < demand_.originCount(); ++o) {
+            if (!demand_.hasPending(o) || origin_tail_[o] < kEntryClearance)
+                continue;
+            const LaneId lane = demand_.originLane(o);
+            if (meso_.hasVehicleWithin(lane, 0.0, kEntryClearance))
+                continue;
+            const LaneId dest = demand_.front(o).destination;
+            demand_.pop(o);
+
+            RouteTracker route(&network_);
+            if (!route.setGoalAndPlan(lane, Goal::toLane(dest), pathfinder_,
+                                      &route_store_))
+                continue;
+            vehicles_.emplace_back(Vehicle::randomVehicle(
+                next_vehicle_id_++, lane, std::move(route),
+                pickVehicleClass()));
+            const Vehicle& v = vehicles_.back();
+            metrics_.onSpawn(v.id(), clock_.now, v.route().plan(),
+                             v.params().desiredSpeed);
+            if (events_)
+                *events_ << "vh spawned " << v.id() << "\n";
+            spawned = true;
+        }
+        if (spawned)
+            syncVehicles();
     }
 
 };
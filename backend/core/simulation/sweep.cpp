@@ -0,0 +1,277 @@
+#include "sweep.h"
+#include "simulation.h"
+#include "worker_pool.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <sstream>
+
+namespace sim {
+
+namespace {
+
+// Ключи наборов в порядке осей сетки
+constexpr std::array<const char*, 9> kKeys = {
+    "red", "yellow", "green", "spawn", "n", "s", "e", "w", "adaptive"};
+constexpr std::array<const char*, 4> kDirections = {"n", "s", "e", "w"};
+
+bool isKey(const std::string& key) {
+    for (const char* k : kKeys)
+        if (key == k)
+            return true;
+    return false;
+}
+
+void setParam(SweepConfig& c, const std::string& key, double v) {
+    if (key == "red")
+        c.red = v;
+    else if (key == "yellow")
+        c.yellow = v;
+    else if (key == "green")
+        c.green = v;
+    else if (key == "spawn")
+        c.spawnInterval = v;
+    else if (key == "adaptive")
+        c.adaptive = v != 0.0;
+    for (size_t d = 0; d < kDirections.size(); ++d)
+        if (key == kDirections[d])
+            c.weights[d] = v;
+}
+
+uint64_t splitmix64(uint64_t x) {
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+MetricsSummary runOne(const SweepPlan& plan, const SweepConfig& c,
+                      uint64_t seed) {
+    auto sim = std::make_unique<Simulation>();
+    sim->setSeed(seed);
+    sim->setEventOutput(nullptr);
+    if (plan.gridRows > 0 && plan.gridCols > 0)
+        sim->initGridNetwork(plan.gridRows, plan.gridCols);
+    else
+        sim->initRoadNetwork();
+    if (!plan.odPath.empty())
+        sim->loadDemand(plan.odPath);
+    sim->setSignalProgram(c.red, c.yellow, c.green);
+    sim->setSpawnInterval(c.spawnInterval);
+    sim->setAdaptiveMode(c.adaptive);
+    for (size_t d = 0; d < kDirections.size(); ++d)
+        sim->setDirectionWeight(kDirections[d], c.weights[d]);
+
+    const long warmupSteps = std::lround(plan.warmup / plan.dt);
+    const long steps = std::lround(plan.duration / plan.dt);
+    for (long i = 0; i < steps; ++i) {
+        if (i == warmupSteps)
+            sim->restartKpiTotals();
+        sim->update(plan.dt);
+    }
+    return sim->kpiSummary();
+}
+
+struct MeanSd {
+    double mean{0.0}, sd{0.0};
+};
+
+template <class F>
+MeanSd meanSd(const std::vector<const SweepRun*>& runs, F value) {
+    MeanSd r;
+    if (runs.empty())
+        return r;
+    for (const SweepRun* run : runs)
+        r.mean += value(*run);
+    r.mean /= static_cast<double>(runs.size());
+    if (runs.size() < 2)
+        return r;
+    double ss = 0.0;
+    for (const SweepRun* run : runs)
+        ss += (value(*run) - r.mean) * (value(*run) - r.mean);
+    r.sd = std::sqrt(ss / static_cast<double>(runs.size() - 1));
+    return r;
+}
+
+} // namespace
+
+bool parseSweepPlan(std::istream& in, SweepPlan& out, std::string& error) {
+    out = SweepPlan{};
+    std::map<std::string, std::vector<double>> axes;
+    std::vector<std::vector<std::pair<std::string, double>>> cases;
+
+    std::string line;
+    int lineNo = 0;
+    while (std::getline(in, line)) {
+        ++lineNo;
+        auto hash = line.find('#');
+        if (hash != std::string::npos)
+            line.erase(hash);
+        std::istringstream iss(line);
+        std::string key;
+        if (!(iss >> key))
+            continue;
+        auto fail = [&](const std::string& what) {
+            error = "line " + std::to_string(lineNo) + ": " + what;
+            return false;
+        };
+
+        if (key == "weight" && !(iss >> key && key.size() == 1 && isKey(key)))
+            return fail("expected 'weight n|s|e|w values...'");
+        if (isKey(key)) {
+            std::vector<double>& values = axes[key];
+            values.clear();
+            double v;
+            while (iss >> v)
+                values.push_back(v);
+            if (values.empty() || !iss.eof())
+                return fail("expected numbers after '" + key + "'");
+        } else if (key == "case") {
+            cases.emplace_back();
+            std::string kv;
+            while (iss >> kv) {
+                auto eq = kv.find('=');
+                std::string k = kv.substr(0, eq);
+                if (eq == std::string::npos || !isKey(k))
+                    return fail("bad case item '" + kv + "'");
+                try {
+                    cases.back().emplace_back(k, std::stod(kv.substr(eq + 1)));
+                } catch (const std::exception&) {
+                    return fail("bad case item '" + kv + "'");
+                }
+            }
+        } else if (key == "replicates") {
+            if (!(iss >> out.replicates) || out.replicates < 1)
+                return fail("expected replicates >= 1");
+        } else if (key == "seed") {
+            if (!(iss >> out.seed))
+                return fail("expected seed");
+        } else if (key == "duration") {
+            if (!(iss >> out.duration) || out.duration <= 0.0)
+                return fail("expected duration > 0");
+        } else if (key == "warmup") {
+            if (!(iss >> out.warmup) || out.warmup < 0.0)
+                return fail("expected warmup >= 0");
+        } else if (key == "dt") {
+            if (!(iss >> out.dt) || out.dt <= 0.0)
+                return fail("expected dt > 0");
+        } else if (key == "grid") {
+            if (!(iss >> out.gridRows >> out.gridCols) || out.gridRows < 1 ||
+                out.gridCols < 1)
+                return fail("expected 'grid rows cols'");
+        } else if (key == "od") {
+            if (!(iss >> out.odPath))
+                return fail("expected od file");
+        } else {
+            return fail("unknown key '" + key + "'");
+        }
+    }
+    if (out.warmup >= out.duration) {
+        error = "warmup must be shorter than duration";
+        return false;
+    }
+
+    // Одиночные значения - общие для всех наборов, длинные - оси сетки
+    SweepConfig base;
+    std::vector<std::pair<std::string, const std::vector<double>*>> grid;
+    for (const char* k : kKeys) {
+        auto it = axes.find(k);
+        if (it == axes.end())
+            continue;
+        if (it->second.size() == 1)
+            setParam(base, k, it->second.front());
+        else
+            grid.emplace_back(k, &it->second);
+    }
+
+    if (!cases.empty()) {
+        if (!grid.empty()) {
+            error = "case lines cannot be combined with multi-valued keys";
+            return false;
+        }
+        for (const auto& items : cases) {
+            SweepConfig c = base;
+            for (const auto& [k, v] : items)
+                setParam(c, k, v);
+            out.configs.push_back(c);
+        }
+        return true;
+    }
+
+    std::vector<size_t> idx(grid.size(), 0);
+    while (true) {
+        SweepConfig c = base;
+        for (size_t a = 0; a < grid.size(); ++a)
+            setParam(c, grid[a].first, (*grid[a].second)[idx[a]]);
+        out.configs.push_back(c);
+
+        size_t a = grid.size();
+        while (a > 0 && ++idx[a - 1] == grid[a - 1].second->size())
+            idx[--a] = 0;
+        if (a == 0)
+            break;
+    }
+    return true;
+}
+
+bool runSweep(const SweepPlan& plan, int threads, std::vector<SweepRun>& out,
+              std::string& error) {
+    if (!plan.odPath.empty() && !std::ifstream(plan.odPath)) {
+        error = "cannot open od file " + plan.odPath;
+        return false;
+    }
+    const size_t reps = static_cast<size_t>(plan.replicates);
+    out.assign(plan.configs.size() * reps, {});
+
+    WorkerPool pool(std::max(1, threads));
+    pool.run(out.size(), [&](size_t job) {
+        SweepRun& run = out[job];
+        run.config = job / reps;
+        run.replicate = static_cast<int>(job % reps);
+        run.kpi = runOne(plan, plan.configs[run.config],
+                         splitmix64(plan.seed + run.replicate));
+    });
+    return true;
+}
+
+void writeSweepTable(std::ostream& out, const SweepPlan& plan,
+                     const std::vector<SweepRun>& runs) {
+    out << "config\tred\tyellow\tgreen\tspawn\tw_n\tw_s\tw_e\tw_w\tadaptive"
+           "\truns"
+           "\tthroughput\tthroughput_sd\tmean_delay\tmean_delay_sd"
+           "\tp95_delay\tmean_travel\tstops\tmax_queue\tmax_queue_sd\n";
+
+    std::vector<std::vector<const SweepRun*>> byConfig(plan.configs.size());
+    for (const SweepRun& run : runs)
+        byConfig[run.config].push_back(&run);
+
+    for (size_t i = 0; i < plan.configs.size(); ++i) {
+        const SweepConfig& c = plan.configs[i];
+        const auto& rs = byConfig[i];
+        auto throughput =
+            meanSd(rs, [](const SweepRun& r) { return r.kpi.throughput; });
+        auto delay =
+            meanSd(rs, [](const SweepRun& r) { return r.kpi.meanDelay; });
+        auto p95 = meanSd(rs, [](const SweepRun& r) { return r.kpi.p95Delay; });
+        auto travel =
+            meanSd(rs, [](const SweepRun& r) { return r.kpi.meanTravel; });
+        auto stops =
+            meanSd(rs, [](const SweepRun& r) { return r.kpi.meanStops; });
+        auto queue = meanSd(rs, [](const SweepRun& r) {
+            return static_cast<double>(r.kpi.maxQueue);
+        });
+        out << i << "\t" << c.red << "\t" << c.yellow << "\t" << c.green
+            << "\t" << c.spawnInterval;
+        for (double w : c.weights)
+            out << "\t" << w;
+        out << "\t" << (c.adaptive ? 1 : 0) << "\t" << rs.size() << "\t" << throughput.mean << "\t"
+            << throughput.sd << "\t" << delay.mean << "\t" << delay.sd << "\t"
+            << p95.mean << "\t" << travel.mean << "\t" << stops.mean << "\t"
+            << queue.mean << "\t" << queue.sd << "\n";
+    }
+    out.flush();
+}
+
+} // namespace sim
@@ -0,0 +1,63 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "metrics.h"
+
+namespace sim {
+
+// Параметры одного прогона: программа светофоров (как change_phases),
+// интервал появления машин (cars_spawn_time, как density) и веса
+// направлений n, s, e, w (setDirectionWeight, только демо-перекрёсток);
+// adaptive - светофоры с прогнозом (SignalPlanner) вместо фиксированных
+struct SweepConfig {
+    double red{30.0};
+    double yellow{3.0};
+    double green{20.0};
+    double spawnInterval{1.0};
+    std::array<double, 4> weights{1.0, 1.0, 1.0, 1.0};
+    bool adaptive{false};
+};
+
+// План перебора. Файл - строки "ключ значения...", '#' - комментарий:
+//   red|yellow|green|spawn v...    несколько значений - ось сетки
+//   adaptive 0|1 ...               то же, 1 - адаптивные светофоры
+//   weight n|s|e|w v...            то же для веса направления
+//   case key=v ...                 явный набор (ключи те же, n= - вес);
+//                                  с осями сетки не сочетается
+//   replicates N, seed S, duration T, warmup T, dt T, grid R C, od FILE
+// Без case - все сочетания осей (последняя ось меняется быстрее).
+struct SweepPlan {
+    std::vector<SweepConfig> configs;
+    int replicates{1};
+    uint64_t seed{1};
+    double duration{600.0}; // с модельного времени, включая разгон
+    double warmup{120.0};   // показатели считаются после разгона
+    double dt{1.0 / 40.0};
+    int gridRows{0}, gridCols{0}; // 0 - демо-перекрёсток
+    std::string odPath;
+};
+
+bool parseSweepPlan(std::istream& in, SweepPlan& out, std::string& error);
+
+struct SweepRun {
+    size_t config{0};
+    int replicate{0};
+    MetricsSummary kpi;
+};
+
+// Все прогоны (набор x повтор), каждый - своя Simulation без вывода
+// в одном потоке, по прогону на поток. Повтор r во всех наборах идёт
+// с одним зерном, так что наборы сравниваются на одном потоке машин.
+// Результат не зависит от числа потоков. false - не загрузился od.
+bool runSweep(const SweepPlan& plan, int threads, std::vector<SweepRun>& out,
+              std::string& error);
+
+// Таблица через табуляцию: строка на набор, среднее и СКО по повторам
+void writeSweepTable(std::ostream& out, const SweepPlan& plan,
+                     const std::vector<SweepRun>& runs);
+
+} // namespace sim
@@ -0,0 +1,287 @@
+#include "trajectory_reader.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <unordered_map>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef ITS_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+namespace sim {
+
+namespace {
+
+using namespace trajectory_format;
+
+template <typename T>
+T readFixed(const uint8_t* p) {
+    T value;
+    std::memcpy(&value, p, sizeof(T));
+    return value;
+}
+
+// Читает varint, на обрыве данных возвращает false
+bool getVarint(const uint8_t*& p, const uint8_t* end, uint64_t& x) {
+    x = 0;
+    for (int shift = 0; p < end && shift < 64; shift += 7) {
+        uint8_t byte = *p++;
+        x |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+            return true;
+    }
+    return false;
+}
+
+int64_t unzigzag(uint64_t x) {
+    return static_cast<int64_t>(x >> 1) ^ -static_cast<int64_t>(x & 1);
+}
+
+// Состояние машины внутри блока, обратное кодированию в записи
+struct Prev {
+    int64_t lane{0};
+    int64_t s{0}, ds{0};
+    int64_t v{0};
+    int64_t a{0};
+    int64_t d{0};
+    int64_t x{0}, dx{0};
+    int64_t y{0}, dy{0};
+    int64_t theta{0};
+};
+
+int64_t undelta2(int64_t delta2, int64_t& prev, int64_t& prevDelta) {
+    prevDelta += delta2;
+    prev += prevDelta;
+    return prev;
+}
+
+constexpr size_t kHeaderSize = sizeof(kMagic) + sizeof(uint32_t) +
+                               4 * sizeof(double);
+constexpr size_t kFooterSize = sizeof(uint32_t) + sizeof(uint64_t) +
+                               sizeof(kIndexMagic);
+constexpr size_t kIndexEntrySize = 2 * sizeof(double) + sizeof(uint64_t) +
+                                   sizeof(uint32_t);
+constexpr size_t kChunkHeaderSize = 1 + 2 * sizeof(uint32_t);
+constexpr int kColumns = 9;
+
+} // namespace
+
+TrajectoryReader::~TrajectoryReader() {
+    close();
+}
+
+bool TrajectoryReader::open(const std::string& path) {
+    close();
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "[playback] cannot open " << path << std::endl;
+        return false;
+    }
+    struct stat st {};
+    if (::fstat(fd, &st) != 0 ||
+        static_cast<size_t>(st.st_size) < kHeaderSize + kFooterSize) {
+        ::close(fd);
+        std::cerr << "[playback] " << path << " is not a trajectory file"
+                  << std::endl;
+        return false;
+    }
+    size_ = static_cast<size_t>(st.st_size);
+    void* map = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED) {
+        size_ = 0;
+        std::cerr << "[playback] cannot map " << path << std::endl;
+        return false;
+    }
+    data_ = static_cast<const uint8_t*>(map);
+
+    // Заголовок и индекс; файл без индекса (запись оборвалась) не читаем
+    const uint8_t* footer = data_ + size_ - kFooterSize;
+    const auto count = readFixed<uint32_t>(footer);
+    const auto indexOffset = readFixed<uint64_t>(footer + sizeof(uint32_t));
+    bool valid =
+        std::memcmp(data_, kMagic, sizeof(kMagic)) == 0 &&
+        readFixed<uint32_t>(data_ + sizeof(kMagic)) == kVersion &&
+        std::memcmp(footer + kFooterSize - sizeof(kIndexMagic), kIndexMagic,
+                    sizeof(kIndexMagic)) == 0 &&
+        indexOffset >= kHeaderSize &&
+        indexOffset + count * kIndexEntrySize == size_ - kFooterSize;
+    if (!valid) {
+        std::cerr << "[playback] " << path
+                  << " has no valid header or index" << std::endl;
+        close();
+        return false;
+    }
+
+    index_.resize(count);
+    for (uint32_t i = 0; i < count; ++i) {
+        const uint8_t* p = data_ + indexOffset + i * kIndexEntrySize;
+        IndexEntry& e = index_[i];
+        e.t0 = readFixed<double>(p);
+        e.t1 = readFixed<double>(p + sizeof(double));
+        e.offset = readFixed<uint64_t>(p + 2 * sizeof(double));
+        e.frames = readFixed<uint32_t>(p + 2 * sizeof(double) +
+                                       sizeof(uint64_t));
+    }
+    if (index_.empty())
+        return true;
+
+    // Корзина не шире самого короткого блока: внутри неё не больше
+    // одной границы блоков
+    bucket_width_ = 1.0;
+    for (size_t i = 0; i + 1 < index_.size(); ++i)
+        bucket_width_ = std::min(bucket_width_, index_[i + 1].t0 - index_[i].t0);
+    bucket_width_ = std::max(bucket_width_, 1e-3);
+
+    const double span = endTime() - startTime();
+    const auto nBuckets = static_cast<size_t>(span / bucket_width_) + 1;
+    buckets_.resize(nBuckets);
+    uint32_t chunk = 0;
+    for (size_t b = 0; b < nBuckets; ++b) {
+        double t = startTime() + static_cast<double>(b) * bucket_width_;
+        while (chunk + 1 < index_.size() && index_[chunk + 1].t0 <= t)
+            ++chunk;
+        buckets_[b] = chunk;
+    }
+    return true;
+}
+
+void TrajectoryReader::close() {
+    if (data_)
+        ::munmap(const_cast<uint8_t*>(data_), size_);
+    data_ = nullptr;
+    size_ = 0;
+    index_.clear();
+    buckets_.clear();
+    decoded_ = -1;
+    times_.clear();
+    frame_start_.clear();
+    rows_.clear();
+}
+
+double TrajectoryReader::startTime() const {
+    return index_.empty() ? 0.0 : index_.front().t0;
+}
+
+double TrajectoryReader::endTime() const {
+    return index_.empty() ? 0.0 : index_.back().t1;
+}
+
+size_t TrajectoryReader::chunkFor(double t) const {
+    if (t <= startTime())
+        return 0;
+    auto b = static_cast<size_t>((t - startTime()) / bucket_width_);
+    if (b >= buckets_.size())
+        return index_.size() - 1;
+    size_t chunk = buckets_[b];
+    if (chunk + 1 < index_.size() && index_[chunk + 1].t0 <= t)
+        ++chunk;
+    return chunk;
+}
+
+TrajectoryFrame TrajectoryReader::frameAt(double t) {
+    if (index_.empty())
+        return {};
+    size_t chunk = chunkFor(t);
+    if (static_cast<int>(chunk) != decoded_ && !decode(chunk))
+        return {};
+
+    auto it = std::upper_bound(times_.begin(), times_.end(), t);
+    size_t f = it == times_.begin()
+                   ? 0
+                   : static_cast<size_t>(it - times_.begin()) - 1;
+    return {times_[f], rows_.data() + frame_start_[f],
+            frame_start_[f + 1] - frame_start_[f]};
+}
+
+bool TrajectoryReader::decode(size_t chunk) {
+    decoded_ = -1;
+    const IndexEntry& e = index_[chunk];
+    if (e.offset + kChunkHeaderSize > size_)
+        return false;
+    const uint8_t* p = data_ + e.offset;
+    const auto codec = static_cast<Codec>(p[0]);
+    const auto rawSize = readFixed<uint32_t>(p + 1);
+    const auto storedSize = readFixed<uint32_t>(p + 1 + sizeof(uint32_t));
+    p += kChunkHeaderSize;
+    if (e.offset + kChunkHeaderSize + storedSize > size_)
+        return false;
+
+    const uint8_t* raw = p;
+    if (codec == Codec::Zlib) {
+#ifdef ITS_HAVE_ZLIB
+        unpacked_.resize(rawSize);
+        uLongf size = rawSize;
+        if (uncompress(unpacked_.data(), &size, p, storedSize) != Z_OK ||
+            size != rawSize)
+            return false;
+        raw = unpacked_.data();
+#else
+        std::cerr << "[playback] built without zlib, cannot read chunk"
+                  << std::endl;
+        return false;
+#endif
+    } else if (codec != Codec::Raw || rawSize != storedSize) {
+        return false;
+    }
+    const uint8_t* end = raw + rawSize;
+
+    uint64_t frames = 0;
+    if (!getVarint(raw, end, frames) || frames == 0)
+        return false;
+    times_.resize(frames);
+    frame_start_.resize(frames + 1);
+    frame_start_[0] = 0;
+    int64_t time = 0;
+    for (uint64_t f = 0; f < frames; ++f) {
+        uint64_t dt = 0, count = 0;
+        if (!getVarint(raw, end, dt) || !getVarint(raw, end, count))
+            return false;
+        time += unzigzag(dt);
+        times_[f] = static_cast<double>(time) * kTimeStep;
+        frame_start_[f + 1] = frame_start_[f] + count;
+    }
+
+    const size_t total = frame_start_[frames];
+    std::array<std::vector<int64_t>, kColumns> columns;
+    for (auto& c : columns) {
+        c.resize(total);
+        for (size_t i = 0; i < total; ++i) {
+            uint64_t x = 0;
+            if (!getVarint(raw, end, x))
+                return false;
+            c[i] = unzigzag(x);
+        }
+    }
+
+    rows_.resize(total);
+    std::unordered_map<uint64_t, Prev> prev;
+    for (uint64_t f = 0; f < frames; ++f) {
+        int64_t id = 0;
+        for (size_t i = frame_start_[f]; i < frame_start_[f + 1]; ++i) {
+            id += columns[0][i];
+            Prev& q = prev[static_cast<uint64_t>(id)];
+            TrajectoryRow& r = rows_[i];
+            r.id = static_cast<uint64_t>(id);
+            r.lane = static_cast<LaneId>(q.lane += columns[1][i]);
+            r.s = undelta2(columns[2][i], q.s, q.ds) * kPosStep;
+            r.v = (q.v += columns[3][i]) * kSpeedStep;
+            r.a = (q.a += columns[4][i]) * kSpeedStep;
+            r.d = (q.d += columns[5][i]) * kPosStep;
+            r.pose.x = undelta2(columns[6][i], q.x, q.dx) * kPosStep;
+            r.pose.y = undelta2(columns[7][i], q.y, q.dy) * kPosStep;
+            r.pose.theta = (q.theta += columns[8][i]) * kAngleStep;
+        }
+    }
+
+    decoded_ = static_cast<int>(chunk);
+    return true;
+}
+
+} // namespace sim
@@ -0,0 +1,68 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "trajectory_recorder.h"
+
+namespace sim {
+
+// Один тик записи
+struct TrajectoryFrame {
+    double time{0.0};
+    const TrajectoryRow* rows{nullptr};
+    size_t count{0};
+};
+
+// Чтение файла TrajectoryRecorder. Файл отображается в память,
+// по индексу строится таблица корзин времени шириной не больше самого
+// короткого блока, так что блок для любого момента находится за O(1).
+// Декодированный блок кэшируется: последовательное чтение разбирает
+// каждый блок один раз.
+class TrajectoryReader {
+public:
+    TrajectoryReader() = default;
+    ~TrajectoryReader();
+
+    TrajectoryReader(const TrajectoryReader&) = delete;
+    TrajectoryReader& operator=(const TrajectoryReader&) = delete;
+
+    bool open(const std::string& path);
+
+    void close();
+
+    [[nodiscard]] bool empty() const { return index_.empty(); }
+    [[nodiscard]] double startTime() const;
+    [[nodiscard]] double endTime() const;
+
+    // Последний записанный тик с временем не больше t (до начала записи -
+    // первый тик). Указатель на строки живёт до следующего вызова.
+    [[nodiscard]] TrajectoryFrame frameAt(double t);
+
+private:
+    struct IndexEntry {
+        double t0;
+        double t1;
+        uint64_t offset;
+        uint32_t frames;
+    };
+
+    const uint8_t* data_{nullptr};
+    size_t size_{0};
+
+    std::vector<IndexEntry> index_;
+    std::vector<uint32_t> buckets_; // корзина времени -> первый её блок
+    double bucket_width_{1.0};
+
+    // Разобранный блок
+    int decoded_{-1};
+    std::vector<double> times_;
+    std::vector<size_t> frame_start_; // times_.size() + 1 границ
+    std::vector<TrajectoryRow> rows_;
+    std::vector<uint8_t> unpacked_;
+
+    size_t chunkFor(double t) const;
+    bool decode(size_t chunk);
+};
+
+} // namespace sim
@@ -0,0 +1,272 @@
+#include "trajectory_recorder.h"
+#include <array>
+#include <cmath>
+#include <iostream>
+#include <unordered_map>
+#ifdef ITS_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+namespace sim {
+
+namespace {
+
+using namespace trajectory_format;
+
+template <typename T>
+void writeFixed(std::ofstream& out, T value) {
+    out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+void putVarint(std::vector<uint8_t>& out, uint64_t x) {
+    while (x >= 0x80) {
+        out.push_back(static_cast<uint8_t>(x) | 0x80);
+        x >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(x));
+}
+
+uint64_t zigzag(int64_t x) {
+    return (static_cast<uint64_t>(x) << 1) ^ static_cast<uint64_t>(x >> 63);
+}
+
+int64_t quantize(double x, double step) {
+    return static_cast<int64_t>(std::llround(x / step));
+}
+
+// Столбцы в порядке записи
+enum Column {
+    ColId, ColLane, ColS, ColV, ColA, ColD, ColX, ColY, ColTheta, kColumns
+};
+
+// Прошлый тик машины внутри блока, уже квантованный
+struct Prev {
+    int64_t lane{0};
+    int64_t s{0}, ds{0};
+    int64_t v{0};
+    int64_t a{0};
+    int64_t d{0};
+    int64_t x{0}, dx{0};
+    int64_t y{0}, dy{0};
+    int64_t theta{0};
+};
+
+// Вторая разность: дельта к предсказанию prev + prevDelta
+int64_t delta2(int64_t value, int64_t& prev, int64_t& prevDelta) {
+    int64_t delta = value - prev;
+    int64_t out = delta - prevDelta;
+    prev = value;
+    prevDelta = delta;
+    return out;
+}
+
+int64_t delta1(int64_t value, int64_t& prev) {
+    int64_t out = value - prev;
+    prev = value;
+    return out;
+}
+
+} // namespace
+
+TrajectoryRecorder::~TrajectoryRecorder() {
+    stop();
+}
+
+bool TrajectoryRecorder::start(const std::string& path, bool compress) {
+    stop();
+
+    out_.open(path, std::ios::binary | std::ios::trunc);
+    if (!out_) {
+        std::cerr << "[record] cannot open " << path << std::endl;
+        return false;
+    }
+#ifdef ITS_HAVE_ZLIB
+    compress_ = compress;
+#else
+    compress_ = false;
+    if (compress)
+        std::cerr << "[record] built without zlib, writing raw" << std::endl;
+#endif
+
+    out_.write(kMagic, sizeof(kMagic));
+    writeFixed<uint32_t>(out_, kVersion);
+    writeFixed<double>(out_, kTimeStep);
+    writeFixed<double>(out_, kPosStep);
+    writeFixed<double>(out_, kSpeedStep);
+    writeFixed<double>(out_, kAngleStep);
+
+    path_ = path;
+    index_.clear();
+    frames_written_ = 0;
+    bytes_written_ = static_cast<uint64_t>(out_.tellp());
+    stopping_ = false;
+    current_ = takeSpare();
+    active_ = true;
+    writer_ = std::thread(&TrajectoryRecorder::writerLoop, this);
+    return true;
+}
+
+void TrajectoryRecorder::stop() {
+    if (!active_)
+        return;
+    if (!current_->times.empty())
+        submit();
+    {
+        std::lock_guard<std::mutex> lk(m_);
+        stopping_ = true;
+    }
+    cv_.notify_all();
+    writer_.join();
+    active_ = false;
+
+    // Индекс блоков в конце файла: читатель ищет тик без сканирования
+    const auto indexOffset = static_cast<uint64_t>(out_.tellp());
+    for (const IndexEntry& e : index_) {
+        writeFixed<double>(out_, e.t0);
+        writeFixed<double>(out_, e.t1);
+        writeFixed<uint64_t>(out_, e.offset);
+        writeFixed<uint32_t>(out_, e.frames);
+    }
+    writeFixed<uint32_t>(out_, static_cast<uint32_t>(index_.size()));
+    writeFixed<uint64_t>(out_, indexOffset);
+    out_.write(kIndexMagic, sizeof(kIndexMagic));
+    bytes_written_ = static_cast<uint64_t>(out_.tellp());
+    out_.close();
+
+    current_->clear();
+    spare_.push_back(std::move(current_));
+}
+
+void TrajectoryRecorder::beginFrame(double t) {
+    current_->times.push_back(t);
+    frame_start_ = current_->rows.size();
+}
+
+void TrajectoryRecorder::endFrame() {
+    current_->counts.push_back(
+        static_cast<uint32_t>(current_->rows.size() - frame_start_));
+    if (current_->times.size() >= kMaxFramesPerChunk ||
+        current_->rows.size() >= kMaxRowsPerChunk)
+        submit();
+}
+
+std::unique_ptr<TrajectoryRecorder::Chunk> TrajectoryRecorder::takeSpare() {
+    std::unique_lock<std::mutex> lk(m_);
+    if (spare_.empty())
+        return std::make_unique<Chunk>();
+    auto chunk = std::move(spare_.back());
+    spare_.pop_back();
+    return chunk;
+}
+
+void TrajectoryRecorder::submit() {
+    {
+        std::unique_lock<std::mutex> lk(m_);
+        cv_.wait(lk, [this] { return queue_.size() < kMaxQueued; });
+        queue_.push_back(std::move(current_));
+    }
+    cv_.notify_all();
+    current_ = takeSpare();
+}
+
+void TrajectoryRecorder::writerLoop() {
+    while (true) {
+        std::unique_ptr<Chunk> chunk;
+        {
+            std::unique_lock<std::mutex> lk(m_);
+            cv_.wait(lk, [this] { return stopping_ || !queue_.empty(); });
+            if (queue_.empty())
+                return;
+            chunk = std::move(queue_.front());
+            queue_.pop_front();
+        }
+        cv_.notify_all();
+
+        writeChunk(*chunk);
+        chunk->clear();
+
+        std::lock_guard<std::mutex> lk(m_);
+        spare_.push_back(std::move(chunk));
+    }
+}
+
+void TrajectoryRecorder::writeChunk(const Chunk& chunk) {
+    encode(chunk);
+
+    Codec codec = Codec::Raw;
+    const std::vector<uint8_t>* data = &raw_;
+#ifdef ITS_HAVE_ZLIB
+    if (compress_) {
+        uLongf size = compressBound(static_cast<uLong>(raw_.size()));
+        packed_.resize(size);
+        if (compress2(packed_.data(), &size, raw_.data(),
+                      static_cast<uLong>(raw_.size()), Z_BEST_SPEED) == Z_OK) {
+            packed_.resize(size);
+            codec = Codec::Zlib;
+            data = &packed_;
+        }
+    }
+#endif
+
+    IndexEntry entry;
+    entry.t0 = chunk.times.front();
+    entry.t1 = chunk.times.back();
+    entry.offset = static_cast<uint64_t>(out_.tellp());
+    entry.frames = static_cast<uint32_t>(chunk.times.size());
+    index_.push_back(entry);
+
+    writeFixed<uint8_t>(out_, static_cast<uint8_t>(codec));
+    writeFixed<uint32_t>(out_, static_cast<uint32_t>(raw_.size()));
+    writeFixed<uint32_t>(out_, static_cast<uint32_t>(data->size()));
+    out_.write(reinterpret_cast<const char*>(data->data()),
+               static_cast<std::streamsize>(data->size()));
+
+    frames_written_ += entry.frames;
+    bytes_written_ = static_cast<uint64_t>(out_.tellp());
+}
+
+void TrajectoryRecorder::encode(const Chunk& chunk) {
+    raw_.clear();
+    putVarint(raw_, chunk.times.size());
+    int64_t prevTime = 0;
+    for (size_t f = 0; f < chunk.times.size(); ++f) {
+        putVarint(raw_, zigzag(delta1(quantize(chunk.times[f], kTimeStep),
+                                      prevTime)));
+        putVarint(raw_, chunk.counts[f]);
+    }
+
+    static thread_local std::array<std::vector<int64_t>, kColumns> columns;
+    static thread_local std::unordered_map<uint64_t, Prev> prev;
+    for (auto& c : columns)
+        c.clear();
+    prev.clear();
+
+    size_t row = 0;
+    for (uint32_t count : chunk.counts) {
+        int64_t prevId = 0;
+        for (uint32_t i = 0; i < count; ++i, ++row) {
+            const TrajectoryRow& r = chunk.rows[row];
+            Prev& p = prev[r.id];
+            const auto id = static_cast<int64_t>(r.id);
+            columns[ColId].push_back(delta1(id, prevId));
+            columns[ColLane].push_back(delta1(r.lane, p.lane));
+            columns[ColS].push_back(delta2(quantize(r.s, kPosStep), p.s, p.ds));
+            columns[ColV].push_back(delta1(quantize(r.v, kSpeedStep), p.v));
+            columns[ColA].push_back(delta1(quantize(r.a, kSpeedStep), p.a));
+            columns[ColD].push_back(delta1(quantize(r.d, kPosStep), p.d));
+            columns[ColX].push_back(
+                delta2(quantize(r.pose.x, kPosStep), p.x, p.dx));
+            columns[ColY].push_back(
+                delta2(quantize(r.pose.y, kPosStep), p.y, p.dy));
+            columns[ColTheta].push_back(
+                delta1(quantize(r.pose.theta, kAngleStep), p.theta));
+        }
+    }
+
+    for (const auto& c : columns) {
+        for (int64_t x : c)
+            putVarint(raw_, zigzag(x));
+    }
+}
+
+} // namespace sim
@@ -0,0 +1,130 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../models/road_network.h"
+
+namespace sim {
+
+// Состояние машины на одном тике
+struct TrajectoryRow {
+    uint64_t id;
+    LaneId lane;
+    double s;
+    double v;
+    double a;
+    double d;
+    Pose pose;
+};
+
+// Формат файла траекторий (все числа little-endian):
+//   заголовок: kMagic, u32 версия, f64 шаги квантования
+//   блоки: u8 кодек, u32 размер данных, u32 размер в файле, данные
+//   индекс: на блок f64 t0, f64 t1, u64 смещение, u32 тиков;
+//           затем u32 число блоков, u64 смещение индекса, kIndexMagic
+// Данные блока: varint тиков, на тик zigzag-дельта времени (мкс)
+// и число строк; затем столбцы id, lane, s, v, a, d, x, y, theta по
+// всем строкам блока. Значения квантуются, id - дельта к предыдущей
+// строке тика, остальное - дельта к прошлому тику той же машины
+// (s, x, y - вторая разность). Блок декодируется без соседних.
+namespace trajectory_format {
+inline constexpr char kMagic[8] = {'I', 'T', 'S', 'T', 'R', 'A', 'J', '\0'};
+inline constexpr char kIndexMagic[8] = {'I', 'T', 'S', 'I', 'N', 'D', 'X', '\0'};
+inline constexpr uint32_t kVersion = 1;
+
+inline constexpr double kTimeStep = 1e-6;
+inline constexpr double kPosStep = 1e-3;   // s, d, x, y: мм
+inline constexpr double kSpeedStep = 1e-3; // v, a
+inline constexpr double kAngleStep = 1e-4; // theta, рад
+
+enum class Codec : uint8_t { Raw = 0, Zlib = 1 };
+} // namespace trajectory_format
+
+// Запись траекторий в столбцовый файл. Тики копятся в блок в памяти
+// симуляции, готовый блок уходит фоновому потоку, который кодирует,
+// сжимает и пишет его. Очередь ограничена: если диск не успевает,
+// endFrame() ждёт, память не растёт. Буферы блоков переиспользуются.
+class TrajectoryRecorder {
+public:
+    TrajectoryRecorder() = default;
+    ~TrajectoryRecorder();
+
+    TrajectoryRecorder(const TrajectoryRecorder&) = delete;
+    TrajectoryRecorder& operator=(const TrajectoryRecorder&) = delete;
+
+    // compress без zlib в сборке игнорируется (блоки пишутся как есть)
+    bool start(const std::string& path, bool compress);
+
+    void stop();
+
+    [[nodiscard]] bool active() const { return active_; }
+
+    // Строки одного тика подаются между beginFrame и endFrame
+    void beginFrame(double t);
+    void add(const TrajectoryRow& row) { current_->rows.push_back(row); }
+    void endFrame();
+
+    [[nodiscard]] uint64_t framesWritten() const { return frames_written_; }
+    [[nodiscard]] uint64_t bytesWritten() const { return bytes_written_; }
+
+private:
+    struct Chunk {
+        std::vector<double> times;
+        std::vector<uint32_t> counts;
+        std::vector<TrajectoryRow> rows;
+
+        void clear() {
+            times.clear();
+            counts.clear();
+            rows.clear();
+        }
+    };
+
+    struct IndexEntry {
+        double t0;
+        double t1;
+        uint64_t offset;
+        uint32_t frames;
+    };
+
+    static constexpr size_t kMaxFramesPerChunk = 256;
+    static constexpr size_t kMaxRowsPerChunk = 1 << 16;
+    static constexpr size_t kMaxQueued = 4;
+
+    bool active_{false};
+    bool compress_{false};
+    std::string path_;
+    std::ofstream out_;
+
+    std::unique_ptr<Chunk> current_;
+    size_t frame_start_{0};
+
+    // Общее с фоновым потоком
+    std::mutex m_;
+    std::condition_variable cv_;
+    std::deque<std::unique_ptr<Chunk>> queue_;
+    std::vector<std::unique_ptr<Chunk>> spare_;
+    bool stopping_{false};
+    std::thread writer_;
+
+    // Только фоновый поток
+    std::vector<IndexEntry> index_;
+    std::vector<uint8_t> raw_;
+    std::vector<uint8_t> packed_;
+    uint64_t frames_written_{0};
+    uint64_t bytes_written_{0};
+
+    void submit();
+    void writerLoop();
+    void writeChunk(const Chunk& chunk);
+    void encode(const Chunk& chunk);
+    std::unique_ptr<Chunk> takeSpare();
+};
+
+} // namespace sim
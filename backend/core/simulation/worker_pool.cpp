@@ -0,0 +1,71 @@
+#include "worker_pool.h"
+
+namespace sim {
+
+WorkerPool::WorkerPool(int threads) {
+    for (int i = 1; i < threads; ++i)
+        workers_.emplace_back([this] { workerLoop(); });
+}
+
+WorkerPool::~WorkerPool() {
+    {
+        std::lock_guard<std::mutex> lock(m_);
+        stop_ = true;
+    }
+    start_.notify_all();
+    for (auto& t : workers_)
+        t.join();
+}
+
+void WorkerPool::drain() {
+    const auto& fn = *job_;
+    for (size_t i = next_.fetch_add(1); i < jobSize_; i = next_.fetch_add(1))
+        fn(i);
+}
+
+void WorkerPool::run(size_t n, const std::function<void(size_t)>& fn) {
+    if (n == 0)
+        return;
+    if (workers_.empty() || n == 1) {
+        for (size_t i = 0; i < n; ++i)
+            fn(i);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_);
+        job_ = &fn;
+        jobSize_ = n;
+        next_.store(0);
+        busy_ = workers_.size();
+        ++generation_;
+    }
+    start_.notify_all();
+
+    drain();
+
+    std::unique_lock<std::mutex> lock(m_);
+    done_.wait(lock, [this] { return busy_ == 0; });
+    job_ = nullptr;
+}
+
+void WorkerPool::workerLoop() {
+    uint64_t seen = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(m_);
+            start_.wait(lock, [&] { return stop_ || generation_ != seen; });
+            if (stop_)
+                return;
+            seen = generation_;
+        }
+
+        drain();
+
+        std::lock_guard<std::mutex> lock(m_);
+        if (--busy_ == 0)
+            done_.notify_one();
+    }
+}
+
+} // namespace sim
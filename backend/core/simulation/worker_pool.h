@@ -0,0 +1,47 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace sim {
+
+// Постоянные рабочие потоки для параллельных проходов тика.
+// run() раздаёт задачи [0, n) через общий счётчик, вызывающий поток
+// работает наравне с остальными и возвращается, когда всё сделано.
+class WorkerPool {
+public:
+    explicit WorkerPool(int threads = 1);
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    void run(size_t n, const std::function<void(size_t)>& fn);
+
+    [[nodiscard]] int threads() const {
+        return static_cast<int>(workers_.size()) + 1;
+    }
+
+private:
+    std::vector<std::thread> workers_;
+    std::mutex m_;
+    std::condition_variable start_;
+    std::condition_variable done_;
+
+    const std::function<void(size_t)>* job_{nullptr};
+    size_t jobSize_{0};
+    std::atomic<size_t> next_{0};
+    size_t busy_{0};        // рабочие, ещё не закончившие текущую задачу
+    uint64_t generation_{0};
+    bool stop_{false};
+
+    void workerLoop();
+    void drain();
+};
+
+} // namespace sim
@@ -1,4 +1,7 @@
 #include "core/simulation/simulation.h"
+#include "core/simulation/frame_pacer.h"
+#include "core/simulation/lane_frames.h"
+#include "core/simulation/trajectory_reader.h"
 #include <iostream>
 #include <thread>
 #include <chrono>
@@ -6,6 +9,8 @@
 #include <string>
 #include <sstream>
 #include <cmath>
+#include <algorithm>
+#include <vector>
 #include <csignal>
 
 using clock_tt = std::chrono::steady_clock;
@@ -14,10 +19,17 @@ using seconds_d = std::chrono::duration<double>;
 std::atomic<bool> running{true};
 std::atomic<bool> paused{false};
 std::atomic<double> time_scale{1.0};
-std::atomic<double> cars_spawn_time{1.0};
+std::atomic<double> seek_request{-1.0};
+// Кадры в координатах полосы (frames lane) вместо "vh move x y theta";
+// геометрия сети уходит строкой "geom" при включении
+std::atomic<bool> lane_frames{false};
+std::atomic<bool> geometry_due{false};
+// "pace" - вывести статистику опозданий кадров в stderr
+std::atomic<bool> pace_due{false};
+
+bool playback_mode = false;
 
 sim::Simulation simulation;
-double last_spawn = 0.0f;
 double last_time_print = 0.0f;
 
 void on_signal(int) {
@@ -32,16 +44,19 @@ void inputHandleLoop() {
                 running = false;
                 break;
             }
-            if (line == "reset") {
+            if (line == "reset" && playback_mode) {
+                seek_request = 0.0;
+            } else if (line == "reset") {
                 simulation.reset();
                 last_time_print = 0;
-                last_spawn = 0;
             } else if (line == "pause") {
                 paused = true;
             } else if (line == "resume") {
                 paused = false;
             } else if (line == "toggle") {
                 paused = !paused.load();
+            } else if (line == "pace") {
+                pace_due = true;
             } else if (line.rfind("speed", 0) == 0) {
                 std::istringstream iss(line);
                 std::string cmd;
@@ -66,7 +81,7 @@ void inputHandleLoop() {
                     if (k > 5.0) {
                         k = 5;
                     }
-                    cars_spawn_time = k;
+                    simulation.setSpawnInterval(k);
                 }
             } else if (line.rfind("change_phases", 0) == 0) {
                 std::istringstream iss(line);
@@ -82,6 +97,90 @@ void inputHandleLoop() {
                 if (iss >> cmd >> state) {
                     simulation.setAdaptiveMode(state);
                 }
+            } else if (line.rfind("hybrid", 0) == 0) {
+                std::istringstream iss(line);
+                std::string cmd;
+                bool state;
+                if (iss >> cmd >> state) {
+                    simulation.setHybridMode(state);
+                }
+            } else if (line.rfind("junction_radius", 0) == 0) {
+                std::istringstream iss(line);
+                std::string cmd;
+                double r;
+                if (iss >> cmd >> r) {
+                    simulation.setJunctionZoneRadius(r);
+                }
+            } else if (line.rfind("viewport", 0) == 0) {
+                std::istringstream iss(line);
+                std::string cmd;
+                double x0, y0, x1, y1;
+                if (iss >> cmd >> x0 >> y0 >> x1 >> y1) {
+                    simulation.setViewport({x0, y0}, {x1, y1});
+                } else {
+                    simulation.clearViewport();
+                }
+            } else if (line.rfind("kpi_period", 0) == 0) {
+                std::istringstream iss(line);
+                std::string cmd;
+                double sec;
+                if (iss >> cmd >> sec) {
+                    simulation.setKpiPeriod(sec);
+                }
+            } else if (line.rfind("routing", 0) == 0) {
+                std::istringstream iss(line);
+                std::string cmd, mode;
+                if (iss >> cmd >> mode) {
+                    simulation.setRoutingMode(mode == "astar"
+                        ? sim::RoutingMode::AStar
+                        : sim::RoutingMode::NextHop);
+                }
+            } else if (line.rfind("rerouting", 0) == 0) {
+                std::istringstream iss(line);
+                std::string cmd;
+                bool state;
+                if (iss >> cmd >> state) {
+                    simulation.setRerouting(state);
+                }
+            } else if (line.rfind("seek", 0) == 0) {
+                std::istringstream iss(line);
+                std::string cmd;
+                double t;
+                if (iss >> cmd >> t) {
+                    seek_request = std::max(0.0, t);
+                }
+            } else if (line.rfind("record_start", 0) == 0) {
+                std::istringstream iss(line);
+                std::string cmd, path, codec;
+                if (iss >> cmd >> path) {
+                    iss >> codec;
+                    simulation.startRecording(path, codec != "raw");
+                }
+            } else if (line == "record_stop") {
+                simulation.stopRecording();
+            } else if (line.rfind("frames", 0) == 0 && !playback_mode) {
+                std::istringstream iss(line);
+                std::string cmd, mode;
+                if (iss >> cmd >> mode) {
+                    lane_frames = mode == "lane";
+                    geometry_due = lane_frames.load();
+                }
+            } else if (line.rfind("vclasses", 0) == 0) {
+                std::istringstream iss(line);
+                std::string cmd, token;
+                std::vector<sim::VehicleClass> classes;
+                bool ok = static_cast<bool>(iss >> cmd);
+                while (ok && iss >> token) {
+                    sim::VehicleClass c;
+                    ok = sim::parseVehicleClass(token, c);
+                    classes.push_back(c);
+                }
+                if (ok)
+                    simulation.setVehicleClasses(std::move(classes));
+                else
+                    std::cerr << "[vclasses] expected "
+                                 "'following:lanechange[:share]', got '"
+                              << token << "'" << std::endl;
             } else if (line.rfind("set_weights", 0) == 0) {
                 std::istringstream iss(line);
                 std::string cmd, dir;
@@ -97,87 +196,275 @@ void inputHandleLoop() {
     }
 }
 
+// Кадр "lf <base64>"; перед первым кадром - геометрия "geom <base64>"
+void writeLaneFrame(sim::LaneFrameEncoder& encoder) {
+    const sim::RoadNetwork& net = simulation.network();
+    if (geometry_due.exchange(false)) {
+        if (!encoder.encodeGeometry(net)) {
+            std::cerr << "[frames] lane ids exceed "
+                      << sim::lane_frame_format::kMaxLaneId
+                      << ", staying with world poses" << std::endl;
+            lane_frames = false;
+            return;
+        }
+        std::cout << "geom " << encoder.base64() << "\n";
+    }
+
+    if (simulation.vehicles().empty() && simulation.meso().size() == 0)
+        return;
+    encoder.beginFrame(simulation.time());
+    for (const sim::Vehicle& veh : simulation.vehicles()) {
+        if (const sim::Lane* L = net.getLane(veh.laneId()))
+            encoder.add(veh.id(), *L, veh.s(), veh.d());
+    }
+    simulation.meso().forEach([&](const sim::MesoVehicle& mv) {
+        if (const sim::Lane* L = net.getLane(mv.lane))
+            encoder.add(mv.id, *L, mv.s, 0.0);
+    });
+    encoder.endFrame();
+    std::cout << "lf " << encoder.base64() << std::endl;
+}
+
+// Статистика темпа в stderr: stdout читает мост как протокол
+void writePaceStats(const sim::FramePacer::Stats& st) {
+    std::cerr << "[pace] frames " << st.frames << " late " << st.late
+        << " dropped " << st.dropped << " mean_ms "
+        << st.meanLateness * 1e3 << " p99_ms " << st.p99Lateness * 1e3
+        << " max_ms " << st.maxLateness * 1e3 << std::endl;
+}
+
 void simulationLoop() {
+    sim::LaneFrameEncoder encoder;
     const double target_dt = 1.0 / 40.0;
     const seconds_d target_frame_time(target_dt);
 
-    auto last_time = clock_tt::now();
-    seconds_d acc{0.0};
+    sim::FramePacer pacer(target_dt);
 
-    const double max_sim_step = 0.25;
+    // Физика всегда идёт шагом fixed_dt: при ускорении кадр делает
+    // несколько подшагов, пока укладывается в бюджет процессора.
+    // Не успели - остаток долга сбрасываем и сообщаем реальный масштаб.
+    const double fixed_dt = target_dt;
+    const seconds_d cpu_budget = target_frame_time * 0.8;
+    double sim_debt = 0.0;
+    double achieved_scale = -1.0;
 
     while (running) {
-        auto now = clock_tt::now();
-        auto elapsed = now - last_time;
-        last_time = now;
-        acc += std::chrono::duration_cast<seconds_d>(elapsed);
-
-        while (acc >= target_frame_time && running) {
-            acc -= target_frame_time;
+        // Кадр по абсолютному сроку; на паузе только сон, без добора
+        // последних микросекунд опросом часов
+        const bool idle = paused.load();
+        const int due = pacer.wait(!idle);
+        if (pace_due.exchange(false)) {
+            writePaceStats(pacer.takeStats());
+        }
 
-            double sim_dt = paused ? 0.0 : (target_dt * time_scale.load());
+        if (idle) {
+            sim_debt = 0.0;
+            continue;
+        }
 
-            if (sim_dt == 0.0)
-                continue;
+        // Пропущенные сроки (due > 1) добираются подшагами одного кадра
+        sim_debt += due * target_dt * time_scale.load();
+        if (sim_debt < fixed_dt - 1e-9)
+            continue;
 
-            if (sim_dt > max_sim_step)
-                sim_dt = max_sim_step;
+        auto frame_start = clock_tt::now();
+        int substeps = 0;
+        while (sim_debt >= fixed_dt - 1e-9 && running) {
+            if (clock_tt::now() - frame_start > cpu_budget)
+                break;
 
-            simulation.update(static_cast<float>(sim_dt));
+            simulation.update(fixed_dt);
+            sim_debt -= fixed_dt;
+            ++substeps;
 
-            if (std::abs(simulation.time() - last_spawn) > cars_spawn_time) {
-                simulation.addRandomVehicle();
-                last_spawn = simulation.time();
+#ifdef ITS_COUNT_ALLOCATIONS
+            // После прогрева update() не должен обращаться к куче
+            if (simulation.time() > 30.0 &&
+                simulation.lastUpdateAllocations() > 0) {
+                std::cerr << "[alloc] "
+                    << simulation.lastUpdateAllocations()
+                    << " heap allocations in update at t="
+                    << simulation.time() << std::endl;
             }
+#endif
+        }
+
+        if (sim_debt >= fixed_dt - 1e-9) {
+            achieved_scale = substeps * fixed_dt / target_dt;
+            sim_debt = 0.0;
+        }
 
+        if (lane_frames) {
+            writeLaneFrame(encoder);
+        } else {
             for (const sim::Vehicle& veh : simulation.vehicles()) {
                 sim::Pose vP = veh.pose();
                 std::cout << "vh move " << veh.id() << " "
                     << vP.x << " " << vP.y << " " << vP.theta << ";";
             }
-            if (!simulation.vehicles().empty()) {
+            simulation.meso().forEach([](const sim::MesoVehicle& mv) {
+                sim::Pose vP = mv.pose(simulation.network());
+                std::cout << "vh move " << mv.id << " "
+                    << vP.x << " " << vP.y << " " << vP.theta << ";";
+            });
+            if (!simulation.vehicles().empty() ||
+                simulation.meso().size() > 0) {
                 std::cout << std::endl;
             }
-            if (simulation.time() - last_time_print >= 1.0f) {
-                std::cout << "time " << simulation.time() << ";";
+        }
+        if (simulation.time() - last_time_print >= 1.0f) {
+            std::cout << "time " << simulation.time() << ";";
+
+            sim::CarSignal s2 = simulation.world().carSignalForLane(2);
+            sim::CarSignal s6 = simulation.world().carSignalForLane(6);
+
+            std::cout << "signal 0 " << static_cast<int>(s2)
+                << ";signal 1 " << static_cast<int>(s6) <<
+                std::endl;
 
-                sim::CarSignal s2 = simulation.world().carSignalForLane(2);
-                sim::CarSignal s6 = simulation.world().carSignalForLane(6);
+            last_time_print = simulation.time();
 
-                std::cout << "signal 0 " << static_cast<int>(s2)
-                    << ";signal 1 " << static_cast<int>(s6) <<
-                    std::endl;
+            if (simulation.kpiDue()) {
+                simulation.writeKpi(std::cout);
+            }
 
-                last_time_print = simulation.time();
+            if (achieved_scale >= 0.0) {
+                std::cout << "scale " << achieved_scale << std::endl;
+                achieved_scale = -1.0;
             }
+        }
+
+    }
+    writePaceStats(pacer.takeStats());
+}
+
+// Воспроизведение записи (record_start): те же строки "vh ..." и "time",
+// что выдаёт симуляция, но без шага модели. Появление и исчезновение
+// машин восстанавливается сравнением соседних выведенных тиков.
+void playbackLoop(sim::TrajectoryReader& reader) {
+    const double target_dt = 1.0 / 40.0;
+
+    sim::FramePacer pacer(target_dt);
+
+    double t = reader.startTime();
+    double shown_time = -1.0;
+    std::vector<uint64_t> shown, ids;
+
+    while (running) {
+        const bool idle = paused.load();
+        const int due = pacer.wait(!idle);
+        if (pace_due.exchange(false)) {
+            writePaceStats(pacer.takeStats());
+        }
 
+        double seek = seek_request.exchange(-1.0);
+        if (seek >= 0.0) {
+            t = std::clamp(seek, reader.startTime(), reader.endTime());
+            last_time_print = -1.0;
+        } else if (!idle) {
+            t = std::min(t + due * target_dt * time_scale.load(),
+                         reader.endTime());
         }
 
-        auto frame_left = target_frame_time - acc;
-        if (frame_left.count() > 0) {
-            auto sleep_ms = std::chrono::duration_cast<
-                std::chrono::milliseconds>(frame_left);
-            if (sleep_ms.count() > 0) {
-                std::this_thread::sleep_for(sleep_ms);
+        sim::TrajectoryFrame frame = reader.frameAt(t);
+        if (frame.time == shown_time) {
+            continue;
+        }
+        shown_time = frame.time;
+
+        ids.clear();
+        for (size_t i = 0; i < frame.count; ++i) {
+            ids.push_back(frame.rows[i].id);
+        }
+        std::sort(ids.begin(), ids.end());
+        for (uint64_t id : shown) {
+            if (!std::binary_search(ids.begin(), ids.end(), id)) {
+                std::cout << "vh deleted " << id << "\n";
             }
         }
+        for (uint64_t id : ids) {
+            if (!std::binary_search(shown.begin(), shown.end(), id)) {
+                std::cout << "vh spawned " << id << "\n";
+            }
+        }
+        shown.swap(ids);
+
+        for (size_t i = 0; i < frame.count; ++i) {
+            const sim::TrajectoryRow& r = frame.rows[i];
+            std::cout << "vh move " << r.id << " " << r.pose.x << " "
+                << r.pose.y << " " << r.pose.theta << ";";
+        }
+        if (frame.count > 0) {
+            std::cout << std::endl;
+        }
+        if (std::abs(frame.time - last_time_print) >= 1.0) {
+            std::cout << "time " << frame.time << std::endl;
+            last_time_print = frame.time;
+        }
     }
 }
 
-int main() {
+int main(int argc, char** argv) {
     std::ios::sync_with_stdio(false);
     std::cin.tie(nullptr);
 
     std::signal(SIGTERM, on_signal);
     std::signal(SIGINT, on_signal);
 
-    simulation.initRoadNetwork();
+    // --grid R C - сетка перекрёстков вместо демо-перекрёстка,
+    // --threads N - параллельный шаг по областям сети,
+    // --playback FILE - показать запись вместо симуляции,
+    // --od FILE - спрос по матрице корреспонденций (см. parseOdMatrix),
+    // --frames lane - кадры в координатах полосы (см. lane_frames.h)
+    int grid_rows = 0, grid_cols = 0, threads = 0;
+    std::string playback_path, od_path;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--grid" && i + 2 < argc) {
+            grid_rows = std::stoi(argv[++i]);
+            grid_cols = std::stoi(argv[++i]);
+        } else if (arg == "--threads" && i + 1 < argc) {
+            threads = std::stoi(argv[++i]);
+        } else if (arg == "--playback" && i + 1 < argc) {
+            playback_path = argv[++i];
+        } else if (arg == "--od" && i + 1 < argc) {
+            od_path = argv[++i];
+        } else if (arg == "--frames" && i + 1 < argc) {
+            lane_frames = std::string(argv[++i]) == "lane";
+            geometry_due = lane_frames.load();
+        }
+    }
+
+    if (!playback_path.empty()) {
+        sim::TrajectoryReader reader;
+        if (!reader.open(playback_path)) {
+            return 1;
+        }
+        playback_mode = true;
+
+        std::thread input_thread(inputHandleLoop);
+        std::thread playback_thread(playbackLoop, std::ref(reader));
+        input_thread.join();
+        playback_thread.join();
+        return 0;
+    }
+
+    if (grid_rows > 0 && grid_cols > 0) {
+        simulation.initGridNetwork(grid_rows, grid_cols);
+    } else {
+        simulation.initRoadNetwork();
+    }
+    simulation.setWorkerThreads(threads);
+    if (!od_path.empty() && !simulation.loadDemand(od_path)) {
+        return 1;
+    }
 
     std::thread input_thread(inputHandleLoop);
     std::thread sim_thread(simulationLoop);
 
     input_thread.join();
     sim_thread.join();
+    simulation.stopRecording();
 
     return 0;
 }
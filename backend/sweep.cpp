@@ -0,0 +1,63 @@
+#include "core/simulation/sweep.h"
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+
+// Перебор параметров светофоров и спроса без клиента:
+//   ITS_sweep PLAN [--threads N] [--out FILE]
+// PLAN - см. SweepPlan; таблица показателей в stdout или FILE.
+int main(int argc, char** argv) {
+    std::string plan_path, out_path;
+    int threads = static_cast<int>(std::thread::hardware_concurrency());
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--threads" && i + 1 < argc) {
+            threads = std::stoi(argv[++i]);
+        } else if (arg == "--out" && i + 1 < argc) {
+            out_path = argv[++i];
+        } else if (plan_path.empty()) {
+            plan_path = arg;
+        }
+    }
+    if (plan_path.empty()) {
+        std::cerr << "usage: " << argv[0]
+                  << " PLAN [--threads N] [--out FILE]" << std::endl;
+        return 2;
+    }
+
+    std::ifstream in(plan_path);
+    sim::SweepPlan plan;
+    std::string error = "cannot open file";
+    if (!in || !sim::parseSweepPlan(in, plan, error)) {
+        std::cerr << "[sweep] " << plan_path << ": " << error << std::endl;
+        return 1;
+    }
+
+    const size_t runs = plan.configs.size() * plan.replicates;
+    std::cerr << "[sweep] " << plan.configs.size() << " configs x "
+              << plan.replicates << " replicates on " << std::max(1, threads)
+              << " threads" << std::endl;
+    auto start = std::chrono::steady_clock::now();
+    std::vector<sim::SweepRun> results;
+    if (!sim::runSweep(plan, threads, results, error)) {
+        std::cerr << "[sweep] " << error << std::endl;
+        return 1;
+    }
+    std::chrono::duration<double> wall = std::chrono::steady_clock::now() - start;
+    std::cerr << "[sweep] " << runs << " runs in " << wall.count() << " s"
+              << std::endl;
+
+    if (out_path.empty()) {
+        sim::writeSweepTable(std::cout, plan, results);
+        return 0;
+    }
+    std::ofstream out(out_path);
+    if (!out) {
+        std::cerr << "[sweep] cannot write " << out_path << std::endl;
+        return 1;
+    }
+    sim::writeSweepTable(out, plan, results);
+    return 0;
+}
@@ -0,0 +1,57 @@
+#include "core/simulation/simulation.h"
+#include "counting_new.h"
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+
+// Установившийся режим не обращается к куче: после разгона ни один
+// update() демо-сети не зовёт operator new (ни одним потоком, ни пулом).
+//   its_alloc_steady_state [THREADS]
+// Код возврата 1 и первые тики с выделениями - если гарантия нарушена.
+
+namespace {
+
+constexpr double kTick = 1.0 / 40.0;
+constexpr double kWarmup = 600.0;  // с: очереди и векторы вышли на пик
+constexpr double kWindow = 600.0;  // с: в этом окне - ни одного выделения
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    const int threads = argc > 1 ? std::atoi(argv[1]) : 0;
+
+    sim::Simulation s;
+    s.setSeed(3);
+    s.setEventOutput(nullptr);
+    s.initRoadNetwork();
+    s.setWorkerThreads(threads);
+
+    while (s.time() < kWarmup)
+        s.update(kTick);
+
+    uint64_t total = 0;
+    int reported = 0;
+    while (s.time() < kWarmup + kWindow) {
+        const uint64_t before = countedAllocations();
+        s.update(kTick);
+        const uint64_t n = countedAllocations() - before;
+        if (n == 0)
+            continue;
+        total += n;
+        if (reported++ < 10)
+            std::fprintf(stderr, "t=%.3f: %llu allocation(s)\n", s.time(),
+                         static_cast<unsigned long long>(n));
+    }
+
+    if (total > 0) {
+        std::fprintf(stderr,
+                     "FAIL: %llu allocation(s) in %d tick(s) after warm-up "
+                     "(threads=%d)\n",
+                     static_cast<unsigned long long>(total), reported,
+                     threads);
+        return 1;
+    }
+    std::printf("ok: no allocations in %.0f s after warm-up (threads=%d)\n",
+                kWindow, threads);
+    return 0;
+}
@@ -0,0 +1,94 @@
+#include "core/simulation/simulation.h"
+#include "counting_new.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+// A* в рабочих массивах потока (SearchWorkspace) на сетке 6x6:
+// - после разгона запрос выделяет память только под возвращаемый
+//   RouteData, сам поиск (куча, слоты, эвристика, путь) - ни разу;
+// - маршруты стоят столько же, сколько у поиска прямо по сети
+//   (Pathfinder без precompute(), как прежняя реализация), и находятся
+//   для тех же пар. Равноценные маршруты могут отличаться полосами.
+// Цели чередуются на каждом запросе, так что кэш эвристики по цели
+// сбрасывается постоянно.
+
+namespace {
+
+constexpr double kRelTolerance = 1e-9;  // суммы в разном порядке
+constexpr int kPasses = 3;
+
+}  // namespace
+
+int main() {
+    sim::Simulation s;
+    s.setEventOutput(nullptr);
+    s.initGridNetwork(6, 6);
+    const sim::RoadNetwork& net = s.network();
+
+    std::vector<sim::LaneId> lanes;
+    for (const auto& [id, L] : net.lanes())
+        if (!L.isConnector)
+            lanes.push_back(id);
+    std::sort(lanes.begin(), lanes.end());
+
+    sim::Pathfinder astar(&net), reference(&net);
+    astar.precompute({});
+    astar.setMode(sim::RoutingMode::AStar);
+
+    std::vector<sim::RoutePlan> expected;
+    for (size_t si = 0; si < lanes.size(); si += 3)
+        for (size_t gi = 0; gi < lanes.size(); gi += 7)
+            expected.push_back(
+                reference.plan(lanes[si], sim::Goal::toLane(lanes[gi])));
+
+    size_t queries = 0, extra = 0, wrong = 0;
+    for (int pass = 0; pass < kPasses; ++pass) {
+        size_t q = 0;
+        for (size_t si = 0; si < lanes.size(); si += 3)
+            for (size_t gi = 0; gi < lanes.size(); gi += 7) {
+                const sim::Goal goal = sim::Goal::toLane(lanes[gi]);
+                const uint64_t before = countedAllocations();
+                const sim::RoutePlan plan = astar.plan(lanes[si], goal);
+                const uint64_t used = countedAllocations() - before;
+
+                // Столько же стоит копия результата: всё сверх неё - поиск
+                const uint64_t copyBefore = countedAllocations();
+                auto copy = std::make_shared<sim::RouteData>(*plan.data);
+                const uint64_t result = countedAllocations() - copyBefore;
+                copy.reset();
+
+                const sim::RoutePlan& ref = expected[q++];
+                const double cost = astar.cost(plan);
+                const double refCost = astar.cost(ref);
+                if (plan.valid() != ref.valid() ||
+                    std::abs(cost - refCost) >
+                        kRelTolerance * std::max(1.0, refCost)) {
+                    if (wrong++ < 10)
+                        std::fprintf(stderr, "%d -> %d: cost %.12g, "
+                                             "reference %.12g\n",
+                                     lanes[si], lanes[gi], cost, refCost);
+                }
+                if (pass == 0)
+                    continue;  // разгон: буферы растут до размера сети
+                ++queries;
+                if (used > result && extra++ < 10)
+                    std::fprintf(stderr,
+                                 "%d -> %d: %llu allocation(s), result %llu\n",
+                                 lanes[si], lanes[gi],
+                                 static_cast<unsigned long long>(used),
+                                 static_cast<unsigned long long>(result));
+            }
+    }
+
+    std::printf("%zu queries after warm-up: %zu with search allocations, "
+                "%zu routes off the reference cost\n",
+                queries, extra, wrong);
+    if (extra > 0 || wrong > 0) {
+        std::fprintf(stderr, "FAIL\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,6 @@
+#pragma once
+#include <cstdint>
+
+// Число вызовов operator new с начала процесса. Если ядро собрано с
+// ITS_COUNT_ALLOCATIONS, считает оно, иначе - замена из counting_new.cpp.
+uint64_t countedAllocations();
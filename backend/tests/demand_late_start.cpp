@@ -0,0 +1,51 @@
+#include "core/simulation/simulation.h"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+
+// Матрица, первый срез которой начинается не с нуля: до t_from машин
+// нет, после - поток идёт (прежде такой срез пропускался целиком).
+//   its_demand_late_start FILE  - FILE: куда записать матрицу
+
+namespace {
+
+constexpr double kTick = 1.0 / 40.0;
+constexpr double kStart = 30.0;  // t_from единственного среза, с
+constexpr double kEnd = 300.0;
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    if (argc != 2) {
+        std::fprintf(stderr, "usage: %s FILE\n", argv[0]);
+        return 2;
+    }
+    {
+        std::ofstream od(argv[1]);
+        od << kStart << " 2 5 1800\n";
+    }
+
+    sim::Simulation s;
+    s.setSeed(3);
+    s.setEventOutput(nullptr);
+    s.initRoadNetwork();
+    if (!s.loadDemand(argv[1]))
+        return 2;
+
+    size_t early = 0, peak = 0;
+    while (s.time() < kEnd) {
+        s.update(kTick);
+        if (s.time() < kStart)
+            early = std::max(early, s.vehicles().size());
+        peak = std::max(peak, s.vehicles().size());
+    }
+
+    std::printf("before t_from: %zu vehicles, peak: %zu\n", early, peak);
+    if (early > 0 || peak == 0) {
+        std::fprintf(stderr, "FAIL: expected no vehicles before t=%.0f "
+                             "and some after\n",
+                     kStart);
+        return 1;
+    }
+    return 0;
+}
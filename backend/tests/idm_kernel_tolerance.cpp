@@ -0,0 +1,61 @@
+#include "core/models/idm_kernel.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+// Пакетное ядро IDM против формулы с std::pow построчно, на сетке
+// зазоров, скоростей и параметров водителя. Без assert, так что
+// проверка идёт и в Release; собирается с обеими точностями sim::Real.
+// Допуск - kIdmTolerance * max(1, |a_ref|), эталон считается от входов
+// пакета (уже округлённых до Real), как в отладочной проверке шага.
+
+int main() {
+    const double gaps[] = {0.05, 0.5, 1.0, 2.0, 5.0, 10.0, 30.0, 100.0, 300.0};
+    const double speeds[] = {0.0, 0.5, 2.0, 5.0, 10.0, 14.0, 20.0, 30.0, 40.0};
+    const double accels[] = {0.5, 1.0, 1.5, 3.0};
+    const double brakes[] = {1.0, 2.0, 4.0};
+    const double headways[] = {0.8, 1.5, 2.5};
+    const double jams[] = {1.0, 2.0, 3.0};
+    const double desired[] = {10.0, 14.0, 30.0, 40.0};
+
+    sim::IdmBatch batch;
+    for (double gap : gaps)
+        for (double v : speeds)
+            for (double vFront : speeds)
+                for (double a : accels)
+                    for (double b : brakes)
+                        for (double T : headways)
+                            for (double s0 : jams)
+                                for (double v0 : desired)
+                                    batch.push(v, vFront, gap, a, b, T, s0, v0);
+    sim::idmAccelBatch(batch);
+
+    size_t bad = 0;
+    double worst = 0.0;
+    for (size_t r = 0; r < batch.size(); ++r) {
+        const double ref = sim::idmAccelReference(
+            batch.v[r], batch.vFront[r], batch.gap[r], batch.a[r],
+            1.0 / (4.0 * batch.a[r] * batch.invBrake[r] * batch.invBrake[r]),
+            batch.T[r], batch.s0[r], 1.0 / batch.invV0[r]);
+        const double err =
+            std::abs(batch.out[r] - ref) / std::max(1.0, std::abs(ref));
+        worst = std::max(worst, err);
+        if (err <= sim::kIdmTolerance)
+            continue;
+        if (bad++ < 10)
+            std::fprintf(stderr,
+                         "row %zu: v=%g vFront=%g gap=%g batch %.9g ref %.9g\n",
+                         r, double(batch.v[r]), double(batch.vFront[r]),
+                         double(batch.gap[r]), double(batch.out[r]), ref);
+    }
+
+    std::printf("sim::Real is %s: %zu rows, worst relative error %.3g "
+                "(tolerance %.0e)\n",
+                sizeof(sim::Real) == sizeof(float) ? "float" : "double",
+                batch.size(), worst, sim::kIdmTolerance);
+    if (bad > 0) {
+        std::fprintf(stderr, "FAIL: %zu rows outside tolerance\n", bad);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,143 @@
+#include "core/simulation/simulation.h"
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <unordered_set>
+#include <vector>
+
+// Многошаговое интегрирование против шага на каждом тике: один и тот же
+// сценарий в двух симуляциях, setMultiRate(true) и setMultiRate(false).
+// Машины едут по одной на въездной полосе длиной 1 км (сетка 1x1 с
+// шагом 2 км), без лидеров; пока обе копии на въездной полосе, разница
+// положений не должна превышать накопленной оценки из vehicle.h:
+// 0.5 * |a| * kCoarseInterval^2 за каждый крупный интервал.
+//   its_multi_rate_error FILE  - FILE: куда записать пустую матрицу спроса
+
+namespace {
+
+constexpr double kTick = 1.0 / 40.0;
+constexpr double kDuration = 300.0;  // с
+constexpr double kSpacing = 2000.0;  // м между перекрёстками
+constexpr double kSlack = 1e-6;      // м, округление
+
+struct Track {
+    double bound{0.0};  // накопленная оценка, м
+    bool done{false};   // одна из копий ушла с въездной полосы
+};
+
+void setUp(sim::Simulation& s, const char* emptyOd, bool multiRate) {
+    s.setSeed(5);
+    s.setEventOutput(nullptr);
+    s.initGridNetwork(1, 1, kSpacing);
+    s.loadDemand(emptyOd);
+    s.setMultiRate(multiRate);
+}
+
+const sim::Vehicle* find(const sim::Simulation& s, uint64_t id) {
+    for (const sim::Vehicle& v : s.vehicles())
+        if (v.id() == id)
+            return &v;
+    return nullptr;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    if (argc != 2) {
+        std::fprintf(stderr, "usage: %s FILE\n", argv[0]);
+        return 2;
+    }
+    std::ofstream(argv[1]).flush();
+
+    sim::Simulation coarse, fine;
+    setUp(coarse, argv[1], true);
+    setUp(fine, argv[1], false);
+
+    // Въезды - полосы без предшественников, выезды - без продолжения
+    const sim::RoadNetwork& net = fine.network();
+    std::vector<char> hasPred(net.maxLaneId() + 1, 0);
+    for (const auto& [id, L] : net.lanes())
+        for (sim::LaneId n : L.next)
+            hasPred[n] = 1;
+    std::vector<sim::LaneId> entries;
+    std::unordered_set<sim::LaneId> exits;
+    for (const auto& [id, L] : net.lanes()) {
+        if (L.isConnector)
+            continue;
+        if (!hasPred[id])
+            entries.push_back(id);
+        if (L.next.empty())
+            exits.insert(id);
+    }
+    const sim::Goal goal = sim::Goal::toLaneSet(exits);
+
+    std::map<sim::LaneId, uint64_t> onEntry;  // полоса -> id последней машины
+    std::map<uint64_t, Track> tracks;
+    size_t coastTicks = 0;
+    double worst = 0.0, worstRatio = 0.0;
+    int failures = 0;
+
+    while (fine.time() < kDuration) {
+        // Новая машина, когда предыдущая на этой полосе ушла с неё в обеих
+        for (sim::LaneId lane : entries) {
+            auto it = onEntry.find(lane);
+            if (it != onEntry.end()) {
+                const sim::Vehicle* a = find(coarse, it->second);
+                const sim::Vehicle* b = find(fine, it->second);
+                if ((a && a->laneId() == lane) || (b && b->laneId() == lane))
+                    continue;
+            }
+            const uint64_t id = fine.addVehicle({}, {}, lane, goal).id();
+            coarse.addVehicle({}, {}, lane, goal);
+            onEntry[lane] = id;
+            tracks[id];
+        }
+
+        // Оценка растёт на тиках, где машина катится без полного шага
+        for (const sim::Vehicle& v : coarse.vehicles()) {
+            if (!v.coasting(coarse.time() + kTick))
+                continue;
+            tracks[v.id()].bound += 0.5 * std::abs(v.a()) *
+                                    sim::Vehicle::kCoarseInterval * kTick;
+            ++coastTicks;
+        }
+
+        coarse.update(kTick);
+        fine.update(kTick);
+
+        for (auto& [id, tr] : tracks) {
+            if (tr.done)
+                continue;
+            const sim::Vehicle* a = find(coarse, id);
+            const sim::Vehicle* b = find(fine, id);
+            if (!a || !b || a->laneId() != b->laneId() ||
+                !onEntry.count(a->laneId())) {
+                tr.done = true;
+                continue;
+            }
+            const double diff = std::abs(a->s() - b->s());
+            worst = std::max(worst, diff);
+            if (tr.bound > 0.0)
+                worstRatio = std::max(worstRatio, diff / tr.bound);
+            if (diff > tr.bound + kSlack && failures++ < 10)
+                std::fprintf(stderr,
+                             "t=%.3f vehicle %llu: |ds| %.6f m, bound %.6f m\n",
+                             fine.time(), static_cast<unsigned long long>(id),
+                             diff, tr.bound);
+        }
+    }
+
+    std::printf("%zu vehicles, %zu coasting vehicle-ticks, max |ds| %.6f m, "
+                "max |ds|/bound %.3f\n",
+                tracks.size(), coastTicks, worst, worstRatio);
+    if (coastTicks == 0) {
+        std::fprintf(stderr, "FAIL: no vehicle coasted, nothing checked\n");
+        return 1;
+    }
+    if (failures > 0) {
+        std::fprintf(stderr, "FAIL: %d checks above the bound\n", failures);
+        return 1;
+    }
+    return 0;
+}
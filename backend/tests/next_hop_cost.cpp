@@ -0,0 +1,103 @@
+#include "core/simulation/simulation.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+// Маршруты по таблице следующих шагов стоят столько же, сколько
+// маршруты A*, для всех пар (полоса, выезд) демо-сети: со статическими
+// стоимостями и после измеренных времён проезда. Pathfinder без
+// precompute() тоже находит путь той же стоимости (поиск прямо по сети).
+
+namespace {
+
+constexpr double kRelTolerance = 1e-9;  // суммы в разном порядке
+
+struct Check {
+    size_t pairs{0};
+    size_t bad{0};
+
+    void expect(const char* what, sim::LaneId from, sim::LaneId to,
+                const sim::RoutePlan& got, double gotCost,
+                const sim::RoutePlan& ref, double refCost) {
+        ++pairs;
+        if (got.valid() == ref.valid() &&
+            (!ref.valid() || std::abs(gotCost - refCost) <=
+                                 kRelTolerance * std::max(1.0, refCost)))
+            return;
+        if (bad++ < 10)
+            std::fprintf(stderr, "%s %d -> %d: cost %.12g (%s), A* %.12g (%s)\n",
+                         what, from, to, gotCost, got.valid() ? "found" : "none",
+                         refCost, ref.valid() ? "found" : "none");
+    }
+};
+
+}  // namespace
+
+int main() {
+    sim::Simulation s;
+    s.setEventOutput(nullptr);
+    s.initRoadNetwork();
+    const sim::RoadNetwork& net = s.network();
+
+    std::vector<sim::LaneId> origins, exits;
+    for (const auto& [id, L] : net.lanes()) {
+        if (L.isConnector)
+            continue;
+        origins.push_back(id);
+        if (L.next.empty())
+            exits.push_back(id);
+    }
+    std::sort(origins.begin(), origins.end());
+    std::sort(exits.begin(), exits.end());
+
+    sim::Pathfinder hop(&net), astar(&net), bare(&net);
+    hop.precompute(exits);
+    astar.precompute(exits);
+    astar.setMode(sim::RoutingMode::AStar);
+
+    Check check;
+    auto compareAll = [&](const char* what) {
+        for (sim::LaneId from : origins)
+            for (sim::LaneId to : exits) {
+                const sim::Goal goal = sim::Goal::toLane(to);
+                const sim::RoutePlan ref = astar.plan(from, goal);
+                const sim::RoutePlan got = hop.plan(from, goal);
+                check.expect(what, from, to, got, astar.cost(got), ref,
+                             astar.cost(ref));
+            }
+    };
+    compareAll("next-hop");
+
+    // Без precompute(): стоимость найденного пути - по таблицам astar
+    for (sim::LaneId from : origins)
+        for (sim::LaneId to : exits) {
+            const sim::Goal goal = sim::Goal::toLane(to);
+            const sim::RoutePlan ref = astar.plan(from, goal);
+            const sim::RoutePlan got = bare.plan(from, goal);
+            check.expect("unprepared", from, to, got, astar.cost(got), ref,
+                         astar.cost(ref));
+        }
+
+    // Измеренные времена: часть полос медленнее статического времени
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<double> travel(0.0, 60.0);
+    std::vector<double> live(net.maxLaneId() + 1);
+    for (double& t : live)
+        t = travel(rng);
+    for (sim::Pathfinder* pf : {&hop, &astar}) {
+        pf->setLiveCosts(live);
+        for (size_t k = 0; k < pf->targetCount(); ++k)
+            pf->rebuildTarget(k);
+    }
+    compareAll("next-hop live");
+
+    std::printf("%zu origins x %zu exits, %zu comparisons, %zu mismatches\n",
+                origins.size(), exits.size(), check.pairs, check.bad);
+    if (check.bad > 0) {
+        std::fprintf(stderr, "FAIL: route costs differ from A*\n");
+        return 1;
+    }
+    return 0;
+}
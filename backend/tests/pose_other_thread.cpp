@@ -0,0 +1,53 @@
+#include "core/simulation/simulation.h"
+#include <cmath>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+// pose() из потока, который ни одной машины не шагал (так кадр "vh move"
+// читается в main.cpp при рабочих потоках): положение совпадает с точкой
+// полосы по s и d, а не с нулевой позой по умолчанию.
+
+namespace {
+
+constexpr double kTick = 1.0 / 40.0;
+constexpr double kDuration = 120.0;  // с: сеть успела заполниться
+
+}  // namespace
+
+int main() {
+    sim::Simulation s;
+    s.setSeed(3);
+    s.setEventOutput(nullptr);
+    s.initRoadNetwork();
+    s.setWorkerThreads(2);
+    while (s.time() < kDuration)
+        s.update(kTick);
+
+    std::vector<sim::Pose> poses;
+    std::thread reader([&] {
+        for (const sim::Vehicle& v : s.vehicles())
+            poses.push_back(v.pose());
+    });
+    reader.join();
+
+    size_t bad = 0, i = 0;
+    for (const sim::Vehicle& v : s.vehicles()) {
+        const sim::Pose want =
+            s.network().getLane(v.laneId())->poseAt(v.s(), v.d());
+        const sim::Pose& got = poses[i++];
+        if (std::abs(got.x - want.x) < 1e-9 && std::abs(got.y - want.y) < 1e-9)
+            continue;
+        if (bad++ < 10)
+            std::fprintf(stderr, "vehicle %llu: (%g, %g), lane gives (%g, %g)\n",
+                         static_cast<unsigned long long>(v.id()), got.x, got.y,
+                         want.x, want.y);
+    }
+
+    std::printf("%zu vehicles, %zu poses off the lane\n", poses.size(), bad);
+    if (poses.empty() || bad > 0) {
+        std::fprintf(stderr, "FAIL: expected every pose on its lane\n");
+        return 1;
+    }
+    return 0;
+}
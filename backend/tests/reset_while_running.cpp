@@ -0,0 +1,49 @@
+#include "core/simulation/simulation.h"
+#include <atomic>
+#include <cstdio>
+#include <thread>
+
+// Команды reset и reroute приходят из потока ввода, пока поток
+// симуляции с пулом рабочих потоков внутри update(). Сброс (вместе
+// с пересчётом таблиц маршрутов на пуле) применяется в начале update():
+// прогон не падает, а после последнего reset() часы идут с нуля.
+
+namespace {
+
+constexpr double kTick = 1.0 / 40.0;
+constexpr int kResets = 50;
+
+}  // namespace
+
+int main() {
+    sim::Simulation s;
+    s.setSeed(3);
+    s.setEventOutput(nullptr);
+    s.initGridNetwork(2, 2);
+    s.setWorkerThreads(2);
+    s.setRerouting(true);
+
+    std::atomic<bool> done{false};
+    std::thread input([&] {
+        for (int i = 0; i < kResets; ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+            s.reset();
+            s.setRerouting(i % 2 == 0);
+        }
+        done = true;
+    });
+
+    while (!done)
+        s.update(kTick);
+    input.join();
+    s.reset();
+    s.update(kTick);
+
+    std::printf("t=%.3f after reset, %zu vehicles\n", s.time(),
+                s.vehicles().size());
+    if (s.time() != kTick || !s.vehicles().empty()) {
+        std::fprintf(stderr, "FAIL: reset did not start the run over\n");
+        return 1;
+    }
+    return 0;
+}
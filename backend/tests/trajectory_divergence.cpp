@@ -0,0 +1,136 @@
+#include "core/simulation/simulation.h"
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <string>
+#include <tuple>
+#include <vector>
+
+// Расхождение траекторий float- и double-сборки (ITS_FLOAT_STATE).
+// Одна и та же программа собирается с обеими точностями:
+//   its_trajectory_divergence write FILE    - снимки состояния в FILE
+//   its_trajectory_divergence compare FILE  - тот же прогон, сравнение
+// Код возврата 1, если в каком-то снимке разный состав машин, машина
+// на другой полосе или |ds|, |dv| больше допуска.
+
+namespace {
+
+constexpr double kTick = 1.0 / 40.0;
+constexpr double kDuration = 400.0;  // с
+constexpr double kSnapshot = 10.0;   // с между снимками
+constexpr double kMaxDs = 0.05;      // м
+constexpr double kMaxDv = 0.01;      // м/с
+
+struct State {
+    int lane;
+    double s;
+    double v;
+};
+
+// (номер снимка, id) -> состояние
+using Snapshots = std::map<std::pair<int, uint64_t>, State>;
+
+Snapshots run() {
+    sim::Simulation s;
+    s.setSeed(7);
+    s.setEventOutput(nullptr);
+    s.initGridNetwork(3, 3);
+
+    Snapshots out;
+    const int ticksPerSnapshot = static_cast<int>(std::lround(kSnapshot / kTick));
+    const int snapshots = static_cast<int>(std::lround(kDuration / kSnapshot));
+    for (int k = 1; k <= snapshots; ++k) {
+        for (int i = 0; i < ticksPerSnapshot; ++i)
+            s.update(kTick);
+        for (const sim::Vehicle& v : s.vehicles())
+            out[{k, v.id()}] = State{v.laneId(), v.s(), v.v()};
+    }
+    return out;
+}
+
+bool write(const std::string& path, const Snapshots& snaps) {
+    std::ofstream f(path);
+    f.precision(17);
+    for (const auto& [key, st] : snaps)
+        f << key.first << ' ' << key.second << ' ' << st.lane << ' ' << st.s
+          << ' ' << st.v << '\n';
+    return static_cast<bool>(f);
+}
+
+bool read(const std::string& path, Snapshots& snaps) {
+    std::ifstream f(path);
+    if (!f)
+        return false;
+    int k;
+    uint64_t id;
+    State st;
+    while (f >> k >> id >> st.lane >> st.s >> st.v)
+        snaps[{k, id}] = st;
+    return f.eof();
+}
+
+int compare(const Snapshots& ref, const Snapshots& got) {
+    int mismatched = 0;
+    double maxDs = 0.0, maxDv = 0.0;
+    for (const auto& [key, a] : ref) {
+        auto it = got.find(key);
+        if (it == got.end() || it->second.lane != a.lane) {
+            if (mismatched++ < 10)
+                std::fprintf(stderr, "t=%.0f vehicle %llu: %s\n",
+                             key.first * kSnapshot,
+                             static_cast<unsigned long long>(key.second),
+                             it == got.end() ? "missing" : "on another lane");
+            continue;
+        }
+        maxDs = std::max(maxDs, std::abs(it->second.s - a.s));
+        maxDv = std::max(maxDv, std::abs(it->second.v - a.v));
+    }
+    for (const auto& [key, b] : got) {
+        if (!ref.count(key) && mismatched++ < 10)
+            std::fprintf(stderr, "t=%.0f vehicle %llu: not in reference\n",
+                         key.first * kSnapshot,
+                         static_cast<unsigned long long>(key.second));
+    }
+
+    std::printf("%zu states, %d mismatched, max |ds| %.6f m, "
+                "max |dv| %.6f m/s\n",
+                ref.size(), mismatched, maxDs, maxDv);
+    if (mismatched > 0 || maxDs > kMaxDs || maxDv > kMaxDv) {
+        std::fprintf(stderr, "FAIL: bound is |ds| <= %.3f m, |dv| <= %.3f m/s, "
+                             "same vehicles and lanes\n",
+                     kMaxDs, kMaxDv);
+        return 1;
+    }
+    return 0;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    if (argc != 3 || (std::strcmp(argv[1], "write") != 0 &&
+                      std::strcmp(argv[1], "compare") != 0)) {
+        std::fprintf(stderr, "usage: %s write|compare FILE\n", argv[0]);
+        return 2;
+    }
+    std::printf("sim::Real is %s\n",
+                sizeof(sim::Real) == sizeof(float) ? "float" : "double");
+
+    const Snapshots snaps = run();
+    if (std::strcmp(argv[1], "write") == 0) {
+        if (!write(argv[2], snaps)) {
+            std::fprintf(stderr, "cannot write %s\n", argv[2]);
+            return 2;
+        }
+        return 0;
+    }
+
+    Snapshots ref;
+    if (!read(argv[2], ref)) {
+        std::fprintf(stderr, "cannot read %s\n", argv[2]);
+        return 2;
+    }
+    return compare(ref, snaps);
+}
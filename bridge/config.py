@@ -1,4 +1,16 @@
+import os
+
 FLUSH_INTERVAL_MS = 25
 MAX_BATCH_BYTES = 64 * 1024
 OUT_QUEUE_MAXSIZE = 1000
 BIN_PATH = "/app/bridge/bin/ITS"
+# Кадры машин: "world" - позы считает сервер (как прежде), "lane" - кадры
+# в координатах полосы, позы считает мост (utils/lane_frames.py).
+# По умолчанию world; lane - через ITS_FRAMES=lane или поле "frames"
+# сообщения create
+FRAMES = os.environ.get("ITS_FRAMES", "world")
+FRAME_MODES = ("world", "lane")
+
+
+def bin_args(frames: str) -> list:
+    return ["--frames", "lane"] if frames == "lane" else []
@@ -9,7 +9,7 @@ import sys
 import os
 
 from .models import SessionManager, Session
-from config import BIN_PATH
+from config import BIN_PATH, FRAMES, FRAME_MODES, bin_args
 
 logging.basicConfig(
     level=logging.INFO,
@@ -51,7 +51,13 @@ async def websocket_endpoint(ws: WebSocket):
             await ws.close()
             return
 
-        session = await manager.create(ws, cmd=[str(BIN_PATH)])
+        frames = msg.get("frames", FRAMES)
+        if frames not in FRAME_MODES:
+            await ws.send_json({"type": "error", "error": f"frames must be one of {FRAME_MODES}"})
+            await ws.close()
+            return
+
+        session = await manager.create(ws, cmd=[str(BIN_PATH), *bin_args(frames)])
         await ws.send_json({"type": "created", "session_id": session.session_id})
         logger.info("Simulation process started")
 
@@ -4,13 +4,16 @@ import asyncio
 import contextlib
 from fastapi import WebSocket, WebSocketDisconnect
 from starlette.websockets import WebSocketState
+import base64
+import binascii
 import json
 import logging
+import struct
 
 uvicorn_logger = logging.getLogger("uvicorn.error")
 
 from ..config import *
-from ..utils import kill_process_tree, convert_msg_to_dict
+from ..utils import kill_process_tree, convert_msg_to_dict, LaneGeometry
 
 
 @dataclass
@@ -23,6 +26,8 @@ class Session:
     read_stdout_task: Optional[asyncio.Task] = None
     batch_sender_task: Optional[asyncio.Task] = None
     stdin_pump_task: Optional[asyncio.Task] = None
+    geometry: Optional[LaneGeometry] = None  # при --frames lane
+    viewport: Optional[str] = None
     closed: bool = False
 
     async def start(self):
@@ -48,6 +53,9 @@ class Session:
                     await self.out_queue.put("[SIM] <EOF>")
                     break
                 text = line.decode('utf-8', errors='replace').rstrip("\r\n")
+                if text.startswith(("geom ", "lf ")):
+                    self._read_lane_block(text)
+                    continue
                 try:
                     for part in text.split(";"):
                         part = part.strip()
@@ -59,6 +67,24 @@ class Session:
         except Exception as e:
             await self.out_queue.put(f"[SIM] <reader error: {e}>")
 
+    def _read_lane_block(self, text: str):
+        kind, _, payload = text.partition(" ")
+        try:
+            data = base64.b64decode(payload)
+            if kind == "geom":
+                self.geometry = LaneGeometry.parse(data)
+                self._update_viewport(self.viewport)
+                return
+            if self.geometry is None:
+                return
+            for cmd in self.geometry.decode_frame(data):
+                self.out_queue.put_nowait(cmd)
+        except asyncio.QueueFull:
+            pass
+        except (binascii.Error, ValueError, struct.error) as e:
+            with contextlib.suppress(asyncio.QueueFull):
+                self.out_queue.put_nowait(f"[SIM] <bad {kind} block: {e}>")
+
     async def _batch_sender(self):
         try:
             buffer: List[str] = []
@@ -75,7 +101,9 @@ class Session:
                     last_flush = asyncio.get_event_loop().time()
                     return
                 try:
-                    await self.ws.send_json({"type": "batch", "commands": list(map(convert_msg_to_dict, buffer))})
+                    await self.ws.send_json({"type": "batch", "commands": [
+                        m if isinstance(m, dict) else convert_msg_to_dict(m)
+                        for m in buffer]})
                 except (WebSocketDisconnect, RuntimeError):
                     buffer = []
                     return
@@ -125,6 +153,10 @@ class Session:
                 cmd = str(data.get("cmd", "")).strip()
                 value = data.get("value")
 
+                if cmd == "viewport":
+                    self.viewport = value
+                    self._update_viewport(value)
+
                 if value is None or value == "":
                     line = f"{cmd}\n"
                 else:
@@ -142,6 +174,16 @@ class Session:
                 writer.close()
                 await writer.wait_closed()
 
+    def _update_viewport(self, value):
+        if self.geometry is None:
+            return
+        try:
+            x0, y0, x1, y1 = map(float, str(value or "").split())
+        except ValueError:
+            self.geometry.clear_viewport()
+            return
+        self.geometry.set_viewport(x0, y0, x1, y1)
+
     async def close(self):
         if self.closed: return
         self.closed = True
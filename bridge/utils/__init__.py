@@ -1,2 +1,3 @@
 from .process import *
 from .message_converter import *
+from .lane_frames import LaneGeometry
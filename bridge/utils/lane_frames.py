@@ -0,0 +1,134 @@
+"""Разбор кадров в координатах полосы (ITS --frames lane).
+
+Симуляция один раз присылает геометрию сети ("geom <base64>"), затем
+каждый кадр - "lf <base64>" с записями (id, полоса, s, d). Позы
+считаются здесь, как Polyline::poseAt на сервере, и только для машин
+на полосах, задевающих окно просмотра. Формат - lane_frames.h.
+"""
+import bisect
+import math
+import struct
+
+GEOMETRY_MAGIC = b"ITSG"
+FRAME_MAGIC = b"ITSF"
+VERSION = 1
+
+CONNECTOR = 1
+CURVE = 2
+
+S_SCALE = 65535.0
+D_STEP = 1.0 / 32.0
+RECORD = struct.Struct("<IHHb")
+
+# Запас вокруг окна: машина у края не замирает, пока видна
+VIEW_MARGIN = 20.0
+
+
+class LaneShape:
+    __slots__ = ("id", "width", "connector", "points", "heading", "acc",
+                 "length", "bbox")
+
+    def __init__(self, lane_id, width, connector, points, heading):
+        self.id = lane_id
+        self.width = width
+        self.connector = connector
+        self.points = points
+        self.heading = heading
+        self.acc = [0.0]
+        for (x0, y0), (x1, y1) in zip(points, points[1:]):
+            self.acc.append(self.acc[-1] + math.hypot(x1 - x0, y1 - y0))
+        self.length = self.acc[-1]
+        xs = [p[0] for p in points] or [0.0]
+        ys = [p[1] for p in points] or [0.0]
+        self.bbox = (min(xs), min(ys), max(xs), max(ys))
+
+    def pose(self, s, d):
+        """(x, y, theta) в точке s со смещением d влево, как на сервере."""
+        pts = self.points
+        if len(pts) < 2:
+            x, y = pts[0] if pts else (0.0, 0.0)
+            return x, y, 0.0
+        s = min(max(s, 0.0), self.length)
+        i = min(bisect.bisect_right(self.acc, s) - 1, len(pts) - 2)
+        seg = max(1e-9, self.acc[i + 1] - self.acc[i])
+        t = (s - self.acc[i]) / seg
+        (x0, y0), (x1, y1) = pts[i], pts[i + 1]
+        x = x0 + (x1 - x0) * t
+        y = y0 + (y1 - y0) * t
+        if self.heading:
+            # Дуга между точками: поправка от хорды и курс по интерполяции
+            tx, ty = (x1 - x0) / seg, (y1 - y0) / seg
+            dth = self.heading[i + 1] - self.heading[i]
+            off = 0.5 * dth * t * (1.0 - t) * seg
+            x += ty * off
+            y -= tx * off
+            theta = self.heading[i] + dth * t
+        else:
+            theta = math.atan2(y1 - y0, x1 - x0)
+        if d:
+            x -= math.sin(theta) * d
+            y += math.cos(theta) * d
+        return x, y, theta
+
+
+class LaneGeometry:
+    def __init__(self, lanes):
+        self.lanes = lanes
+        self.visible = None  # None - видно всё
+
+    @classmethod
+    def parse(cls, data: bytes) -> "LaneGeometry":
+        if data[:4] != GEOMETRY_MAGIC or data[4] != VERSION:
+            raise ValueError("not a lane geometry block")
+        (count,) = struct.unpack_from("<I", data, 5)
+        pos = 9
+        lanes = {}
+        for _ in range(count):
+            lane_id, width, flags, _stop, _group, n = struct.unpack_from(
+                "<IfBfiH", data, pos)
+            pos += 19
+            flat = struct.unpack_from(f"<{2 * n}f", data, pos)
+            pos += 8 * n
+            points = list(zip(flat[0::2], flat[1::2]))
+            heading = None
+            if flags & CURVE:
+                heading = list(struct.unpack_from(f"<{n}f", data, pos))
+                pos += 4 * n
+            lanes[lane_id] = LaneShape(lane_id, width, bool(flags & CONNECTOR),
+                                       points, heading)
+        return cls(lanes)
+
+    def set_viewport(self, x0, y0, x1, y1):
+        lo_x, hi_x = min(x0, x1) - VIEW_MARGIN, max(x0, x1) + VIEW_MARGIN
+        lo_y, hi_y = min(y0, y1) - VIEW_MARGIN, max(y0, y1) + VIEW_MARGIN
+        self.visible = {
+            lane.id for lane in self.lanes.values()
+            if lane.bbox[0] <= hi_x and lane.bbox[2] >= lo_x
+            and lane.bbox[1] <= hi_y and lane.bbox[3] >= lo_y
+        }
+
+    def clear_viewport(self):
+        self.visible = None
+
+    def decode_frame(self, data: bytes):
+        """Команды "vh move" для видимых машин кадра."""
+        if data[:4] != FRAME_MAGIC:
+            raise ValueError("not a lane frame")
+        _time_ms, count = struct.unpack_from("<II", data, 4)
+        out = []
+        visible = self.visible
+        for vid, lane_id, sq, dq in RECORD.iter_unpack(
+                data[12:12 + count * RECORD.size]):
+            if visible is not None and lane_id not in visible:
+                continue
+            lane = self.lanes.get(lane_id)
+            if lane is None:
+                continue
+            x, y, theta = lane.pose(sq / S_SCALE * lane.length, dq * D_STEP)
+            out.append({
+                "type": "vh",
+                "action": "move",
+                "id": vid,
+                "meta": {"x": x, "y": y, "theta": theta},
+            })
+        return out
@@ -1,3 +1,46 @@
+KPI_FIELDS = {
+    "lane": ("lane", ["flow_vph", "mean_speed", "occupancy"]),
+    "approach": ("lane", ["queue_mean", "queue_max", "stops"]),
+    "trips": ("period_trips", ["total_trips", "travel_time_mean",
+                               "travel_time_p50", "travel_time_p95",
+                               "delay_mean", "delay_p95", "stops_mean"]),
+}
+
+
+def convert_kpi(parts, msg: str):
+    if not parts or parts[0] not in KPI_FIELDS:
+        return {
+            "type": "invalid",
+            "error": "Unknown kpi kind",
+            "meta": {"message": msg}
+        }
+
+    kind = parts[0]
+    key, fields = KPI_FIELDS[kind]
+    values = parts[1:]
+    if len(values) != len(fields) + 1:
+        return {
+            "type": "invalid",
+            "error": f"Expected {len(fields) + 1} values for kpi {kind}, got {len(values)}"
+        }
+
+    try:
+        numbers = list(map(float, values))
+    except ValueError:
+        return {
+            "type": "invalid",
+            "error": "KPI values must be numbers"
+        }
+
+    meta = {key: int(numbers[0])}
+    meta.update(zip(fields, numbers[1:]))
+    return {
+        "type": "kpi",
+        "action": kind,
+        "meta": meta
+    }
+
+
 def convert_msg_to_dict(msg: str):
     splited = msg.split()
 
@@ -15,12 +58,20 @@ def convert_msg_to_dict(msg: str):
                 "type": "time",
                 "time": value
             }
+        if action == "scale":
+            return {
+                "type": "scale",
+                "scale": value
+            }
         return {
             "type": "invalid",
             "error": "Unknown message type",
             "meta": {"message": msg}
         }
 
+    if splited[0] == "kpi":
+        return convert_kpi(splited[1:], msg)
+
     msg_type, action, object_id = splited[:3]
 
     try:
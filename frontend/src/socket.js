@@ -81,6 +81,10 @@ export class SimSocket {
             }
         } else if (type === "time") {
             this.world.server.setTime(Number(cmd.time));
+        } else if (type === "kpi") {
+            // Показатели приходят раз в период, интерфейса под них пока нет
+        } else if (type === "scale") {
+            console.log("[WS] Simulation can't keep up, running at", Number(cmd.scale), "x");
         } else {
             console.log("[WS] Unsupported type:", type, cmd);
         }